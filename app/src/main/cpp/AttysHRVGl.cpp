@@ -186,22 +186,6 @@ static void GLCheckErrors(int line) {
 
 #endif // CHECK_GL_ERRORS
 
-/**
- * Vector utils
- */
-void crossProduct(const float v_A[3], const float v_B[3], float c_P[3]) {
-    c_P[0] = v_A[1] * v_B[2] - v_A[2] * v_B[1];
-    c_P[1] = v_A[2] * v_B[0] - v_A[0] * v_B[2];
-    c_P[2] = v_A[0] * v_B[1] - v_A[1] * v_B[0];
-}
-
-void vecDiff(const float v_A[3], const float v_B[3], float c_P[3]) {
-    c_P[0] = v_A[0] - v_B[0];
-    c_P[1] = v_A[1] - v_B[1];
-    c_P[2] = v_A[2] - v_B[2];
-}
-
-
 // saves a timestamp at the creation of the program
 static const std::chrono::time_point<std::chrono::steady_clock> start_ts = std::chrono::steady_clock::now();
 
@@ -518,7 +502,7 @@ void OvrHRText::CreateGeometry() {
     VertexAttribs[0].Size = 3;
     VertexAttribs[0].Type = GL_FLOAT;
     VertexAttribs[0].Normalized = false;
-    VertexAttribs[0].Stride = sizeof(axesVertices.positions[0]);
+    VertexAttribs[0].Stride = sizeof(AxesVertices::positions[0]);
     VertexAttribs[0].Pointer = (const GLvoid *) offsetof(AxesVertices, positions);
 
     VertexAttribs[2].Index = 1;
@@ -526,14 +510,14 @@ void OvrHRText::CreateGeometry() {
     VertexAttribs[2].Size = 4;
     VertexAttribs[2].Normalized = true;
     VertexAttribs[2].Type = GL_UNSIGNED_BYTE;
-    VertexAttribs[2].Stride = sizeof(axesVertices.colors[0]);
+    VertexAttribs[2].Stride = sizeof(AxesVertices::colors[0]);
     VertexAttribs[2].Pointer = (const GLvoid *) offsetof(AxesVertices, colors);
 
     VertexAttribs[1].Index = 2;
     VertexAttribs[1].Name = "texCoord";
     VertexAttribs[1].Size = 2;
     VertexAttribs[1].Type = GL_FLOAT;
-    VertexAttribs[1].Stride = sizeof(axesVertices.text2D[0]);
+    VertexAttribs[1].Stride = sizeof(AxesVertices::text2D[0]);
     VertexAttribs[1].Pointer = (const GLvoid *) offsetof(AxesVertices, text2D);
 
     glGenTextures( 1, &texid );
@@ -549,14 +533,15 @@ void OvrHRText::CreateGeometry() {
 
     GL(glGenBuffers(1, &VertexBuffer));
     GL(glBindBuffer(GL_ARRAY_BUFFER, VertexBuffer));
-    GL(glBufferData(GL_ARRAY_BUFFER, sizeof(axesVertices), &axesVertices, GL_DYNAMIC_DRAW));
+    GL(glBufferData(GL_ARRAY_BUFFER, sizeof(AxesVertices), nullptr, GL_DYNAMIC_DRAW));
     GL(glBindBuffer(GL_ARRAY_BUFFER, 0));
 
     GL(glGenBuffers(1, &IndexBuffer));
     GL(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IndexBuffer));
-    GL(glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(axesIndices), axesIndices, GL_DYNAMIC_DRAW));
+    GL(glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(TextMesh::indices), nullptr, GL_DYNAMIC_DRAW));
     GL(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0));
 
+    // the callbacks are not registered yet: this thread is the only producer
     add_text(defaultgreeting, 255, 255, 255, 0, 0);
 
     CreateVAO();
@@ -585,15 +570,19 @@ void OvrHRText::render(GLuint sceneMatrices) {
                 &m1.M[0][0]));
     }
 
-    // just updating it
-    GL(glBindBuffer(GL_ARRAY_BUFFER, VertexBuffer));
-    GL(glBufferData(GL_ARRAY_BUFFER, sizeof(axesVertices), &axesVertices, GL_DYNAMIC_DRAW));
-    GL(glBindBuffer(GL_ARRAY_BUFFER, 0));
-
-    // just updating it
-    GL(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IndexBuffer));
-    GL(glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(axesIndices), axesIndices, GL_DYNAMIC_DRAW));
-    GL(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0));
+    // uploading the text only if the DSP thread has written a new one
+    if (textMesh.update()) {
+        const TextMesh &m = textMesh.getReadBuffer();
+        VertexCount = m.vertexCount;
+        IndexCount = m.indexCount;
+        GL(glBindBuffer(GL_ARRAY_BUFFER, VertexBuffer));
+        GL(glBufferData(GL_ARRAY_BUFFER, sizeof(m.vertices), &m.vertices, GL_DYNAMIC_DRAW));
+        GL(glBindBuffer(GL_ARRAY_BUFFER, 0));
+        GL(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IndexBuffer));
+        GL(glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(m.indices), m.indices, GL_DYNAMIC_DRAW));
+        GL(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0));
+        if (streamBuffer) streamBuffer->countUpload(sizeof(m.vertices) + sizeof(m.indices));
+    }
 
     GL(glUniform1i(glGetUniformLocation(Program, "Texture0"), 0));
     GL(glActiveTexture(GL_TEXTURE0));
@@ -621,8 +610,9 @@ void OvrHRText::render(GLuint sceneMatrices) {
 void OvrHRText::add_text(const char *text,
                          unsigned char r, unsigned char g, unsigned char b,
                          float x, float y, bool centered) {
-    VertexCount = 0;
-    IndexCount = 0;
+    TextMesh &m = textMesh.getWriteBuffer();
+    int vertexCount = 0;
+    int indexCount = 0;
     unsigned char a = 255;
     if (centered) {
         float xoff = 0;
@@ -655,13 +645,13 @@ void OvrHRText::add_text(const char *text,
                 float s, t;
                 unsigned char r, g, b, a;
             };
-            GLuint index = VertexCount;
-            axesIndices[IndexCount++] = index;
-            axesIndices[IndexCount++] = index + 1;
-            axesIndices[IndexCount++] = index + 2;
-            axesIndices[IndexCount++] = index;
-            axesIndices[IndexCount++] = index + 2;
-            axesIndices[IndexCount++] = index + 3;
+            GLuint index = vertexCount;
+            m.indices[indexCount++] = index;
+            m.indices[indexCount++] = index + 1;
+            m.indices[indexCount++] = index + 2;
+            m.indices[indexCount++] = index;
+            m.indices[indexCount++] = index + 2;
+            m.indices[indexCount++] = index + 3;
             std::vector<OneVertex> oneVertex;
             //ALOGV("Glyph: VC=%d, IC=%d (%f,%f),(%f,%f)",VertexCount,IndexCount,x0,y0,x1,y1);
             oneVertex.push_back({x0, y0, 0, s0, t0, r, g, b, a});
@@ -669,23 +659,26 @@ void OvrHRText::add_text(const char *text,
             oneVertex.push_back({x1, y1, 0, s1, t1, r, g, b, a});
             oneVertex.push_back({x1, y0, 0, s1, t0, r, g, b, a});
             for (auto &v: oneVertex) {
-                axesVertices.positions[VertexCount][0] = v.x;
-                axesVertices.positions[VertexCount][1] = v.y;
-                axesVertices.positions[VertexCount][2] = v.z;
-                axesVertices.text2D[VertexCount][0] = v.s;
-                axesVertices.text2D[VertexCount][1] = v.t;
-                axesVertices.colors[VertexCount][0] = v.r;
-                axesVertices.colors[VertexCount][1] = v.g;
-                axesVertices.colors[VertexCount][2] = v.b;
-                axesVertices.colors[VertexCount][3] = v.a;
-                VertexCount++;
+                m.vertices.positions[vertexCount][0] = v.x;
+                m.vertices.positions[vertexCount][1] = v.y;
+                m.vertices.positions[vertexCount][2] = v.z;
+                m.vertices.text2D[vertexCount][0] = v.s;
+                m.vertices.text2D[vertexCount][1] = v.t;
+                m.vertices.colors[vertexCount][0] = v.r;
+                m.vertices.colors[vertexCount][1] = v.g;
+                m.vertices.colors[vertexCount][2] = v.b;
+                m.vertices.colors[vertexCount][3] = v.a;
+                vertexCount++;
             }
             x += (float)(glyph->advance_x)/fontsize;
         } else {
             ALOGE("Glyph is nullptr");
         }
     }
-    // ALOGV("Glyph: HR Text index count: %d. Vertex count: %d.",IndexCount,VertexCount);
+    m.vertexCount = vertexCount;
+    m.indexCount = indexCount;
+    textMesh.publish();
+    // ALOGV("Glyph: HR Text index count: %d. Vertex count: %d.",indexCount,vertexCount);
 }
 
 void OvrHRText::updateHR(float hr) {
@@ -715,9 +708,12 @@ const char* ECG_PLOT_VERTEX_SHADER = R"SHADER_SRC(
         #define VIEW_ID gl_ViewID_OVR
         #extension GL_OVR_multiview2 : require
         layout(num_views=NUM_VIEWS) in;
-        in vec3 vertexPosition;
+        in float vertexY;
         in vec4 vertexColor;
         uniform mat4 ModelMatrix;
+        uniform int RingHead;
+        uniform int RingSize;
+        uniform float ColumnFill;
         uniform SceneMatrices
         {
         	uniform mat4 ViewMatrix[NUM_VIEWS];
@@ -726,7 +722,11 @@ const char* ECG_PLOT_VERTEX_SHADER = R"SHADER_SRC(
         out vec4 fragmentColor;
         void main()
         {
-        	gl_Position = sm.ProjectionMatrix[VIEW_ID] * ( sm.ViewMatrix[VIEW_ID] * ( ModelMatrix * ( vec4( vertexPosition, 1.0 ) ) ) );
+        	// a min and a max vertex per column, the last column is a copy of slot 0
+        	int slot = (gl_VertexID / 2) % RingSize;
+        	int age = (slot - RingHead + RingSize) % RingSize;
+        	float x = 2.0 - (float(RingSize - 1 - age) + ColumnFill) / float(RingSize) * 4.0;
+        	gl_Position = sm.ProjectionMatrix[VIEW_ID] * ( sm.ViewMatrix[VIEW_ID] * ( ModelMatrix * ( vec4( x, vertexY, 0.0, 1.0 ) ) ) );
         	fragmentColor = vertexColor;
         }
 )SHADER_SRC";
@@ -744,32 +744,31 @@ const char* ECG_PLOT_FRAGMENT_SHADER = R"SHADER_SRC(
 
 void OvrECGPlot::CreateGeometry() {
     ALOGV("OvrECGPlot::Create()");
-    VertexCount = nPoints;
-    IndexCount = (nPoints * 2) + 1;
+    VertexCount = (maxColumns + 1) * 2;
+    IndexCount = 0;
 
-    ALOGV("Creating ECG plot with %d vertices.", VertexCount);
-    for (int i = 0; i < nPoints; i++) {
-        axesIndices[i * 2] = i;
-        axesIndices[i * 2 + 1] = i + 1;
+    ProgramUniforms.push_back({ovrUniform::Index::RING_HEAD, ovrUniform::Type::INTEGER, "RingHead"});
+    ProgramUniforms.push_back({ovrUniform::Index::RING_SIZE, ovrUniform::Type::INTEGER, "RingSize"});
+    ProgramUniforms.push_back({ovrUniform::Index::COLUMN_FILL, ovrUniform::Type::FLOAT, "ColumnFill"});
+
+    trace.setWindow(windowSecs[windowIndex] * SAMPLINGRATE);
 
+    ALOGV("Creating ECG plot with %d vertices.", VertexCount);
+    ovrAxesVertices axesVertices = {};
+    for (int i = 0; i < VertexCount; i++) {
         axesVertices.colors[i][0] = 0;
         axesVertices.colors[i][1] = 255;
         axesVertices.colors[i][2] = 255;
         axesVertices.colors[i][3] = 255;
-
-        axesVertices.positions[i][0] = -2 + (float) i / (float) nPoints * 4.0f;
-        axesVertices.positions[i][1] = (float) sin(i / 10.0) * 0.1f;
-        // ALOGV("pos = %f,%f", axesVertices.positions[i][0],axesVertices.positions[i][1]);
-        axesVertices.positions[i][2] = 0;
     }
 
     VertexAttribs[0].Index = 0;
-    VertexAttribs[0].Name = "vertexPosition";
-    VertexAttribs[0].Size = 3;
+    VertexAttribs[0].Name = "vertexY";
+    VertexAttribs[0].Size = 1;
     VertexAttribs[0].Type = GL_FLOAT;
     VertexAttribs[0].Normalized = false;
-    VertexAttribs[0].Stride = sizeof(axesVertices.positions[0]);
-    VertexAttribs[0].Pointer = (const GLvoid *) offsetof(ovrAxesVertices, positions);
+    VertexAttribs[0].Stride = sizeof(axesVertices.y[0]);
+    VertexAttribs[0].Pointer = (const GLvoid *) offsetof(ovrAxesVertices, y);
 
     VertexAttribs[1].Index = 1;
     VertexAttribs[1].Name = "vertexColor";
@@ -779,16 +778,12 @@ void OvrECGPlot::CreateGeometry() {
     VertexAttribs[1].Stride = sizeof(axesVertices.colors[0]);
     VertexAttribs[1].Pointer = (const GLvoid *) offsetof(ovrAxesVertices, colors);
 
+    // the colours are static and only the columns which have changed are uploaded
     GL(glGenBuffers(1, &VertexBuffer));
     GL(glBindBuffer(GL_ARRAY_BUFFER, VertexBuffer));
-    GL(glBufferData(GL_ARRAY_BUFFER, sizeof(axesVertices), &axesVertices, GL_STREAM_DRAW));
+    GL(glBufferData(GL_ARRAY_BUFFER, sizeof(axesVertices), &axesVertices, GL_DYNAMIC_DRAW));
     GL(glBindBuffer(GL_ARRAY_BUFFER, 0));
 
-    GL(glGenBuffers(1, &IndexBuffer));
-    GL(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IndexBuffer));
-    GL(glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(axesIndices), axesIndices, GL_STREAM_DRAW));
-    GL(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0));
-
     CreateVAO();
 
     iirhp.setup(SAMPLINGRATE,0.5);
@@ -797,12 +792,15 @@ void OvrECGPlot::CreateGeometry() {
     registerAttysDataCallback([this](float v) { attysDataCallBack(v); });
 }
 
+void OvrECGPlot::nextWindow() {
+    windowIndex = (windowIndex + 1) % nWindows;
+    trace.setWindow(windowSecs[windowIndex] * SAMPLINGRATE);
+    ALOGV("ECG window: %d secs", windowSecs[windowIndex]);
+}
+
 void OvrECGPlot::attysDataCallBack(float v) {
     double v2 = iirhp.filter(v);
-    for (int i = 0; i < (nPoints - 1); i++) {
-        axesVertices.positions[i][1] = axesVertices.positions[i + 1][1];
-    }
-    axesVertices.positions[nPoints - 1][1] = (float) v2 * 1000;
+    trace.add((float) v2 * 1000);
 }
 
 void OvrECGPlot::render(GLuint sceneMatrices) {
@@ -826,16 +824,29 @@ void OvrECGPlot::render(GLuint sceneMatrices) {
     }
 
 #ifdef FAKE_DATA
-    for(int i = 0; i < nPoints; i++) {
-        axesVertices.positions[i][0] = -1 + (float) i / (float) nPoints * 2.0f;
-        axesVertices.positions[i][1] = (float) sin(i / 10.0 + offset) * 0.1;
-    }
+    trace.add((float) sin(offset) * 0.1f);
     offset += 0.1;
 #endif
 
-    GL(glBindBuffer(GL_ARRAY_BUFFER, VertexBuffer));
-    GL(glBufferData(GL_ARRAY_BUFFER, sizeof(axesVertices), &axesVertices, GL_STREAM_DRAW));
-    GL(glBindBuffer(GL_ARRAY_BUFFER, 0));
+    // uploading only the columns which have changed since the last frame
+    ECGTrace::Range ranges[ECGTrace::maxRanges];
+    const size_t nRanges = trace.update(ranges);
+    if (nRanges > 0) {
+        GL(glBindBuffer(GL_ARRAY_BUFFER, VertexBuffer));
+        for (size_t i = 0; i < nRanges; i++) {
+            GL(glBufferSubData(GL_ARRAY_BUFFER,
+                               (GLintptr) (offsetof(ovrAxesVertices, y) + ranges[i].first * 2 * sizeof(float)),
+                               (GLsizeiptr) (ranges[i].count * 2 * sizeof(float)),
+                               trace.getData() + ranges[i].first * 2));
+            if (streamBuffer) streamBuffer->countUpload(ranges[i].count * 2 * sizeof(float));
+        }
+        GL(glBindBuffer(GL_ARRAY_BUFFER, 0));
+    }
+    const int head = (int) trace.getHead();
+    const int nColumns = (int) trace.getNColumns();
+    GL(glUniform1i(UniformLocation[ovrUniform::Index::RING_HEAD], head));
+    GL(glUniform1i(UniformLocation[ovrUniform::Index::RING_SIZE], nColumns));
+    GL(glUniform1f(UniformLocation[ovrUniform::Index::COLUMN_FILL], trace.getColumnFill()));
     GL(glBindVertexArray(VertexArrayObject));
 
     GL(glDepthMask(GL_FALSE));
@@ -845,7 +856,11 @@ void OvrECGPlot::render(GLuint sceneMatrices) {
     GL(glEnable(GL_BLEND));
     GL(glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA));
 
-    GL(glDrawElements(GL_LINES, IndexCount, GL_UNSIGNED_SHORT, nullptr));
+    // from the oldest column to the copy of slot 0 and from slot 0 to the newest
+    GL(glDrawArrays(GL_LINE_STRIP, head * 2, ((head > 0 ? nColumns + 1 : nColumns) - head) * 2));
+    if (head > 0) {
+        GL(glDrawArrays(GL_LINE_STRIP, 0, head * 2));
+    }
 
     GL(glDepthMask(GL_TRUE));
     GL(glDisable(GL_BLEND));
@@ -867,8 +882,9 @@ const char* HRPLOT_VERTEX_SHADER = R"SHADER_SRC(
         #define VIEW_ID gl_ViewID_OVR
         #extension GL_OVR_multiview2 : require
         layout(num_views=NUM_VIEWS) in;
-        in vec3 vertexPosition;
-        in vec3 vertexNormal;
+        in vec2 vertexXZ;
+        in float vertexHeight;
+        in vec4 vertexNormal;
         out vec3 fragNormal;
         out vec3 fragPosition;
         out vec3 fragOrigPosition;
@@ -880,9 +896,10 @@ const char* HRPLOT_VERTEX_SHADER = R"SHADER_SRC(
         } sm;
         void main()
         {
+           vec3 vertexPosition = vec3(vertexXZ.x, vertexHeight, vertexXZ.y);
            gl_Position = sm.ProjectionMatrix[VIEW_ID] * ( sm.ViewMatrix[VIEW_ID] * ( ModelMatrix * ( vec4( vertexPosition, 1.0 ) ) ) );
            mat3 normalMatrix = transpose(inverse(mat3(ModelMatrix)));
-           fragNormal = normalize(normalMatrix * vertexNormal);
+           fragNormal = normalize(normalMatrix * vertexNormal.xyz);
            fragPosition = vec3(ModelMatrix * vec4(vertexPosition, 1));
            fragOrigPosition = vertexPosition;
         }
@@ -970,88 +987,75 @@ void OvrHRPlot::CreateGeometry() {
     for (int y = 0; y <= QUAD_GRID_SIZE; y++) {
         for (int x = 0; x <= QUAD_GRID_SIZE; x++) {
             int vertexPosition = y * (QUAD_GRID_SIZE + 1) + x;
-            hrVertices.vertices[vertexPosition][0] =
-                    (float)(((double) x * deltaGrid - 1.0) * scaleGrid);
-            hrVertices.vertices[vertexPosition][1] = 0;
-            hrVertices.vertices[vertexPosition][2] =
-                    (float)(((double) y * deltaGrid - 1.0) * scaleGrid);
-            hrVertices.normals[vertexPosition][0] = 0;
-            hrVertices.normals[vertexPosition][1] = 1;
-            hrVertices.normals[vertexPosition][2] = 0;
+            hrGrid.xz[vertexPosition][0] = waveMesh.getX(x);
+            hrGrid.xz[vertexPosition][1] = waveMesh.getZ(y);
+            hrVertices.heights[vertexPosition] = WaveMesh::toHalf(0);
+            hrVertices.normals[vertexPosition] = WaveMesh::packNormal(0, 1, 0);
         }
     }
 
     // Generate indices into vertex list
-    for (int y = 0; y < QUAD_GRID_SIZE; y++) {
-        for (int x = 0; x < QUAD_GRID_SIZE; x++) {
-            int indexPosition = y * QUAD_GRID_SIZE + x;
-            // tri 0
-            indices[6 * indexPosition] = y * (QUAD_GRID_SIZE + 1) + x;    //bl
-            indices[6 * indexPosition + 1] = (y + 1) * (QUAD_GRID_SIZE + 1) + x + 1;//tr
-            indices[6 * indexPosition + 2] = y * (QUAD_GRID_SIZE + 1) + x + 1;//br
-            // tri 1
-            indices[6 * indexPosition + 3] = y * (QUAD_GRID_SIZE + 1) + x;    //bl
-            indices[6 * indexPosition + 4] = (y + 1) * (QUAD_GRID_SIZE + 1) + x;    //tl
-            indices[6 * indexPosition + 5] = (y + 1) * (QUAD_GRID_SIZE + 1) + x + 1;//tr
-        }
-    }
+    waveMesh.getStripIndices(indices);
 
     VertexAttribs[0].Index = 0;
-    VertexAttribs[0].Name = "vertexPosition";
-    VertexAttribs[0].Size = 3;
+    VertexAttribs[0].Name = "vertexXZ";
+    VertexAttribs[0].Size = 2;
     VertexAttribs[0].Type = GL_FLOAT;
     VertexAttribs[0].Normalized = false;
-    VertexAttribs[0].Stride = 3 * sizeof(float);
-    VertexAttribs[0].Pointer = (const GLvoid *) offsetof(HRVertices, vertices);
+    VertexAttribs[0].Stride = 2 * sizeof(float);
+    VertexAttribs[0].Pointer = (const GLvoid *) offsetof(HRGrid, xz);
 
     VertexAttribs[1].Index = 1;
-    VertexAttribs[1].Name = "vertexNormal";
-    VertexAttribs[1].Size = 3;
-    VertexAttribs[1].Type = GL_FLOAT;
+    VertexAttribs[1].Name = "vertexHeight";
+    VertexAttribs[1].Size = 1;
+    VertexAttribs[1].Type = GL_HALF_FLOAT;
     VertexAttribs[1].Normalized = false;
-    VertexAttribs[1].Stride = 3 * sizeof(float);
-    VertexAttribs[1].Pointer = (const GLvoid *) offsetof(HRVertices, normals);
+    VertexAttribs[1].Stride = sizeof(uint16_t);
+    VertexAttribs[1].Pointer = (const GLvoid *) offsetof(HRVertices, heights);
+    VertexAttribs[1].PerFrame = true;
+
+    VertexAttribs[2].Index = 2;
+    VertexAttribs[2].Name = "vertexNormal";
+    VertexAttribs[2].Size = 4;
+    VertexAttribs[2].Type = GL_INT_2_10_10_10_REV;
+    VertexAttribs[2].Normalized = true;
+    VertexAttribs[2].Stride = sizeof(uint32_t);
+    VertexAttribs[2].Pointer = (const GLvoid *) offsetof(HRVertices, normals);
+    VertexAttribs[2].PerFrame = true;
 
+    // the grid followed by the normals and heights if there is no stream buffer
     GL(glGenBuffers(1, &VertexBuffer));
     GL(glBindBuffer(GL_ARRAY_BUFFER, VertexBuffer));
-    GL(glBufferData(GL_ARRAY_BUFFER, sizeof(HRVertices), &hrVertices, GL_STREAM_DRAW));
+    GL(glBufferData(GL_ARRAY_BUFFER, sizeof(HRGrid) + sizeof(HRVertices), nullptr, GL_STATIC_DRAW));
+    GL(glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(HRGrid), &hrGrid));
+    GL(glBufferSubData(GL_ARRAY_BUFFER, sizeof(HRGrid), sizeof(HRVertices), &hrVertices));
     GL(glBindBuffer(GL_ARRAY_BUFFER, 0));
 
     GL(glGenBuffers(1, &IndexBuffer));
     GL(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IndexBuffer));
-    GL(glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STREAM_DRAW));
+    GL(glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW));
     GL(glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0));
 
     CreateVAO();
+    BindVertexBuffer(VertexBuffer, sizeof(HRGrid));
 
     minHR = 1000;
     maxHR = 0;
 
+    hrCurveBuilder.start();
     registerAttysHRCallback([this](float v){ addHR(v); });
 }
 
 void OvrHRPlot::addHR(float hr) {
-    const std::lock_guard<std::mutex> lock(mtx);
     auto current_ts = std::chrono::steady_clock::now();
     std::chrono::duration<double> d = current_ts - start_ts;
     double t = d.count();
     ALOGV("hrUpdate: t=%f, hr=%f",t,hr);
-    hrTs.push_back(t);
-    hrBuffer.push_back(hr);
-    if (hrBuffer.size() > 60) {
-        hrBuffer.erase(hrBuffer.begin());
-        hrTs.erase(hrTs.begin());
-    }
-    if (hrTs.size() > 1) {
-        hrSpline = cubic_spline(hrTs, hrBuffer);
-        ALOGV("Prediction: hr(%f)=%f",t+1,hrSpline(t+1));
-    }
+    hrCurveBuilder.add(t, hr);
 }
 
 void OvrHRPlot::render(GLuint sceneMatrices) {
-    const int shiftbuffersize = QUAD_GRID_SIZE * 10;
     double hrnorm = -1;
-    double hrShiftBuffer[shiftbuffersize] = {};
     const double hrDecayConstant = 0.005;
 
     const std::chrono::time_point<std::chrono::steady_clock> current_ts = std::chrono::steady_clock::now();
@@ -1070,21 +1074,17 @@ void OvrHRPlot::render(GLuint sceneMatrices) {
         }
     }
 
-    mtx.lock();
-    if (hrSpline.hasSpline()) {
-        for (int i = 0; i < shiftbuffersize; i++) {
-            double dt = t - (double) i / (double) shiftbuffersize * maxtime;
-            double hrInterpol = 0;
-            if (dt < (hrSpline.lower_bound() - spline_pred_sec)) {
-                hrInterpol = hrSpline(hrSpline.lower_bound() - spline_pred_sec);
-            } else if (dt > (hrSpline.upper_bound() + spline_pred_sec) ) {
-                hrInterpol = hrSpline(hrSpline.upper_bound() + spline_pred_sec);
-            } else {
-                hrInterpol = hrSpline(dt);
-            }
-            if ((hrInterpol < minHR) && (hrInterpol > 30)) minHR = hrInterpol;
-            if ((hrInterpol > maxHR) && (hrInterpol < 180)) maxHR = hrInterpol;
-            hrShiftBuffer[i] = hrInterpol;
+    if (hrCurveBuilder.update()) {
+        hrSampler.setCurve(hrCurveBuilder.getCurve());
+    }
+    // only the points which have become due unless there has been a beat
+    if (hrSampler.update(t) > 0) {
+        hasHRRange = hrSampler.getRange(30, 180, hrRangeMin, hrRangeMax);
+    }
+    if (hrSampler.hasCurve()) {
+        if (hasHRRange) {
+            if (hrRangeMin < minHR) minHR = hrRangeMin;
+            if (hrRangeMax > maxHR) maxHR = hrRangeMax;
         }
         hrnorm = maxHR - minHR;
         //ALOGV("before: minHR = %f, maxHR = %f, norm = %f", minHR, maxHR, hrnorm);
@@ -1092,101 +1092,56 @@ void OvrHRPlot::render(GLuint sceneMatrices) {
             hrnorm = minHRdiff;
         }
     }
-    mtx.unlock();
     if (dCtr++ > (int)fps) {
         std::string s = "hrShiftBuffer = ";
-        for(auto &v:hrShiftBuffer) {
-            s += std::to_string(v);
+        for(int i = 0; i < shiftbuffersize; i++) {
+            s += std::to_string(hrSampler.hasCurve() ? hrSampler[i] : 0.0);
             s += ", ";
         }
         ALOGV("%s",s.c_str());
         dCtr = 0;
     }
 
-    WavesAnim wavesAnim[3];
-    wavesAnim[0].temporalFreq = 7/4.0;
-    wavesAnim[1].temporalFreq = 4/2.0;
-    wavesAnim[2].temporalFreq = 5/3.0;
-
+    WaveMesh::Wave waves[nWaves];
     auto wd = (float)(windDir - M_PI/7.0f);
-    for(auto &da:wavesAnim) {
+    for(int i = 0; i < nWaves; i++) {
         wd += (float)(M_PI/7.0f);
-        da.updateSpatialFreq(wd,windSpeed);
+        waves[i].temporalFreq = waveTemporalFreqs[i];
+        waves[i].spatialFreqX = cos(wd) * windSpeed;
+        waves[i].spatialFreqY = sin(wd) * windSpeed;
     }
 
     //ALOGV("after: minHR = %f, maxHR = %f, norm = %f", minHR, maxHR, hrnorm);
-    for (int x = 0; x <= QUAD_GRID_SIZE; x++) {
-        for (int y = 0; y <= QUAD_GRID_SIZE; y++) {
-            int vertexPosition = y * (QUAD_GRID_SIZE + 1) + x;
-            const double xc = (double) x - (QUAD_GRID_SIZE / 2.0);
-            const double yc = (double) y - (QUAD_GRID_SIZE / 2.0);
-            const double maxr = sqrt((QUAD_GRID_SIZE) * (QUAD_GRID_SIZE));
-            int r = (int) (round(sqrt(yc * yc + xc * xc) / maxr * (double) shiftbuffersize));
-            float h = 0;
-            if ( (r < shiftbuffersize) && (hrnorm > 0) ) {
-                if (hrShiftBuffer[r] > 0) {
-                    h += (float) ((hrShiftBuffer[r] - minHR) / hrnorm * 5.0);
-                }
+    for (size_t r = 0; r < hrProfile.size(); r++) {
+        float h = 0;
+        if ( ((int)r < shiftbuffersize) && (hrnorm > 0) ) {
+            const double hr = hrSampler[r];
+            if (hr > 0) {
+                h = (float) ((hr - minHR) / hrnorm * 5.0);
             }
-            for(auto &da:wavesAnim) {
-                h += da.calcHeight(x, y, t) * 0.1f;
-            }
-            hrVertices.vertices[vertexPosition][1] = h;
         }
+        hrProfile[r] = h;
     }
+    // straight into the region of this frame of the stream buffer if there is one
+    void *mappedVertices = streamBuffer ? streamBuffer->map(sizeof(HRVertices)) : nullptr;
+    HRVertices &v = mappedVertices ? *(HRVertices *) mappedVertices : hrVertices;
+    waveMesh.generate(t, hrProfile.data(), waves, nWaves, 0.1f, v.heights, v.normals);
 
 #ifdef FAKE_DATA
+    float* heights = waveMesh.getHeights();
     for (int x=0; x<=QUAD_GRID_SIZE; x++) {
         float t = offset;
         for (int y=0; y<=QUAD_GRID_SIZE; y++) {
             int vertexPosition = y*(QUAD_GRID_SIZE+1) + x;
-            hrVertices.vertices[vertexPosition][1]= sin(t)*1;
+            heights[vertexPosition] = sin(t)*1;
+            v.heights[vertexPosition] = WaveMesh::toHalf(heights[vertexPosition]);
             t = t + 0.1f;
         }
     }
     offset += 0.1;
+    waveMesh.generateNormals(v.normals);
 #endif
 
-    for (int x = 0; x < QUAD_GRID_SIZE; x++) {
-        for (int y = 0; y < QUAD_GRID_SIZE; y++) {
-            int vertexPosition1 = y * (QUAD_GRID_SIZE + 1) + x;
-            int vertexPosition2 = (y + 1) * (QUAD_GRID_SIZE + 1) + x + 1;
-            int vertexPosition3 = y * (QUAD_GRID_SIZE + 1) + x + 1;
-            float a[3];
-            float b[3];
-            float c1[3];
-            vecDiff(hrVertices.vertices[vertexPosition1], hrVertices.vertices[vertexPosition2], a);
-            vecDiff(hrVertices.vertices[vertexPosition1], hrVertices.vertices[vertexPosition3], b);
-            crossProduct(a,
-                         b,
-                         c1);
-
-            float c2[3];
-            vertexPosition1 = y * (QUAD_GRID_SIZE + 1) + x;
-            vertexPosition2 = (y + 1) * (QUAD_GRID_SIZE + 1) + x;
-            vertexPosition3 = y * (QUAD_GRID_SIZE + 1) + x + 1;
-            vecDiff(hrVertices.vertices[vertexPosition1], hrVertices.vertices[vertexPosition2], a);
-            vecDiff(hrVertices.vertices[vertexPosition1], hrVertices.vertices[vertexPosition3], b);
-            crossProduct(a,
-                         b,
-                         c2);
-
-            hrVertices.normals[vertexPosition1][0] = (c1[0] + c2[0]) / 2;
-            hrVertices.normals[vertexPosition1][1] = (c1[1] + c2[1]) / 2;
-            hrVertices.normals[vertexPosition1][2] = (c1[2] + c2[2]) / 2;
-
-            /*
-            if (x == 0) {
-                ALOGV("cross prod = %d,%f,%f,%f",
-                      y,
-                      hrVertices.normals[vertexPosition1][0],
-                      hrVertices.normals[vertexPosition1][1],
-                      hrVertices.normals[vertexPosition1][2]);
-            }
-*/
-        }
-    }
-
     GL(glUseProgram(Program));
     GL(glBindBufferBase(
             GL_UNIFORM_BUFFER,
@@ -1213,13 +1168,21 @@ void OvrHRPlot::render(GLuint sceneMatrices) {
     GL(glEnable(GL_BLEND));
     GL(glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA));
 
-    GL(glBindBuffer(GL_ARRAY_BUFFER, VertexBuffer));
-    GL(glBufferData(GL_ARRAY_BUFFER, sizeof(HRVertices), &hrVertices, GL_STREAM_DRAW));
-    GL(glBindBuffer(GL_ARRAY_BUFFER, 0));
+    if (mappedVertices) {
+        BindVertexBuffer(streamBuffer->getBuffer(), streamBuffer->unmap());
+    } else {
+        GL(glBindBuffer(GL_ARRAY_BUFFER, VertexBuffer));
+        GL(glBufferSubData(GL_ARRAY_BUFFER, sizeof(HRGrid), sizeof(HRVertices), &hrVertices));
+        GL(glBindBuffer(GL_ARRAY_BUFFER, 0));
+        BindVertexBuffer(VertexBuffer, sizeof(HRGrid));
+        if (streamBuffer) streamBuffer->countUpload(sizeof(HRVertices));
+    }
 
+    GL(glEnable(GL_PRIMITIVE_RESTART_FIXED_INDEX));
     GL(glBindVertexArray(VertexArrayObject));
-    GL(glDrawElements(GL_TRIANGLES, IndexCount, GL_UNSIGNED_SHORT, nullptr));
+    GL(glDrawElements(GL_TRIANGLE_STRIP, IndexCount, GL_UNSIGNED_SHORT, nullptr));
     GL(glBindVertexArray(0));
+    GL(glDisable(GL_PRIMITIVE_RESTART_FIXED_INDEX));
 
     GL(glDepthMask(GL_TRUE));
     GL(glDisable(GL_BLEND));
@@ -1234,7 +1197,12 @@ void OvrHRPlot::render(GLuint sceneMatrices) {
         fps = frameCtr;
         start_fps_ts = current_fps_ts;
         frameCtr = 0;
-        ALOGV("fps = %d", fps);
+        if (streamBuffer) {
+            ALOGV("fps = %d, uploaded %zu bytes in the last frame, %lu waits for the GPU", fps,
+                  streamBuffer->getLastFrameBytes(), streamBuffer->getWaits());
+        } else {
+            ALOGV("fps = %d", fps);
+        }
     }
 }
 
@@ -1284,6 +1252,24 @@ void OvrGeometry::CreateVAO() {
     hasVAO = true;
 }
 
+void OvrGeometry::BindVertexBuffer(GLuint buffer, GLintptr offset) {
+    GL(glBindVertexArray(VertexArrayObject));
+    GL(glBindBuffer(GL_ARRAY_BUFFER, buffer));
+    for (auto &VertexAttrib: VertexAttribs) {
+        if ((VertexAttrib.Index != -1) && VertexAttrib.PerFrame) {
+            GL(glVertexAttribPointer(
+                    VertexAttrib.Index,
+                    VertexAttrib.Size,
+                    VertexAttrib.Type,
+                    VertexAttrib.Normalized,
+                    VertexAttrib.Stride,
+                    (const char *) VertexAttrib.Pointer + offset));
+        }
+    }
+    GL(glBindBuffer(GL_ARRAY_BUFFER, 0));
+    GL(glBindVertexArray(0));
+}
+
 void OvrGeometry::DestroyVAO() {
     if (hasVAO) {
         GL(glDeleteVertexArrays(1, &VertexArrayObject));
@@ -1568,6 +1554,15 @@ void ovrScene::Create() {
     GL(glBindBuffer(GL_UNIFORM_BUFFER, 0));
     GL(glBindBuffer(GL_UNIFORM_BUFFER, 0));
 
+    // the wave grid is written anew every frame
+    if (!streamBuffer.create(sizeof(OvrHRPlot::HRVertices))) {
+        ALOGE("Failed to create the stream buffer");
+    }
+    ovrSkybox.streamBuffer = &streamBuffer;
+    HrText.streamBuffer = &streamBuffer;
+    ECGPlot.streamBuffer = &streamBuffer;
+    HrPlot.streamBuffer = &streamBuffer;
+
     if (!ovrSkybox.Create(SKYBOX_VERTEX_SHADER,SKYBOX_FRAGMENT_SHADER)) {
         ALOGE("Failed to compile Skybox program");
     }
@@ -1594,6 +1589,7 @@ void ovrScene::Create() {
 
 void ovrScene::Destroy() {
     GL(glDeleteBuffers(1, &SceneMatrices));
+    streamBuffer.destroy();
     ECGPlot.Destroy();
     HrPlot.Destroy();
     HrText.Destroy();
@@ -1637,6 +1633,7 @@ void ovrAppRenderer::Create(
 
 void ovrAppRenderer::Destroy() {
     unregisterAllAttysCallbacks();
+    hrJournal.close();
     Framebuffer.Destroy();
     Scene.Destroy();
 }
@@ -1673,6 +1670,8 @@ void ovrAppRenderer::RenderFrame(ovrAppRenderer::FrameIn frameIn) {
             Scene.ClearColor[0], Scene.ClearColor[1], Scene.ClearColor[2], Scene.ClearColor[3]));
     GL(glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT));
 
+    Scene.streamBuffer.beginFrame();
+
     // Skybox
     Scene.ovrSkybox.render(Scene.SceneMatrices);
 
@@ -1689,35 +1688,28 @@ void ovrAppRenderer::RenderFrame(ovrAppRenderer::FrameIn frameIn) {
         Scene.ECGPlot.render(Scene.SceneMatrices);
     }
 
+    Scene.streamBuffer.endFrame();
+
     Framebuffer.Unbind();
 }
 
-void ovrAppRenderer::writeHR2file(float hr) const {
-    const std::string path = getAttysHRfilepath();
-    if (path.empty()) {
-        ALOGE("HR file path not set");
-        return;
-    }
-    FILE* hrFile = fopen(path.c_str(), "at");
-    if (nullptr == hrFile) {
-        ALOGE("Cannot write to HR file: %s", path.c_str());
-        return;
-    }
-    fseek(hrFile, 0L, SEEK_END);
-    long sz = ftell(hrFile);
-    ALOGV("Writing to HR file: %s, size = %ld", path.c_str(), sz);
-    if (sz > MAX_HR_FILESIZE) {
-        fclose(hrFile);
-        ALOGV("HR file %s too large: size = %ld", path.c_str(), sz);
-        return;
-    }
-    struct timeval tv = {};
-    gettimeofday(&tv, nullptr);
-    const long epo = (long) tv.tv_sec * 1000 + tv.tv_usec / 1000;
-    ALOGV("Writing to HR file: %ld, %.1f", epo, hr);
-    const int r = fprintf(hrFile, "%ld\t%.1f\n", epo, hr);
-    if (r < 0) {
-        ALOGE("Could not write to heartrate-file!");
+void ovrAppRenderer::writeHR2file(float hr) {
+    // the path is set by the activity after the native app has started
+    if (!hrJournal.isOpen()) {
+        const std::string path = getAttysHRfilepath();
+        if (path.empty()) {
+            ALOGE("HR file path not set");
+            return;
+        }
+        hrJournal.setMaxSegmentSize(MAX_HR_FILESIZE);
+        if (!hrJournal.open(path)) {
+            return;
+        }
     }
-    fclose(hrFile);
+    ALOGV("Writing to HR file: %.1f", hr);
+    hrJournal.add(hr);
+}
+
+void ovrAppRenderer::flushHRfile() {
+    hrJournal.flush();
 }
@@ -24,9 +24,17 @@
 
 #include "Iir.h"
 #include "cxx-spline.h"
+#include "hr_journal.h"
+#include "triple_buffer.h"
+#include "ecg_trace.h"
+#include "hr_history.h"
+#include "hr_curve_builder.h"
+#include "wave_mesh.h"
+#include "stream_buffer.h"
 
 static const char* defaultgreeting = "Connecting to Attys";
 
+// the HR file is continued in a new segment when it gets larger
 constexpr long MAX_HR_FILESIZE = 100000000; // 100MB
 
 #define NUM_EYES 2
@@ -41,11 +49,15 @@ struct ovrUniform {
     enum Index {
         MODEL_MATRIX,
         VIEW_ID,
-        SCENE_MATRICES
+        SCENE_MATRICES,
+        RING_HEAD,
+        RING_SIZE,
+        COLUMN_FILL
     };
     enum Type {
         MATRIX4X4,
         INTEGER,
+        FLOAT,
         BUFFER
     };
 
@@ -85,6 +97,12 @@ public:
     void CreateVAO();
     void DestroyVAO();
 
+    // points the PerFrame vertex attributes of the VAO at the data at offset in buffer
+    void BindVertexBuffer(GLuint buffer, GLintptr offset);
+
+    // the vertex buffer of the scene for the geometry written every frame
+    StreamBuffer *streamBuffer = nullptr;
+
     struct VertexAttribPointer {
         std::string Name;
         GLint Index;
@@ -93,6 +111,8 @@ public:
         GLboolean Normalized;
         GLsizei Stride;
         const GLvoid *Pointer;
+        // in the buffer of BindVertexBuffer() instead of VertexBuffer
+        bool PerFrame;
     };
 
     GLuint VertexBuffer;
@@ -134,9 +154,15 @@ struct OvrHRText : OvrGeometry {
         float text2D[nPoints][2];
         unsigned char colors[nPoints][4];
     };
+    // the text written by the DSP thread and drawn by the render thread
+    struct TextMesh {
+        AxesVertices vertices;
+        unsigned short indices[nPoints];
+        int vertexCount;
+        int indexCount;
+    };
     GLuint texid = 0;
-    AxesVertices axesVertices = {};
-    unsigned short axesIndices[nPoints];
+    TripleBuffer<TextMesh> textMesh;
     void CreateGeometry();
     virtual void render(GLuint sceneMatrices);
     void add_text(const char *text,
@@ -150,20 +176,30 @@ struct OvrHRText : OvrGeometry {
 };
 
 struct OvrECGPlot : OvrGeometry {
-    static constexpr int nPoints = 500;
+    // vertex budget: columns of a min and a max vertex
+    static constexpr int maxColumns = 512;
     float offset = 0;
 
+    // the windows which are shown in turn in secs: 2 secs show every sample
+    static constexpr int nWindows = 3;
+    const int windowSecs[nWindows] = {2, 30, 300};
+    int windowIndex = 0;
+
     const OVR::Matrix4f scale = OVR::Matrix4f::Scaling(0.1, 0.1, 0.1);
     const OVR::Matrix4f translation = OVR::Matrix4f::Translation(0, -1.5, -0.9);
 
+    // the min and max values of the columns in the ring and the static
+    // colours, x is calculated by the vertex shader from the head of the ring
     struct ovrAxesVertices {
-        float positions[nPoints][3];
-        unsigned char colors[nPoints][4];
+        float y[(maxColumns + 1) * 2];
+        unsigned char colors[(maxColumns + 1) * 2][4];
     };
 
-    ovrAxesVertices axesVertices = {};
+    // written by the DSP thread, the ring is owned by the render thread
+    ECGTrace trace{maxColumns, 300 * SAMPLINGRATE};
 
-    unsigned short axesIndices[(nPoints*2)+1] = {};
+    // render thread: shows the next window
+    void nextWindow();
 
     void CreateGeometry();
     void render(GLuint sceneMatrices);
@@ -179,41 +215,37 @@ struct OvrHRPlot : OvrGeometry {
     static constexpr double minHRdiff = 10;
     static constexpr double spline_pred_sec = 1.5;
     static constexpr double maxtime = 30.0; // sec
+    static constexpr int shiftbuffersize = QUAD_GRID_SIZE * 10;
     static constexpr int NR_VERTICES = (QUAD_GRID_SIZE+1)*(QUAD_GRID_SIZE+1);
-    static constexpr int NR_TRIANGLES = 2*QUAD_GRID_SIZE*QUAD_GRID_SIZE;
-    static constexpr int NR_INDICES = 3*NR_TRIANGLES;
+    // triangle strips of the rows, separated by the restart index
+    static constexpr int NR_INDICES = QUAD_GRID_SIZE*2*(QUAD_GRID_SIZE+1) + QUAD_GRID_SIZE-1;
     static constexpr double scaleGrid = 50.0f;
     static constexpr const double deltaGrid = 2.0/(double)QUAD_GRID_SIZE;
     const OVR::Matrix4f scale = OVR::Matrix4f::Scaling(0.2, 0.1, 0.2);
     const OVR::Matrix4f translation = OVR::Matrix4f::Translation(0, -1, 0);
 
-    struct HRVertices {
-        float vertices[NR_VERTICES][3] = {};
-        float normals[NR_VERTICES][3] = {};
+    // x and z of the vertices, uploaded once
+    struct HRGrid {
+        float xz[NR_VERTICES][2] = {};
     };
 
-    struct WavesAnim {
-        const double centerX = (QUAD_GRID_SIZE+1)/2;
-        const double centerY = (QUAD_GRID_SIZE+1)/2;
-        double temporalFreq = 1;
-        const double maxr = sqrt((QUAD_GRID_SIZE) * (QUAD_GRID_SIZE));
-        double spatialFreqX = 0;
-        double spatialFreqY = 0;
-        void updateSpatialFreq(float angle, float speed) {
-            spatialFreqX = cos(angle) * speed;
-            spatialFreqY = sin(angle) * speed;
-        }
-        float calcHeight(int x, int y, double t) {
-            const double xc = ((double) x - centerX)/maxr;
-            const double yc = ((double) y - centerY)/maxr;
-            const double dx = (xc * spatialFreqX + yc * spatialFreqY);
-            return 1-fabs(sin(dx + t * temporalFreq));
-        }
+    // written every frame: the normals as GL_INT_2_10_10_10_REV and the heights as half floats
+    struct HRVertices {
+        uint32_t normals[NR_VERTICES] = {};
+        uint16_t heights[NR_VERTICES] = {};
     };
 
     float windDir = M_PI/5;
     float windSpeed = 100;
 
+    // the heights and normals of the grid: the HR history as rings around the centre plus the waves
+    static constexpr int nWaves = 3;
+    const double waveTemporalFreqs[nWaves] = {7/4.0, 4/2.0, 5/3.0};
+    static constexpr int waveMeshWorkers = 2;
+    WaveMesh waveMesh{QUAD_GRID_SIZE, scaleGrid, shiftbuffersize, waveMeshWorkers};
+    std::vector<float> hrProfile = std::vector<float>(waveMesh.getProfileLength(), 0.0f);
+
+    HRGrid hrGrid = {};
     HRVertices hrVertices = {};
 
     unsigned short indices[NR_INDICES] = {};
@@ -225,10 +257,13 @@ struct OvrHRPlot : OvrGeometry {
     std::chrono::time_point<std::chrono::steady_clock> start_fps_ts;
     double minHR = 1000;
     double maxHR = 0;
-    std::vector<double> hrBuffer;
-    std::vector<double> hrTs;
-    cubic_spline hrSpline;
-    std::mutex mtx;
+    // the spline of the last beats: built by a worker and handed to the render thread
+    HRCurveBuilder hrCurveBuilder{spline_pred_sec};
+    // render thread: the HR of the last maxtime secs
+    HRSampler hrSampler{maxtime / shiftbuffersize, shiftbuffersize};
+    double hrRangeMin = 0;
+    double hrRangeMax = 0;
+    bool hasHRRange = false;
     int dCtr = 0;
     void addHR(float hr);
 };
@@ -270,6 +305,7 @@ struct ovrScene {
     OvrECGPlot ECGPlot;
     OvrHRPlot HrPlot;
     OvrHRText HrText;
+    StreamBuffer streamBuffer;
     float ClearColor[4];
 };
 
@@ -299,7 +335,13 @@ struct ovrAppRenderer {
         hasAttys = fs > 1;
     }
 
-    void writeHR2file(float hr) const;
+    // called for every heartbeat
+    void writeHR2file(float hr);
+
+    // writes all heartrates to the storage: at session state changes
+    void flushHRfile();
+
+    HRJournal hrJournal;
 
     ovrFramebuffer Framebuffer;
     ovrScene Scene;
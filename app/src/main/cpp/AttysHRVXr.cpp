@@ -632,6 +632,9 @@ void ovrApp::HandleXrEvents() {
                         (void*)session_state_changed_event->session,
                         FromXrTime(session_state_changed_event->time));
 
+                // the app might be stopped or killed from now on
+                AppRenderer.flushHRfile();
+
                 switch (session_state_changed_event->state) {
                     case XR_SESSION_STATE_FOCUSED:
                         Focused = true;
@@ -730,6 +733,7 @@ static void app_handle_cmd(struct android_app* androidApp, int32_t cmd) {
             ALOGV("    APP_CMD_PAUSE");
             app.Env->CallStaticVoidMethod(app.nativeApplicationHandle, app.stopAttysComm);
             app.ambientAudio.stop();
+            app.AppRenderer.flushHRfile();
             app.Resumed = false;
             break;
         }
@@ -1390,6 +1394,13 @@ void android_main(struct android_app* androidApp) {
 
         input->SyncActions();
 
+        // A shows the next ECG window
+        aButtonVal = input->A();
+        if (aButtonVal && (!aPrevButtonVal) && app.AppRenderer.Scene.IsCreated()) {
+            app.AppRenderer.Scene.ECGPlot.nextWindow();
+        }
+        aPrevButtonVal = aButtonVal;
+
         // Create the scene if not yet created.
         // The scene is created here to be able to show a loading icon.
         if (!app.AppRenderer.Scene.IsCreated()) {
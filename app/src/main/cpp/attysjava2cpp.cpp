@@ -5,8 +5,18 @@
 #include "attysjava2cpp.h"
 #include "util.h"
 #include "ecg_rr_det.h"
+#include "spsc_ring.h"
+#include "chunk_recorder.h"
+#include "hrv_metrics.h"
+#include "hrv_spectrum.h"
+#include "sos_cascade.h"
 #include "Iir.h"
 
+#include <time.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
 ////////////////////////////////
 // Heartrate callback from java
 std::vector<std::function<void(float)>> attysHRCallbacks;
@@ -16,22 +26,82 @@ void registerAttysHRCallback(const std::function<void(float)> &f) {
 }
 
 
+////////////////////////////////
+// HRV callback
+std::vector<std::function<void(const HRVMetrics::Result&)>> attysHRVCallbacks;
+
+void registerAttysHRVCallback(const std::function<void(const HRVMetrics::Result&)> &f) {
+    attysHRVCallbacks.emplace_back(f);
+}
+
+// RMSSD, SDNN and pNN50 of the last minute at 60 bpm
+HRVMetrics hrvMetrics;
+
+////////////////////////////////
+// HRV spectrum callback
+std::vector<std::function<void(const HRVSpectrum::Result&)>> attysHRVSpectrumCallbacks;
+
+void registerAttysHRVSpectrumCallback(const std::function<void(const HRVSpectrum::Result&)> &f) {
+    attysHRVSpectrumCallbacks.emplace_back(f);
+}
+
+// LF, HF and the resonance frequency on its own thread
+HRVSpectrumWorker hrvSpectrum;
+
+HRVSpectrum::Result getAttysHRVSpectrum() {
+    return hrvSpectrum.getResult();
+}
+
+float attysSamplingRate = 250;
+
+// records both channels of the Attys, the beats and the sessions
+ChunkRecorder recorder;
+
+// a sample from the Attys with the time it has arrived
+struct AttysSample {
+    long sampleNumber;
+    int64_t timestampNs;
+    float v;
+    float v2;
+};
+
+// the samples the detector is working on and its input sample number of the first one
+const AttysSample *detectorBatch = nullptr;
+long detectorBatchStart = 0;
+
 class MyHRCallBack: public ECG_rr_det::RRlistener {
 public:
-    void hasRpeak(long,
+    void hasRpeak(long samplenumber,
                           float bpm,
-                          double,
-                          double) override {
-        ALOGV("HR = %f",bpm);
-        for (auto &cb: attysHRCallbacks) {
-            cb(bpm);
-        }
-    }
+                          double amplitude,
+                          double confidence) override;
 };
 
 MyHRCallBack hrCallBack;
 ECG_rr_det rrDet(&hrCallBack);
 
+void MyHRCallBack::hasRpeak(long,
+                            float bpm,
+                            double amplitude,
+                            double confidence) {
+    ALOGV("HR = %f",bpm);
+    // the Attys sample of the R peak
+    const AttysSample &sample = detectorBatch[rrDet.getInputSampleNumber() - detectorBatchStart];
+    recorder.addBeat(sample.sampleNumber, bpm, (float) amplitude, (float) confidence);
+    for (auto &cb: attysHRCallbacks) {
+        cb(bpm);
+    }
+    // the RR interval as measured by the detector: beats may have been held back before
+    if (!hrvMetrics.addRpeak(bpm, rrDet.isPreviousPeakReported())) return;
+    // on the time axis of the Attys which keeps running through artefacts and dropped samples
+    hrvSpectrum.addBeat((double) sample.sampleNumber / attysSamplingRate, hrvMetrics.getLastRR());
+    if (attysHRVCallbacks.empty()) return;
+    const HRVMetrics::Result hrv = hrvMetrics.getResult();
+    for (auto &cb: attysHRVCallbacks) {
+        cb(hrv);
+    }
+}
+
 /////////////////////////////////
 // Raw data callback from JAVA
 std::vector<std::function<void(float)>> attysDataCallbacks;
@@ -41,18 +111,141 @@ void registerAttysDataCallback(const std::function<void(float)> &f) {
     attysDataCallbacks.emplace_back(f);
 }
 
-Iir::Butterworth::BandStop<2> iirnotch;
+// the 50Hz notch: a chain of biquads so that it can start in its steady state
+SOSCascade<2> iirnotch;
+
+// state of the detector when the DSP thread has been stopped so that
+// a reconnect continues with the adaptive amplitude and heartrate
+ECG_rr_det::Snapshot detectorSnapshot;
+bool hasDetectorSnapshot = false;
+
+// set when the filters have been set up and the first sample is awaited
+bool dspWarmStartPending = false;
+
+// the first sample after a (re)start: the filters start in their steady
+// state as their old state is meaningless after the gap and the detector
+// continues with the state of the snapshot
+static void dspWarmStart(float v) {
+    iirnotch.initSteadyState(v);
+    if (hasDetectorSnapshot && rrDet.restore(detectorSnapshot)) {
+        ALOGV("Detector restored from the snapshot");
+    }
+    // the notch has unity gain at DC
+    rrDet.initSteadyState(v);
+}
+
+// 4 secs at 250Hz between the bluetooth thread and the DSP thread
+SPSCRing<AttysSample, 1024> attysSampleRing;
+
+std::thread dspThread;
+std::atomic<bool> dspRunning(false);
 
+// CLOCK_REALTIME - CLOCK_MONOTONIC to timestamp the recording
+int64_t realtimeOffsetNs = 0;
+
+static int64_t clockNs(clockid_t clock) {
+    struct timespec ts = {};
+    clock_gettime(clock, &ts);
+    return (int64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// max number of samples which are filtered and handed to the callbacks in one go
+const size_t dspBatchSize = 64;
+
+// time the DSP thread sleeps if there are no samples
+const std::chrono::milliseconds dspIdleTime(2);
+
+// filters, records and detects up to dspBatchSize samples from the ring
+// returns the number of samples, 0 if the ring is empty
+static size_t dspProcess() {
+    AttysSample samples[dspBatchSize];
+    float data[dspBatchSize];
+    const size_t n = attysSampleRing.pop(samples, dspBatchSize);
+    if (0 == n) return 0;
+    if (dspWarmStartPending) {
+        dspWarmStart(samples[0].v);
+        dspWarmStartPending = false;
+    }
+    for (size_t i = 0; i < n; i++) {
+        recorder.add(samples[i].sampleNumber,
+                     (samples[i].timestampNs + realtimeOffsetNs) / 1000000,
+                     samples[i].v, samples[i].v2);
+        data[i] = (float) iirnotch.filter(samples[i].v);
+    }
+    detectorBatch = samples;
+    detectorBatchStart = rrDet.getInputSampleNumber() + 1;
+    rrDet.detect(data, n);
+    for (auto &cb: attysDataCallbacks) {
+        for (size_t i = 0; i < n; i++) {
+            cb(data[i]);
+        }
+    }
+    return n;
+}
+
+static void dspWorker() {
+    while (dspRunning) {
+        if (0 == dspProcess()) {
+            std::this_thread::sleep_for(dspIdleTime);
+        }
+    }
+}
+
+static void startDSPthread() {
+    if (dspRunning) return;
+    realtimeOffsetNs = clockNs(CLOCK_REALTIME) - clockNs(CLOCK_MONOTONIC);
+    dspRunning = true;
+    dspThread = std::thread(dspWorker);
+}
+
+static void stopDSPthread() {
+    if (!dspRunning) return;
+    dspRunning = false;
+    dspThread.join();
+    // the samples still in the ring belong to this session: processed now
+    // so that the next session does not start its filters with them
+    while (dspProcess() > 0) {}
+    // no sample since the last start: the previous snapshot is still valid
+    if (dspWarmStartPending) return;
+    detectorSnapshot = rrDet.getSnapshot();
+    hasDetectorSnapshot = true;
+}
+
+size_t getAttysQueueHighWaterMark() {
+    return attysSampleRing.getHighWaterMark();
+}
+
+unsigned long getAttysQueueOverruns() {
+    return attysSampleRing.getOverruns();
+}
+
+// bluetooth thread: queues n samples from the direct ByteBuffer for the DSP thread
+// with one timestamp and one update of the ring
 extern "C"
 JNIEXPORT void JNICALL
-Java_tech_glasgowneuro_attyshrv_ANativeActivity_dataUpdate(JNIEnv *, jclass, jlong instance, jfloat data) {
-    data = iirnotch.filter(data);
-    rrDet.detect(data);
-    for (auto &v : attysDataCallbacks) {
-        v(data);
+Java_tech_glasgowneuro_attyshrv_ANativeActivity_dataUpdateBatch(JNIEnv *env, jclass, jlong,
+                                                                jobject buffer, jint n) {
+    const auto *src = (const AttysBufferSample *) env->GetDirectBufferAddress(buffer);
+    if ((nullptr == src) || (n <= 0)) return;
+    if ((jlong) n * (jlong) sizeof(AttysBufferSample) > env->GetDirectBufferCapacity(buffer)) {
+        ALOGE("dataUpdateBatch: %d samples do not fit into the buffer", n);
+        return;
+    }
+    const int64_t t = clockNs(CLOCK_MONOTONIC);
+    const size_t chunk = 64;
+    AttysSample samples[chunk];
+    for (size_t i = 0; i < (size_t) n; i += chunk) {
+        const size_t m = ((size_t) n - i) < chunk ? (size_t) n - i : chunk;
+        for (size_t j = 0; j < m; j++) {
+            samples[j] = {(long) src[i + j].sampleNumber, t, src[i + j].ch1, src[i + j].ch2};
+        }
+        attysSampleRing.push(samples, m);
     }
 }
 
+// file for the recording, empty if not recording
+std::string attysRawfilepath;
+
 ////////////////////////////////////////////////
 // Init callback that the Attys has been started
 std::vector<std::function<void(float)>> attysInitCallbacks;
@@ -71,8 +264,28 @@ Java_tech_glasgowneuro_attyshrv_ANativeActivity_initJava2CPP(JNIEnv *env,
         v(fs);
     }
     if (fs < 125) return;
-    iirnotch.setup(fs, 50, 2.5);
+    // the filters are only touched while the DSP thread is stopped
+    stopDSPthread();
+    Iir::Butterworth::BandStop<2> notch;
+    notch.setup(fs, 50, 2.5);
+    iirnotch.clear();
+    iirnotch.append(notch);
     rrDet.init(fs);
+    dspWarmStartPending = true;
+    hrvMetrics.reset();
+    attysSamplingRate = fs;
+    hrvSpectrum.stop();
+    hrvSpectrum.reset();
+    hrvSpectrum.setCallback([](const HRVSpectrum::Result &r) {
+        for (auto &cb: attysHRVSpectrumCallbacks) {
+            cb(r);
+        }
+    });
+    hrvSpectrum.start();
+    if (!attysRawfilepath.empty()) {
+        recorder.start(attysRawfilepath, fs);
+    }
+    startDSPthread();
 }
 
 //////////////////////////////////
@@ -94,10 +307,27 @@ Java_tech_glasgowneuro_attyshrv_ANativeActivity_setHRfilePath(JNIEnv *env, jclas
     env->ReleaseStringUTFChars(path, fnUTF);
 }
 
+extern "C"
+JNIEXPORT void JNICALL
+Java_tech_glasgowneuro_attyshrv_ANativeActivity_setRawFilePath(JNIEnv *env, jclass,
+                                                               jstring path) {
+    const char *fnUTF = env->GetStringUTFChars(path, NULL);
+    ALOGV("Raw data file: %s",fnUTF);
+    attysRawfilepath = std::string(fnUTF);
+    env->ReleaseStringUTFChars(path, fnUTF);
+}
+
 
 void unregisterAllAttysCallbacks() {
     ALOGV("Unregistering all Attys callbacks");
+    stopDSPthread();
+    hrvSpectrum.stop();
+    recorder.stop();
+    ALOGV("Sample queue: high water mark = %lu, overruns = %lu",
+          (unsigned long) getAttysQueueHighWaterMark(), getAttysQueueOverruns());
     attysHRCallbacks.clear();
+    attysHRVCallbacks.clear();
+    attysHRVSpectrumCallbacks.clear();
     attysDataCallbacks.clear();
     attysInitCallbacks.clear();
 }
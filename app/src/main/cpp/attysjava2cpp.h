@@ -6,8 +6,23 @@
 #define OCULUSECG_ATTYSJAVA2CPP_H
 
 #include <android/native_window_jni.h> // for native window JNI
+#include <stdint.h>
 #include <functional>
+#include <string>
 #include <vector>
+#include "hrv_metrics.h"
+#include "hrv_spectrum.h"
+
+/**
+ * Layout of a sample in the direct buffer of dataUpdateBatch, see ANativeActivity.java
+ */
+struct AttysBufferSample {
+    int64_t sampleNumber;
+    float ch1;
+    float ch2;
+};
+
+static_assert(sizeof(AttysBufferSample) == 16, "Must match the layout of the Java buffer.");
 
 /**
  * Registers a callback to get the raw data from channel 1
@@ -21,6 +36,25 @@ void registerAttysDataCallback(const std::function<void(float)>& f);
  */
 void registerAttysHRCallback(const std::function<void(float)>& f);
 
+/**
+ * Registers a callback to receive the heartrate variability
+ * @param f Callback with RMSSD, SDNN, pNN50 and the mean HR of the last RR intervals
+ */
+void registerAttysHRVCallback(const std::function<void(const HRVMetrics::Result&)>& f);
+
+/**
+ * Registers a callback to receive the spectrum of the heartrate variability
+ * It's called from the HRV spectrum thread after new beats once a minute of beats is there.
+ * @param f Callback with LF, HF and the peak frequency
+ */
+void registerAttysHRVSpectrumCallback(const std::function<void(const HRVSpectrum::Result&)>& f);
+
+/**
+ * Gets the latest spectrum of the heartrate variability without waiting
+ * @return LF, HF and the peak frequency, not valid during the first minute
+ */
+HRVSpectrum::Result getAttysHRVSpectrum();
+
 /**
  * Registering a callback when the Attys has been initialised or failed.
  * @param f Callback function which has the sampling rate as the argument
@@ -33,6 +67,22 @@ void registerAttysInitCallback(const std::function<void(float)> &f);
  */
 std::string getAttysHRfilepath();
 
+/**
+ * Stops the DSP thread and removes all callbacks
+ */
 void unregisterAllAttysCallbacks();
 
+/**
+ * The samples from the Attys are queued by the bluetooth thread
+ * and processed by the DSP thread which calls the data and HR callbacks.
+ * @return max number of samples which have been waiting in the queue
+ */
+size_t getAttysQueueHighWaterMark();
+
+/**
+ * Samples are dropped if the DSP thread cannot keep up.
+ * @return number of samples which have been dropped
+ */
+unsigned long getAttysQueueOverruns();
+
 #endif //OCULUSECG_ATTYSJAVA2CPP_H
@@ -0,0 +1,165 @@
+#ifndef CHUNK_FILE_H
+#define CHUNK_FILE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Chunked binary recording of the Attys: both ECG channels, the detected
+// beats and event markers. All integers are in native byte order.
+//
+// FileHeader | chunk | chunk | ... | index | Footer
+//
+// A chunk is a ChunkHeader followed by count records of its type which
+// can be compressed losslessly (samples only, see ecg_codec.h). The
+// header has the range of sample numbers and the time range of the records
+// so that a chunk can be found without reading its records. The samples of a
+// chunk have consecutive sample numbers and are evenly spaced between the
+// start and end time. A gap in the sample numbers starts a new chunk.
+//
+// The index at the end has one IndexEntry per chunk in file order and is
+// written when the recording stops. If it is missing because the app has
+// been killed the chunks are found by following the chunk headers up to the
+// first incomplete chunk. A new session truncates the index and appends its
+// chunks.
+struct ChunkFile {
+
+    static constexpr char magic[9] = "ATTYSCHK";
+
+    static constexpr char chunkMagic[5] = "CHNK";
+
+    static constexpr char indexMagic[9] = "ATTYSIDX";
+
+    static constexpr uint32_t version = 1;
+
+    enum ChunkType : uint32_t {
+        Samples = 1,
+        Beats = 2,
+        Events = 3
+    };
+
+    static constexpr int nChunkTypes = 3;
+
+    enum Encoding : uint32_t {
+        // count records of the type
+        Raw = 0,
+        // samples: channel 1 and then channel 2 as blocks of the ECGCodec
+        Compressed = 1
+    };
+
+    enum EventCode : uint32_t {
+        SessionStart = 1,
+        SessionStop = 2,
+        // samples are missing: value is the number of samples
+        DroppedSamples = 3,
+        // set by the user
+        Marker = 4
+    };
+
+    struct FileHeader {
+        char magic[8];
+        uint32_t version;
+        // sampling rate of the first session
+        float fs;
+        // ms since the epoch when the file has been created
+        int64_t createdMs;
+        uint8_t reserved[40];
+    };
+
+    struct ChunkHeader {
+        char magic[4];
+        uint32_t type;
+        // number of records
+        uint32_t count;
+        // size of the records in bytes
+        uint32_t payloadSize;
+        int64_t firstSampleNumber;
+        int64_t lastSampleNumber;
+        // ms since the epoch of the first and last record
+        int64_t startMs;
+        int64_t endMs;
+        float fs;
+        // FNV-1a of the records
+        uint32_t checksum;
+        uint32_t encoding;
+        uint8_t reserved[4];
+    };
+
+    struct SampleRecord {
+        float ch1;
+        float ch2;
+    };
+
+    struct BeatRecord {
+        int64_t sampleNumber;
+        int64_t timestampMs;
+        float bpm;
+        // as reported by ECG_rr_det::RRlistener::hasRpeak
+        float amplitude;
+        float confidence;
+        uint32_t reserved;
+    };
+
+    struct EventRecord {
+        // -1 if the event is not at a sample
+        int64_t sampleNumber;
+        int64_t timestampMs;
+        uint32_t code;
+        int32_t value;
+    };
+
+    struct IndexEntry {
+        // file offset of the chunk header
+        uint64_t offset;
+        uint32_t type;
+        uint32_t count;
+        int64_t firstSampleNumber;
+        int64_t lastSampleNumber;
+        int64_t startMs;
+        int64_t endMs;
+    };
+
+    struct Footer {
+        char magic[8];
+        uint64_t indexOffset;
+        uint64_t nEntries;
+        uint64_t reserved;
+    };
+
+    // size of a record of the chunk type, 0 if the type is unknown
+    static size_t recordSize(uint32_t type) {
+        switch (type) {
+            case Samples:
+                return sizeof(SampleRecord);
+            case Beats:
+                return sizeof(BeatRecord);
+            case Events:
+                return sizeof(EventRecord);
+            default:
+                return 0;
+        }
+    }
+
+    static uint32_t checksum(const void *data, size_t n) {
+        const uint8_t *p = (const uint8_t *) data;
+        uint32_t h = 2166136261u;
+        for (size_t i = 0; i < n; i++) {
+            h = (h ^ p[i]) * 16777619u;
+        }
+        return h;
+    }
+
+    // time of sample i of a samples chunk in ms since the epoch
+    static int64_t sampleTimeMs(const IndexEntry &e, size_t i) {
+        if (e.count < 2) return e.startMs;
+        return e.startMs + (e.endMs - e.startMs) * (int64_t) i / (int64_t) (e.count - 1);
+    }
+};
+
+static_assert(sizeof(ChunkFile::FileHeader) == 64, "The file header must have 64 bytes.");
+static_assert(sizeof(ChunkFile::ChunkHeader) == 64, "The chunk header must have 64 bytes.");
+static_assert(sizeof(ChunkFile::BeatRecord) == 32, "A beat must have 32 bytes.");
+static_assert(sizeof(ChunkFile::EventRecord) == 24, "An event must have 24 bytes.");
+static_assert(sizeof(ChunkFile::IndexEntry) == 48, "An index entry must have 48 bytes.");
+static_assert(sizeof(ChunkFile::Footer) == 32, "The footer must have 32 bytes.");
+
+#endif
@@ -0,0 +1,179 @@
+#include "chunk_reader.h"
+#include "ecg_codec.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <algorithm>
+
+constexpr char ChunkFile::magic[9];
+constexpr char ChunkFile::chunkMagic[5];
+constexpr char ChunkFile::indexMagic[9];
+
+bool ChunkReader::open(const std::string &filename) {
+    close();
+    fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if ((fstat(fd, &st) != 0) || ((size_t) st.st_size < sizeof(ChunkFile::FileHeader))) {
+        close();
+        return false;
+    }
+    size = (size_t) st.st_size;
+    void *p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (MAP_FAILED == p) {
+        size = 0;
+        close();
+        return false;
+    }
+    data = (const uint8_t *) p;
+    ChunkFile::FileHeader header;
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, ChunkFile::magic, sizeof(header.magic)) != 0) {
+        close();
+        return false;
+    }
+    fs = header.fs;
+    footer = readFooter();
+    if (!footer) {
+        scanChunks();
+    }
+    for (auto &e: index) {
+        chunks[e.type - 1].push_back(e);
+    }
+    // sessions are appended in time order unless the clock has been changed
+    for (auto &c: chunks) {
+        std::stable_sort(c.begin(), c.end(),
+                         [](const ChunkFile::IndexEntry &a, const ChunkFile::IndexEntry &b) {
+                             return a.startMs < b.startMs;
+                         });
+    }
+    return true;
+}
+
+void ChunkReader::close() {
+    if (data) {
+        munmap((void *) data, size);
+        data = nullptr;
+    }
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+    size = 0;
+    endOfChunks = 0;
+    footer = false;
+    index.clear();
+    for (auto &c: chunks) {
+        c.clear();
+    }
+}
+
+bool ChunkReader::isChunk(size_t offset, bool checkRecords) const {
+    if ((offset + sizeof(ChunkFile::ChunkHeader)) > size) return false;
+    const auto *h = (const ChunkFile::ChunkHeader *) (data + offset);
+    if (memcmp(h->magic, ChunkFile::chunkMagic, sizeof(h->magic)) != 0) return false;
+    const size_t recordSize = ChunkFile::recordSize(h->type);
+    if (0 == recordSize) return false;
+    if (ChunkFile::Compressed == h->encoding) {
+        if ((ChunkFile::Samples != h->type) ||
+            (h->payloadSize > 2 * ECGCodec::maxEncodedSize(h->count))) {
+            return false;
+        }
+    } else if ((ChunkFile::Raw != h->encoding) || (h->payloadSize != (size_t) h->count * recordSize)) {
+        return false;
+    }
+    if ((offset + sizeof(ChunkFile::ChunkHeader) + h->payloadSize) > size) return false;
+    if (!checkRecords) return true;
+    return ChunkFile::checksum(h + 1, h->payloadSize) == h->checksum;
+}
+
+bool ChunkReader::readFooter() {
+    const size_t minSize = sizeof(ChunkFile::FileHeader) + sizeof(ChunkFile::Footer);
+    if (size < minSize) return false;
+    ChunkFile::Footer f;
+    memcpy(&f, data + size - sizeof(f), sizeof(f));
+    if (memcmp(f.magic, ChunkFile::indexMagic, sizeof(f.magic)) != 0) return false;
+    // a corrupt footer must not wrap the size of the index
+    if ((f.nEntries > (size - sizeof(f)) / sizeof(ChunkFile::IndexEntry)) ||
+        (f.indexOffset > size)) {
+        return false;
+    }
+    if ((f.indexOffset < sizeof(ChunkFile::FileHeader)) ||
+        ((f.indexOffset + f.nEntries * sizeof(ChunkFile::IndexEntry) + sizeof(f)) != size)) {
+        return false;
+    }
+    index.resize(f.nEntries);
+    memcpy(index.data(), data + f.indexOffset, f.nEntries * sizeof(ChunkFile::IndexEntry));
+    // an index which does not match the chunk headers is rebuilt by scanChunks()
+    for (auto &e: index) {
+        if ((e.offset >= f.indexOffset) || (!isChunk(e.offset, false))) {
+            index.clear();
+            return false;
+        }
+        const ChunkFile::ChunkHeader *h = getHeader(e);
+        if ((h->type != e.type) || (h->count != e.count) ||
+            (h->firstSampleNumber != e.firstSampleNumber) || (h->lastSampleNumber != e.lastSampleNumber) ||
+            (h->startMs != e.startMs) || (h->endMs != e.endMs)) {
+            index.clear();
+            return false;
+        }
+    }
+    endOfChunks = f.indexOffset;
+    return true;
+}
+
+void ChunkReader::scanChunks() {
+    index.clear();
+    size_t offset = sizeof(ChunkFile::FileHeader);
+    // the last chunk may have been written partially
+    while (isChunk(offset, true)) {
+        const auto *h = (const ChunkFile::ChunkHeader *) (data + offset);
+        index.push_back({offset, h->type, h->count,
+                         h->firstSampleNumber, h->lastSampleNumber,
+                         h->startMs, h->endMs});
+        offset += sizeof(ChunkFile::ChunkHeader) + h->payloadSize;
+    }
+    endOfChunks = offset;
+}
+
+const std::vector<ChunkFile::IndexEntry> &ChunkReader::getChunks(uint32_t type) const {
+    static const std::vector<ChunkFile::IndexEntry> none;
+    if ((type < 1) || (type > ChunkFile::nChunkTypes)) return none;
+    return chunks[type - 1];
+}
+
+std::pair<size_t, size_t> ChunkReader::findChunks(uint32_t type, int64_t fromMs, int64_t toMs) const {
+    const auto &c = getChunks(type);
+    // the first chunk which ends at or after fromMs
+    const auto first = std::lower_bound(c.begin(), c.end(), fromMs,
+                                        [](const ChunkFile::IndexEntry &e, int64_t t) {
+                                            return e.endMs < t;
+                                        });
+    // the first chunk which starts after toMs
+    const auto last = std::upper_bound(first, c.end(), toMs,
+                                       [](int64_t t, const ChunkFile::IndexEntry &e) {
+                                           return t < e.startMs;
+                                       });
+    return {(size_t) (first - c.begin()), (size_t) (last - c.begin())};
+}
+
+bool ChunkReader::readSamples(const ChunkFile::IndexEntry &e, ChunkFile::SampleRecord *samples) const {
+    if (ChunkFile::Samples != e.type) return false;
+    const ChunkFile::ChunkHeader *h = getHeader(e);
+    if (ChunkFile::Raw == h->encoding) {
+        memcpy(samples, getRecords<ChunkFile::SampleRecord>(e), e.count * sizeof(ChunkFile::SampleRecord));
+        return true;
+    }
+    const uint8_t *p = getRecords<uint8_t>(e);
+    const size_t n1 = ECGCodec::decode(p, h->payloadSize, &samples[0].ch1, e.count, 2);
+    if (0 == n1) return false;
+    const size_t n2 = ECGCodec::decode(p + n1, h->payloadSize - n1, &samples[0].ch2, e.count, 2);
+    return (n1 + n2) == h->payloadSize;
+}
+
+bool ChunkReader::verify(const ChunkFile::IndexEntry &e) const {
+    return isChunk(e.offset, true);
+}
@@ -0,0 +1,95 @@
+#ifndef CHUNK_READER_H
+#define CHUNK_READER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "chunk_file.h"
+
+// Reads a chunked recording (see chunk_file.h) which is memory mapped. The
+// index is taken from the footer or, if the recording has not been closed,
+// rebuilt from the chunk headers. The chunks of every type are in time order
+// so that the chunks of a time range are found with a binary search.
+class ChunkReader {
+
+public:
+    ~ChunkReader() {
+        close();
+    }
+
+    // returns false if the file cannot be mapped or is not a chunked recording
+    bool open(const std::string &filename);
+
+    void close();
+
+    // true if the index has been read from the footer
+    bool hasFooter() const {
+        return footer;
+    }
+
+    // sampling rate of the first session
+    float getSamplingRate() const {
+        return fs;
+    }
+
+    // all chunks in file order
+    const std::vector<ChunkFile::IndexEntry> &getIndex() const {
+        return index;
+    }
+
+    // the chunks of one type in time order
+    const std::vector<ChunkFile::IndexEntry> &getChunks(uint32_t type) const;
+
+    // the chunks of the type which have records between fromMs and toMs:
+    // [first, second) of getChunks(type)
+    std::pair<size_t, size_t> findChunks(uint32_t type, int64_t fromMs, int64_t toMs) const;
+
+    const ChunkFile::ChunkHeader *getHeader(const ChunkFile::IndexEntry &e) const {
+        return (const ChunkFile::ChunkHeader *) (data + e.offset);
+    }
+
+    // the samples of a chunk decoded into count records
+    // returns false if the chunk is corrupt
+    bool readSamples(const ChunkFile::IndexEntry &e, ChunkFile::SampleRecord *samples) const;
+
+    // the records of an uncompressed chunk: SampleRecord, BeatRecord or EventRecord
+    template<typename T>
+    const T *getRecords(const ChunkFile::IndexEntry &e) const {
+        return (const T *) (data + e.offset + sizeof(ChunkFile::ChunkHeader));
+    }
+
+    // checks the checksum of the records of a chunk
+    bool verify(const ChunkFile::IndexEntry &e) const;
+
+    // file offset after the last complete chunk: a new session starts here
+    size_t getEndOfChunks() const {
+        return endOfChunks;
+    }
+
+    size_t getFileSize() const {
+        return size;
+    }
+
+private:
+    bool readFooter();
+
+    void scanChunks();
+
+    // true if a complete chunk is at offset
+    bool isChunk(size_t offset, bool checkRecords) const;
+
+    int fd = -1;
+    const uint8_t *data = nullptr;
+    size_t size = 0;
+    float fs = 0;
+    bool footer = false;
+    size_t endOfChunks = 0;
+
+    std::vector<ChunkFile::IndexEntry> index;
+    std::vector<ChunkFile::IndexEntry> chunks[ChunkFile::nChunkTypes];
+};
+
+#endif
@@ -0,0 +1,281 @@
+#include "chunk_recorder.h"
+#include "chunk_reader.h"
+#include "util.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <chrono>
+
+static int64_t nowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+ChunkRecorder::~ChunkRecorder() {
+    stop();
+}
+
+bool ChunkRecorder::start(const std::string &filename, float samplingRate) {
+    if (fd >= 0) {
+        // a reconnect while recording: the chunks so far keep the previous
+        // sampling rate and a new session starts in the same file
+        sync();
+        fs = samplingRate;
+        addEventAt(-1, nowMs(), ChunkFile::SessionStart, (int32_t) fs);
+        return true;
+    }
+    fs = samplingRate;
+    fd = open(filename.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        ALOGE("Could not open the recording %s", filename.c_str());
+        return false;
+    }
+    struct stat st = {};
+    fstat(fd, &st);
+    index.clear();
+    if (0 == st.st_size) {
+        ChunkFile::FileHeader header = {};
+        memcpy(header.magic, ChunkFile::magic, sizeof(header.magic));
+        header.version = ChunkFile::version;
+        header.fs = fs;
+        header.createdMs = nowMs();
+        if (!writeAt(&header, sizeof(header), 0)) {
+            close(fd);
+            fd = -1;
+            return false;
+        }
+        fileOffset = sizeof(header);
+    } else {
+        // appends after the last complete chunk of the previous sessions
+        ChunkReader reader;
+        if (!reader.open(filename)) {
+            ALOGE("%s is not a chunked recording", filename.c_str());
+            close(fd);
+            fd = -1;
+            return false;
+        }
+        index = reader.getIndex();
+        fileOffset = reader.getEndOfChunks();
+        reader.close();
+        if (ftruncate(fd, (off_t) fileOffset) != 0) {
+            ALOGE("Could not remove the index of %s", filename.c_str());
+        }
+    }
+
+    const size_t capacity = std::max(samplesPerChunk * sizeof(ChunkFile::SampleRecord),
+                                     std::max(beatsPerChunk * sizeof(ChunkFile::BeatRecord),
+                                              eventsPerChunk * sizeof(ChunkFile::EventRecord)));
+    if (compression) {
+        codec = ECGCodec(samplesPerChunk);
+        encoded.resize(2 * ECGCodec::maxEncodedSize(samplesPerChunk));
+    }
+    sampleBytes = 0;
+    compressedSampleBytes = 0;
+    pool.resize(nChunks);
+    freeChunks.clear();
+    freeChunks.reserve(nChunks);
+    queue.clear();
+    queue.reserve(nChunks);
+    for (auto &c: pool) {
+        c.records.resize(capacity);
+        freeChunks.push_back(&c);
+    }
+    for (uint32_t type = 1; type <= ChunkFile::nChunkTypes; type++) {
+        Chunk *c = freeChunks.back();
+        freeChunks.pop_back();
+        c->header = {};
+        c->header.type = type;
+        active[type - 1] = c;
+    }
+    hasSamples = false;
+    lastSampleNumber = 0;
+    lastTimestampMs = 0;
+    writing = false;
+    running = true;
+    writerThread = std::thread(&ChunkRecorder::writer, this);
+    addEventAt(-1, nowMs(), ChunkFile::SessionStart, (int32_t) fs);
+    ALOGV("Recording to %s at offset %ld", filename.c_str(), (long) fileOffset);
+    return true;
+}
+
+int64_t ChunkRecorder::timeOfSample(int64_t sampleNumber) const {
+    if (!hasSamples) return nowMs();
+    return lastTimestampMs - (int64_t) ((double) (lastSampleNumber - sampleNumber) * 1000.0 / fs);
+}
+
+void ChunkRecorder::append(uint32_t type, const void *record, int64_t sampleNumber, int64_t timestampMs) {
+    Chunk *c = active[type - 1];
+    const size_t recordSize = ChunkFile::recordSize(type);
+    memcpy(c->records.data() + c->header.count * recordSize, record, recordSize);
+    if (0 == c->header.count) {
+        c->header.firstSampleNumber = sampleNumber;
+        c->header.startMs = timestampMs;
+    }
+    c->header.count++;
+    c->header.lastSampleNumber = sampleNumber;
+    c->header.endMs = timestampMs;
+    const size_t maxRecords = ChunkFile::Beats == type ? beatsPerChunk : eventsPerChunk;
+    if (c->header.count == maxRecords) {
+        handOver(type, false);
+    }
+}
+
+void ChunkRecorder::addBeat(int64_t sampleNumber, float bpm, float amplitude, float confidence) {
+    if (fd < 0) return;
+    addBeat(sampleNumber, timeOfSample(sampleNumber), bpm, amplitude, confidence);
+}
+
+void ChunkRecorder::addBeat(int64_t sampleNumber, int64_t timestampMs, float bpm, float amplitude, float confidence) {
+    if (fd < 0) return;
+    const ChunkFile::BeatRecord r = {sampleNumber, timestampMs, bpm, amplitude, confidence, 0};
+    append(ChunkFile::Beats, &r, sampleNumber, timestampMs);
+}
+
+void ChunkRecorder::addEvent(uint32_t code, int32_t value) {
+    if (fd < 0) return;
+    if (hasSamples) {
+        addEventAt(lastSampleNumber, lastTimestampMs, code, value);
+    } else {
+        addEventAt(-1, nowMs(), code, value);
+    }
+}
+
+void ChunkRecorder::addEventAt(int64_t sampleNumber, int64_t timestampMs, uint32_t code, int32_t value) {
+    const ChunkFile::EventRecord r = {sampleNumber, timestampMs, code, value};
+    append(ChunkFile::Events, &r, sampleNumber, timestampMs);
+}
+
+void ChunkRecorder::newSegment(int64_t sampleNumber, int64_t timestampMs) {
+    if (active[ChunkFile::Samples - 1]->header.count > 0) {
+        handOver(ChunkFile::Samples, false);
+    }
+    if (sampleNumber > (lastSampleNumber + 1)) {
+        addEventAt(sampleNumber, timestampMs, ChunkFile::DroppedSamples,
+                   (int32_t) (sampleNumber - lastSampleNumber - 1));
+    }
+}
+
+void ChunkRecorder::handOver(uint32_t type, bool sync) {
+    std::unique_lock<std::mutex> lock(mtx);
+    Chunk *c = active[type - 1];
+    if (freeChunks.empty()) {
+        // the writer is too far behind
+        droppedChunks++;
+        c->header.count = 0;
+        return;
+    }
+    c->sync = sync;
+    // stamped here as start() changes fs on the thread which adds the records
+    c->header.fs = fs;
+    queue.push_back(c);
+    Chunk *next = freeChunks.back();
+    freeChunks.pop_back();
+    next->header = {};
+    next->header.type = type;
+    active[type - 1] = next;
+    cv.notify_all();
+}
+
+void ChunkRecorder::sync() {
+    uint32_t last = 0;
+    for (uint32_t type = 1; type <= ChunkFile::nChunkTypes; type++) {
+        if (active[type - 1]->header.count > 0) last = type;
+    }
+    for (uint32_t type = 1; type <= last; type++) {
+        if (active[type - 1]->header.count > 0) {
+            handOver(type, type == last);
+        }
+    }
+}
+
+bool ChunkRecorder::writeAt(const void *p, size_t n, uint64_t offset) {
+    size_t k = 0;
+    while (k < n) {
+        const ssize_t r = pwrite(fd, (const char *) p + k, n - k, (off_t) (offset + k));
+        if (r <= 0) {
+            ALOGE("Could not write the recording at offset %ld", (long) offset);
+            return false;
+        }
+        k += (size_t) r;
+    }
+    return true;
+}
+
+void ChunkRecorder::writer() {
+    std::unique_lock<std::mutex> lock(mtx);
+    for (;;) {
+        cv.wait(lock, [this] { return (!queue.empty()) || (!running); });
+        if (queue.empty()) return;
+        Chunk *c = queue.front();
+        queue.erase(queue.begin());
+        writing = true;
+        lock.unlock();
+        ChunkFile::ChunkHeader &h = c->header;
+        memcpy(h.magic, ChunkFile::chunkMagic, sizeof(h.magic));
+        h.payloadSize = h.count * (uint32_t) ChunkFile::recordSize(h.type);
+        const uint8_t *payload = c->records.data();
+        if (compression && (ChunkFile::Samples == h.type)) {
+            const auto *samples = (const ChunkFile::SampleRecord *) c->records.data();
+            const size_t n1 = codec.encode(&samples[0].ch1, h.count, 2, encoded.data());
+            const size_t n2 = codec.encode(&samples[0].ch2, h.count, 2, encoded.data() + n1);
+            sampleBytes += h.payloadSize;
+            h.encoding = ChunkFile::Compressed;
+            h.payloadSize = (uint32_t) (n1 + n2);
+            compressedSampleBytes += h.payloadSize;
+            payload = encoded.data();
+        }
+        h.checksum = ChunkFile::checksum(payload, h.payloadSize);
+        if (writeAt(&h, sizeof(h), fileOffset) &&
+            writeAt(payload, h.payloadSize, fileOffset + sizeof(h))) {
+            index.push_back({fileOffset, h.type, h.count,
+                             h.firstSampleNumber, h.lastSampleNumber,
+                             h.startMs, h.endMs});
+            fileOffset += sizeof(h) + h.payloadSize;
+            chunksWritten++;
+        }
+        if (c->sync) {
+            fdatasync(fd);
+        }
+        lock.lock();
+        freeChunks.push_back(c);
+        writing = false;
+        cv.notify_all();
+    }
+}
+
+void ChunkRecorder::waitForWriter() {
+    std::unique_lock<std::mutex> lock(mtx);
+    cv.wait(lock, [this] { return queue.empty() && (!writing); });
+}
+
+void ChunkRecorder::stop() {
+    if (fd < 0) return;
+    addEvent(ChunkFile::SessionStop);
+    waitForWriter();
+    sync();
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        cv.wait(lock, [this] { return queue.empty() && (!writing); });
+        running = false;
+        cv.notify_all();
+    }
+    writerThread.join();
+    ChunkFile::Footer footer = {};
+    memcpy(footer.magic, ChunkFile::indexMagic, sizeof(footer.magic));
+    footer.indexOffset = fileOffset;
+    footer.nEntries = index.size();
+    const size_t indexSize = index.size() * sizeof(ChunkFile::IndexEntry);
+    if ((!writeAt(index.data(), indexSize, fileOffset)) ||
+        (!writeAt(&footer, sizeof(footer), fileOffset + indexSize))) {
+        ALOGE("Could not write the index of the recording");
+    }
+    fdatasync(fd);
+    close(fd);
+    fd = -1;
+    ALOGV("Recording stopped: %lu chunks written, %lu chunks dropped, samples compressed to %ld of %ld bytes",
+          chunksWritten.load(), droppedChunks.load(),
+          (long) compressedSampleBytes.load(), (long) sampleBytes.load());
+}
@@ -0,0 +1,207 @@
+#ifndef CHUNK_RECORDER_H
+#define CHUNK_RECORDER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "chunk_file.h"
+#include "ecg_codec.h"
+
+// Records the samples, beats and events of the Attys into a chunked
+// recording (see chunk_file.h) without blocking the DSP thread. The records
+// are collected in preallocated chunks. A full chunk is handed to a
+// background thread which compresses the samples and writes the chunk while
+// the next one is filled. At every
+// sync interval the partially filled chunks are handed over as well and the
+// file is synced. stop() writes the index and the footer. If the file
+// exists the new session is appended to it.
+class ChunkRecorder {
+
+public:
+    ~ChunkRecorder();
+
+    // opens the file and starts the writer thread
+    // returns false if the file cannot be opened or is not a chunked recording
+    // If it is already recording a new session with the sampling rate fs
+    // starts in the open file.
+    bool start(const std::string &filename, float fs);
+
+    // writes the remaining chunks, the index and the footer and closes the file
+    void stop();
+
+    bool isRecording() const {
+        return fd >= 0;
+    }
+
+    // the interval at which the data is synced to the storage: 0 = only at stop()
+    void setSyncInterval(int64_t ms) {
+        syncIntervalMs = ms;
+    }
+
+    // samples per chunk: set before start()
+    void setSamplesPerChunk(size_t n) {
+        samplesPerChunk = n > 0 ? (n < ECGCodec::maxBlockSize ? n : ECGCodec::maxBlockSize) : 1;
+    }
+
+    size_t getSamplesPerChunk() const {
+        return samplesPerChunk;
+    }
+
+    // lossless compression of the samples by the writer thread: set before start()
+    void setCompression(bool c) {
+        compression = c;
+    }
+
+    // bytes of samples before and after the compression
+    uint64_t getSampleBytes() const {
+        return sampleBytes;
+    }
+
+    uint64_t getCompressedSampleBytes() const {
+        return compressedSampleBytes;
+    }
+
+    // The add functions are called by one thread, usually the DSP thread.
+    // A sample with its number from the Attys and the time in ms since the epoch.
+    inline void add(int64_t sampleNumber, int64_t timestampMs, float ch1, float ch2) {
+        if (fd < 0) return;
+        Chunk *c = active[ChunkFile::Samples - 1];
+        // also at the start of a new chunk
+        if (hasSamples && (sampleNumber != (lastSampleNumber + 1))) {
+            newSegment(sampleNumber, timestampMs);
+            c = active[ChunkFile::Samples - 1];
+        }
+        ChunkFile::SampleRecord *r = (ChunkFile::SampleRecord *) c->records.data() + c->header.count;
+        r->ch1 = ch1;
+        r->ch2 = ch2;
+        if (0 == c->header.count) {
+            c->header.firstSampleNumber = sampleNumber;
+            c->header.startMs = timestampMs;
+        }
+        c->header.count++;
+        c->header.lastSampleNumber = sampleNumber;
+        c->header.endMs = timestampMs;
+        lastSampleNumber = sampleNumber;
+        lastTimestampMs = timestampMs;
+        if (!hasSamples) {
+            lastSyncMs = timestampMs;
+            hasSamples = true;
+        }
+        if (c->header.count == samplesPerChunk) {
+            handOver(ChunkFile::Samples, false);
+        }
+        if ((syncIntervalMs > 0) && ((timestampMs - lastSyncMs) >= syncIntervalMs)) {
+            lastSyncMs = timestampMs;
+            sync();
+        }
+    }
+
+    // a beat at a sample number which has been added: its time is
+    // calculated from the sample number
+    void addBeat(int64_t sampleNumber, float bpm, float amplitude, float confidence);
+
+    // a beat at a known time in ms since the epoch
+    void addBeat(int64_t sampleNumber, int64_t timestampMs, float bpm, float amplitude, float confidence);
+
+    // an event at the last sample added or at the current time if there is none
+    void addEvent(uint32_t code, int32_t value = 0);
+
+    // blocks until the writer thread has written all chunks handed over
+    void waitForWriter();
+
+    // chunks which have been dropped because the writer was too slow
+    unsigned long getDroppedChunks() const {
+        return droppedChunks;
+    }
+
+    unsigned long getChunksWritten() const {
+        return chunksWritten;
+    }
+
+    // beats and events per chunk
+    static constexpr size_t beatsPerChunk = 128;
+    static constexpr size_t eventsPerChunk = 64;
+
+    // chunks in the pool
+    static constexpr size_t nChunks = 8;
+
+private:
+    struct Chunk {
+        ChunkFile::ChunkHeader header;
+        std::vector<uint8_t> records;
+        // the file is synced after this chunk
+        bool sync;
+    };
+
+    // time of a sample number in ms since the epoch from the last sample
+    int64_t timeOfSample(int64_t sampleNumber) const;
+
+    // the sample numbers do not continue: starts a new chunk
+    void newSegment(int64_t sampleNumber, int64_t timestampMs);
+
+    void addEventAt(int64_t sampleNumber, int64_t timestampMs, uint32_t code, int32_t value);
+
+    // appends a record to the active chunk of the type
+    void append(uint32_t type, const void *record, int64_t sampleNumber, int64_t timestampMs);
+
+    // hands the active chunk of the type to the writer and takes a new one
+    void handOver(uint32_t type, bool sync);
+
+    // hands all chunks with records to the writer, the file is synced after the last
+    void sync();
+
+    void writer();
+
+    // writes n bytes at offset, returns false on error
+    bool writeAt(const void *p, size_t n, uint64_t offset);
+
+    int fd = -1;
+    float fs = 250;
+
+    size_t samplesPerChunk = 4096;
+
+    bool compression = true;
+    ECGCodec codec;
+    std::vector<uint8_t> encoded;
+
+    std::vector<Chunk> pool;
+
+    // the chunks which are being filled for every type
+    Chunk *active[ChunkFile::nChunkTypes] = {};
+
+    int64_t lastSampleNumber = 0;
+    int64_t lastTimestampMs = 0;
+    bool hasSamples = false;
+
+    int64_t syncIntervalMs = 10000;
+    int64_t lastSyncMs = 0;
+
+    std::thread writerThread;
+    std::mutex mtx;
+    std::condition_variable cv;
+    bool running = false;
+
+    // chunks waiting for the writer and free chunks
+    std::vector<Chunk *> queue;
+    std::vector<Chunk *> freeChunks;
+    // true while the writer is writing a chunk
+    bool writing = false;
+
+    // owned by the writer thread while it runs
+    uint64_t fileOffset = 0;
+    std::vector<ChunkFile::IndexEntry> index;
+
+    std::atomic<uint64_t> sampleBytes{0};
+    std::atomic<uint64_t> compressedSampleBytes{0};
+
+    std::atomic<unsigned long> droppedChunks{0};
+    std::atomic<unsigned long> chunksWritten{0};
+};
+
+#endif
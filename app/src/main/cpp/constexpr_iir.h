@@ -0,0 +1,174 @@
+#ifndef CONSTEXPR_IIR_H
+#define CONSTEXPR_IIR_H
+
+#include <stddef.h>
+#include <array>
+
+// Butterworth filter designs which are evaluated at compile time so that
+// the coefficients can be folded into the code. The designs follow the
+// ones of the Iir library: analogue prototype, frequency transformation
+// and bilinear transform. The coefficients are identical to the
+// Iir designs within the rounding of the double arithmetic.
+namespace ConstexprIir {
+
+    constexpr double pi = 3.14159265358979323846;
+
+    constexpr double sqrt(double x) {
+        if (x <= 0) return 0;
+        double r = x < 1 ? 1 : x;
+        for (int i = 0; i < 100; i++) {
+            const double next = 0.5 * (r + x / r);
+            if (next == r) break;
+            r = next;
+        }
+        return r;
+    }
+
+    // Taylor series after reducing x to -pi..pi
+    constexpr double sin(double x) {
+        while (x > pi) x -= 2 * pi;
+        while (x < -pi) x += 2 * pi;
+        double term = x;
+        double sum = x;
+        for (int i = 1; i < 30; i++) {
+            term = -term * x * x / ((2 * i) * (2 * i + 1));
+            sum += term;
+        }
+        return sum;
+    }
+
+    constexpr double cos(double x) {
+        return sin(x + pi / 2);
+    }
+
+    constexpr double tan(double x) {
+        return sin(x) / cos(x);
+    }
+
+    struct Complex {
+        double re = 0;
+        double im = 0;
+
+        constexpr Complex operator+(const Complex &b) const {
+            return {re + b.re, im + b.im};
+        }
+
+        constexpr Complex operator-(const Complex &b) const {
+            return {re - b.re, im - b.im};
+        }
+
+        constexpr Complex operator*(const Complex &b) const {
+            return {re * b.re - im * b.im, re * b.im + im * b.re};
+        }
+
+        constexpr Complex operator/(const Complex &b) const {
+            const double d = b.re * b.re + b.im * b.im;
+            return {(re * b.re + im * b.im) / d, (im * b.re - re * b.im) / d};
+        }
+
+        constexpr double norm() const {
+            return re * re + im * im;
+        }
+    };
+
+    constexpr Complex csqrt(const Complex &z) {
+        const double r = sqrt(z.norm());
+        const double re = sqrt((r + z.re) / 2);
+        const double im = sqrt((r - z.re) / 2);
+        return {re, z.im < 0 ? -im : im};
+    }
+
+    // a biquad with a0 = 1
+    struct Biquad {
+        double b0 = 1;
+        double b1 = 0;
+        double b2 = 0;
+        double a1 = 0;
+        double a2 = 0;
+    };
+
+    // prewarped analogue frequency of f for the bilinear transform
+    constexpr double warp(double fs, double f) {
+        return 2 * tan(pi * f / fs);
+    }
+
+    constexpr Complex bilinear(const Complex &s) {
+        return Complex{2 + s.re, s.im} / Complex{2 - s.re, -s.im};
+    }
+
+    // pole k of the analogue Butterworth lowpass prototype in the upper half plane
+    constexpr Complex prototypePole(int order, int k) {
+        const double theta = pi * (2 * k + order + 1) / (2 * order);
+        return {cos(theta), sin(theta)};
+    }
+
+    // biquad with the pole p and its complex conjugate
+    constexpr Biquad fromPole(const Complex &p, double b0, double b1, double b2) {
+        return {b0, b1, b2, -2 * p.re, p.norm()};
+    }
+
+    // scales the numerator of the first biquad so that |H(z)| = 1
+    template<size_t n>
+    constexpr void normalise(std::array<Biquad, n> &biquads, const Complex &z) {
+        const Complex zi = Complex{1, 0} / z;
+        const Complex zi2 = zi * zi;
+        Complex h{1, 0};
+        for (const Biquad &b: biquads) {
+            const Complex num = Complex{b.b0, 0} + Complex{b.b1, 0} * zi + Complex{b.b2, 0} * zi2;
+            const Complex den = Complex{1, 0} + Complex{b.a1, 0} * zi + Complex{b.a2, 0} * zi2;
+            h = h * num / den;
+        }
+        const double g = 1 / sqrt(h.norm());
+        biquads[0].b0 *= g;
+        biquads[0].b1 *= g;
+        biquads[0].b2 *= g;
+    }
+
+    // highpass of an even order with the cutoff fc
+    template<int order>
+    constexpr std::array<Biquad, order / 2> highPass(double fs, double fc) {
+        static_assert((order > 0) && ((order % 2) == 0), "Only even filter orders.");
+        std::array<Biquad, order / 2> biquads{};
+        const double w = warp(fs, fc);
+        for (int k = 0; k < order / 2; k++) {
+            const Complex s = Complex{w, 0} / prototypePole(order, k);
+            biquads[k] = fromPole(bilinear(s), 1, -2, 1);
+        }
+        normalise(biquads, Complex{-1, 0});
+        return biquads;
+    }
+
+    // bandpass of an even order with the center frequency fc and the width fw
+    template<int order>
+    constexpr std::array<Biquad, order> bandPass(double fs, double fc, double fw) {
+        static_assert((order > 0) && ((order % 2) == 0), "Only even filter orders.");
+        std::array<Biquad, order> biquads{};
+        const double w1 = warp(fs, fc - fw / 2);
+        const double w2 = warp(fs, fc + fw / 2);
+        const double w0 = sqrt(w1 * w2);
+        const double bw = w2 - w1;
+        for (int k = 0; k < order / 2; k++) {
+            const Complex ab = prototypePole(order, k) * Complex{bw, 0};
+            const Complex d = csqrt(ab * ab - Complex{4 * w0 * w0, 0});
+            const Complex s1 = (ab + d) * Complex{0.5, 0};
+            const Complex s2 = (ab - d) * Complex{0.5, 0};
+            biquads[2 * k] = fromPole(bilinear(s1), 1, 0, -1);
+            biquads[2 * k + 1] = fromPole(bilinear(s2), 1, 0, -1);
+        }
+        // gain of one at the center frequency
+        normalise(biquads, bilinear(Complex{0, w0}));
+        return biquads;
+    }
+
+    // concatenates two filters into one chain of biquads
+    template<size_t n1, size_t n2>
+    constexpr std::array<Biquad, n1 + n2> cascade(const std::array<Biquad, n1> &f1,
+                                                  const std::array<Biquad, n2> &f2) {
+        std::array<Biquad, n1 + n2> biquads{};
+        for (size_t i = 0; i < n1; i++) biquads[i] = f1[i];
+        for (size_t i = 0; i < n2; i++) biquads[n1 + i] = f2[i];
+        return biquads;
+    }
+}
+
+#endif
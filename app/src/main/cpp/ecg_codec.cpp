@@ -0,0 +1,452 @@
+#include "ecg_codec.h"
+
+#include <math.h>
+#include <string.h>
+
+// the Rice parameter follows the mean of the last residuals as in JPEG-LS
+static constexpr uint64_t riceInitialSum = 16;
+static constexpr uint64_t riceResetCount = 64;
+
+// residuals with a longer unary part are stored with escapeBits
+static constexpr int maxUnary = 32;
+static constexpr int escapeBits = 33;
+
+// the integers of the ADC and the prediction stay within +/-2^30
+static constexpr double maxInteger = 1073741824.0;
+
+// the smallest difference between the samples is at most this number of steps
+static constexpr int maxStepDivisor = 32;
+
+// a block is stored as it is if more samples are exceptions
+static constexpr size_t maxExceptionsDivisor = 8;
+
+// MSB first into a buffer which must not be exceeded
+struct BitWriter {
+    uint8_t *p;
+    uint8_t *end;
+    uint64_t acc = 0;
+    int n = 0;
+    bool overflow = false;
+
+    BitWriter(uint8_t *begin, uint8_t *limit) : p(begin), end(limit) {}
+
+    // up to 56 bits
+    inline void put(uint64_t v, int bits) {
+        acc = (acc << bits) | v;
+        n += bits;
+        while (n >= 8) {
+            n -= 8;
+            if (p < end) {
+                *p++ = (uint8_t) (acc >> n);
+            } else {
+                overflow = true;
+            }
+        }
+    }
+
+    void flush() {
+        if (n > 0) put(0, 8 - n);
+    }
+};
+
+struct BitReader {
+    const uint8_t *p;
+    const uint8_t *end;
+    uint64_t buf = 0;
+    int avail = 0;
+
+    BitReader(const uint8_t *begin, const uint8_t *limit) : p(begin), end(limit) {}
+
+    inline void refill() {
+        while (avail <= 56) {
+            // zeros after the end: the caller checks the bytes consumed
+            const uint64_t b = p < end ? *p : 0;
+            p++;
+            buf |= b << (56 - avail);
+            avail += 8;
+        }
+    }
+
+    // up to 56 bits
+    inline uint64_t get(int bits) {
+        if (0 == bits) return 0;
+        refill();
+        const uint64_t v = buf >> (64 - bits);
+        buf <<= bits;
+        avail -= bits;
+        return v;
+    }
+
+    // counts up to max ones
+    inline int ones(int max) {
+        refill();
+        const uint64_t inv = ~buf;
+        int q = 0 != inv ? __builtin_clzll(inv) : 64;
+        if (q > max) q = max;
+        buf <<= q;
+        avail -= q;
+        return q;
+    }
+
+    // bytes read from begin: the block ends at a byte boundary
+    size_t consumed(const uint8_t *begin) const {
+        return (size_t) (p - begin) - (size_t) (avail >> 3);
+    }
+};
+
+struct RiceState {
+    uint64_t a = riceInitialSum;
+    uint64_t n = 1;
+
+    inline int parameter() const {
+        int k = 0;
+        while (((n << k) < a) && (k < 30)) k++;
+        return k;
+    }
+
+    inline void update(uint64_t u) {
+        a += u;
+        if (++n == riceResetCount) {
+            a >>= 1;
+            n >>= 1;
+        }
+    }
+};
+
+static inline uint64_t zigzag(int64_t r) {
+    return ((uint64_t) r << 1) ^ (uint64_t) (r >> 63);
+}
+
+static inline int64_t unzigzag(uint64_t u) {
+    return (int64_t) (u >> 1) ^ -(int64_t) (u & 1);
+}
+
+static inline uint32_t floatBits(float f) {
+    uint32_t b;
+    memcpy(&b, &f, sizeof(b));
+    return b;
+}
+
+static inline float bitsToFloat(uint32_t b) {
+    float f;
+    memcpy(&f, &b, sizeof(f));
+    return f;
+}
+
+// the sample which the decoder calculates from the integer of the ADC
+static inline float sampleOf(int32_t x, double step) {
+    return (float) ((double) x * step);
+}
+
+static inline int64_t predict(const int32_t *x, const int16_t *c, int order) {
+    int64_t s = 0;
+    for (int j = 0; j < order; j++) {
+        s += (int64_t) c[j] * (int64_t) x[-1 - j];
+    }
+    s = (s + (1 << (ECGCodec::coefficientShift - 1))) >> ECGCodec::coefficientShift;
+    if (s > (int64_t) maxInteger) s = (int64_t) maxInteger;
+    if (s < -(int64_t) maxInteger) s = -(int64_t) maxInteger;
+    return s;
+}
+
+ECGCodec::ECGCodec(size_t maxSamples) {
+    x.reserve(maxSamples);
+    exceptionIndex.reserve(maxSamples / maxExceptionsDivisor + 1);
+    exceptionDelta.reserve(maxSamples / maxExceptionsDivisor + 1);
+}
+
+size_t ECGCodec::maxEncodedSize(size_t n) {
+    return 1 + n * sizeof(float);
+}
+
+double ECGCodec::estimateStep(const float *v, size_t n, size_t stride) {
+    double dmin = 0;
+    double vmax = 0;
+    for (size_t i = 0; i < n; i++) {
+        const double a = fabs((double) v[i * stride]);
+        if (a > vmax) vmax = a;
+        if (0 == i) continue;
+        const double d = fabs((double) v[i * stride] - (double) v[(i - 1) * stride]);
+        if ((d > 0) && ((0 == dmin) || (d < dmin))) dmin = d;
+    }
+    if (0 == dmin) return 0;
+    // rounding error of the floats
+    const double eps = vmax * 2.4e-7;
+    // the mean of the differences up to limit steps in steps
+    auto refine = [v, n, stride](double q, double limit) {
+        double sum = 0;
+        double steps = 0;
+        for (size_t i = 1; i < n; i++) {
+            const double d = fabs((double) v[i * stride] - (double) v[(i - 1) * stride]);
+            const double m = nearbyint(d / q);
+            if (m > limit) continue;
+            sum += d;
+            steps += m;
+        }
+        return steps > 0 ? sum / steps : q;
+    };
+    // the smallest difference is a small multiple of the step: the largest
+    // fraction of it which explains nearly all small differences is the step
+    double q = 0;
+    for (int j = 1; j <= maxStepDivisor; j++) {
+        const double c = refine(dmin / j, 16);
+        if (c < eps) break;
+        size_t small = 0;
+        size_t integer = 0;
+        for (size_t i = 1; i < n; i++) {
+            const double d = fabs((double) v[i * stride] - (double) v[(i - 1) * stride]) / c;
+            if (d > 64) continue;
+            small++;
+            if (fabs(d - nearbyint(d)) < 0.1) integer++;
+        }
+        if ((small > 0) && (integer * 50 >= small * 49)) {
+            q = c;
+            break;
+        }
+    }
+    if (0 == q) return 0;
+    // larger and larger differences make the step more precise
+    for (double limit: {256.0, 4096.0, maxInteger}) {
+        q = refine(q, limit);
+    }
+    // least squares fit of the samples to their integers
+    double xv = 0;
+    double xx = 0;
+    for (size_t i = 0; i < n; i++) {
+        const double k = nearbyint((double) v[i * stride] / q);
+        xv += k * (double) v[i * stride];
+        xx += k * k;
+    }
+    return xx > 0 ? xv / xx : q;
+}
+
+int ECGCodec::predictor(size_t n, int16_t *coefficients) {
+    if (n <= (size_t) (2 * maxOrder)) return 0;
+    double r[maxOrder + 1] = {};
+    for (int lag = 0; lag <= maxOrder; lag++) {
+        for (size_t i = (size_t) lag; i < n; i++) {
+            r[lag] += (double) x[i] * (double) x[i - (size_t) lag];
+        }
+    }
+    if (r[0] <= 0) return 0;
+    // white noise correction so that the recursion is stable
+    r[0] *= 1.0 + 1e-9;
+    double a[maxOrder + 1] = {};
+    double best[maxOrder + 1] = {};
+    double err = r[0];
+    // bits of the residuals and the side information
+    double bestBits = 0.5 * (double) n * log2(err / (double) n + 1);
+    int bestOrder = 0;
+    for (int m = 1; m <= maxOrder; m++) {
+        double acc = r[m];
+        for (int j = 1; j < m; j++) {
+            acc -= a[j] * r[m - j];
+        }
+        const double k = acc / err;
+        double next[maxOrder + 1];
+        for (int j = 1; j < m; j++) {
+            next[j] = a[j] - k * a[m - j];
+        }
+        next[m] = k;
+        for (int j = 1; j <= m; j++) {
+            a[j] = next[j];
+        }
+        err *= 1 - k * k;
+        if (err <= 0) break;
+        const double bits = 0.5 * (double) n * log2(err / (double) n + 1) + m * (16 + 32);
+        if (bits < bestBits) {
+            bestBits = bits;
+            bestOrder = m;
+            for (int j = 1; j <= m; j++) {
+                best[j] = a[j];
+            }
+        }
+    }
+    for (int j = 0; j < bestOrder; j++) {
+        double c = nearbyint(best[j + 1] * (double) (1 << coefficientShift));
+        if (c > 32767) c = 32767;
+        if (c < -32768) c = -32768;
+        coefficients[j] = (int16_t) c;
+    }
+    return bestOrder;
+}
+
+size_t ECGCodec::encode(const float *v, size_t n, size_t stride, uint8_t *out) {
+    const size_t verbatimSize = maxEncodedSize(n);
+    bool constant = n > 0;
+    for (size_t i = 1; (i < n) && constant; i++) {
+        constant = floatBits(v[i * stride]) == floatBits(v[0]);
+    }
+    if (constant) {
+        lastMode = Constant;
+        out[0] = Constant;
+        memcpy(out + 1, &v[0], sizeof(float));
+        return 1 + sizeof(float);
+    }
+
+    const double step = (n > 0) && (n <= maxBlockSize) ? estimateStep(v, n, stride) : 0;
+    bool predicted = step > 0;
+    x.resize(n);
+    exceptionIndex.clear();
+    exceptionDelta.clear();
+    const size_t maxExceptions = n / maxExceptionsDivisor;
+    for (size_t i = 0; (i < n) && predicted; i++) {
+        const double k = nearbyint((double) v[i * stride] / step);
+        // NaN and infinity are only kept verbatim
+        if ((!isfinite(k)) || (fabs(k) > maxInteger)) {
+            predicted = false;
+            break;
+        }
+        x[i] = (int32_t) k;
+        const uint32_t d = floatBits(v[i * stride]) ^ floatBits(sampleOf(x[i], step));
+        if (0 != d) {
+            if (exceptionIndex.size() == maxExceptions) {
+                predicted = false;
+                break;
+            }
+            exceptionIndex.push_back((uint16_t) i);
+            exceptionDelta.push_back((int32_t) d);
+        }
+    }
+
+    if (predicted) {
+        int16_t c[maxOrder];
+        const int order = predictor(n, c);
+        const size_t nExceptions = exceptionIndex.size();
+        const size_t headerSize = 1 + sizeof(double) + 1 + (size_t) order * (2 + 4) + 2 + nExceptions * (2 + 4);
+        if (headerSize < verbatimSize) {
+            uint8_t *p = out;
+            *p++ = Predicted;
+            memcpy(p, &step, sizeof(step));
+            p += sizeof(step);
+            *p++ = (uint8_t) order;
+            memcpy(p, c, (size_t) order * sizeof(int16_t));
+            p += (size_t) order * sizeof(int16_t);
+            memcpy(p, x.data(), (size_t) order * sizeof(int32_t));
+            p += (size_t) order * sizeof(int32_t);
+            const uint16_t ne = (uint16_t) nExceptions;
+            memcpy(p, &ne, sizeof(ne));
+            p += sizeof(ne);
+            memcpy(p, exceptionIndex.data(), nExceptions * sizeof(uint16_t));
+            p += nExceptions * sizeof(uint16_t);
+            memcpy(p, exceptionDelta.data(), nExceptions * sizeof(int32_t));
+            p += nExceptions * sizeof(int32_t);
+
+            BitWriter bw(p, out + verbatimSize);
+            RiceState rice;
+            for (size_t i = (size_t) order; (i < n) && (!bw.overflow); i++) {
+                const uint64_t u = zigzag((int64_t) x[i] - predict(x.data() + i, c, order));
+                const int k = rice.parameter();
+                const uint64_t q = u >> k;
+                if (q < (uint64_t) maxUnary) {
+                    bw.put(((1ULL << q) - 1) << 1, (int) q + 1);
+                    bw.put(u & ((1ULL << k) - 1), k);
+                } else {
+                    bw.put((1ULL << maxUnary) - 1, maxUnary);
+                    bw.put(u, escapeBits);
+                }
+                rice.update(u);
+            }
+            bw.flush();
+            if (!bw.overflow) {
+                lastMode = Predicted;
+                return (size_t) (bw.p - out);
+            }
+        }
+    }
+
+    lastMode = Verbatim;
+    out[0] = Verbatim;
+    for (size_t i = 0; i < n; i++) {
+        memcpy(out + 1 + i * sizeof(float), &v[i * stride], sizeof(float));
+    }
+    return verbatimSize;
+}
+
+size_t ECGCodec::decode(const uint8_t *in, size_t size, float *v, size_t n, size_t stride) {
+    if (size < 1) return 0;
+    const uint8_t *p = in + 1;
+    const uint8_t *end = in + size;
+    switch (in[0]) {
+        case Verbatim:
+            if ((size_t) (end - p) < n * sizeof(float)) return 0;
+            for (size_t i = 0; i < n; i++) {
+                memcpy(&v[i * stride], p + i * sizeof(float), sizeof(float));
+            }
+            return 1 + n * sizeof(float);
+        case Constant: {
+            if ((size_t) (end - p) < sizeof(float)) return 0;
+            float c;
+            memcpy(&c, p, sizeof(c));
+            for (size_t i = 0; i < n; i++) {
+                v[i * stride] = c;
+            }
+            return 1 + sizeof(float);
+        }
+        case Predicted:
+            break;
+        default:
+            return 0;
+    }
+    if ((size_t) (end - p) < (sizeof(double) + 1)) return 0;
+    double step;
+    memcpy(&step, p, sizeof(step));
+    p += sizeof(step);
+    const int order = *p++;
+    if ((order > maxOrder) || ((size_t) order > n)) return 0;
+    if ((size_t) (end - p) < (size_t) order * (2 + 4) + 2) return 0;
+    int16_t c[maxOrder];
+    int32_t history[maxOrder];
+    memcpy(c, p, (size_t) order * sizeof(int16_t));
+    p += (size_t) order * sizeof(int16_t);
+    memcpy(history, p, (size_t) order * sizeof(int32_t));
+    p += (size_t) order * sizeof(int32_t);
+    uint16_t nExceptions;
+    memcpy(&nExceptions, p, sizeof(nExceptions));
+    p += sizeof(nExceptions);
+    if ((size_t) (end - p) < (size_t) nExceptions * (2 + 4)) return 0;
+    const uint8_t *exceptionIndex = p;
+    const uint8_t *exceptionDelta = p + (size_t) nExceptions * sizeof(uint16_t);
+    p += (size_t) nExceptions * (2 + 4);
+
+    // the last maxOrder integers in reverse order for the predictor
+    int32_t x[2 * maxOrder];
+    for (int j = 0; j < order; j++) {
+        x[j] = history[j];
+        v[(size_t) j * stride] = sampleOf(history[j], step);
+    }
+    BitReader br(p, end);
+    RiceState rice;
+    int pos = order;
+    for (size_t i = (size_t) order; i < n; i++) {
+        const int k = rice.parameter();
+        const int q = br.ones(maxUnary);
+        uint64_t u;
+        if (q < maxUnary) {
+            br.get(1);
+            u = ((uint64_t) q << k) | br.get(k);
+        } else {
+            u = br.get(escapeBits);
+        }
+        rice.update(u);
+        const int64_t xi = predict(x + pos, c, order) + unzigzag(u);
+        if (pos == 2 * maxOrder) {
+            // keeps the last order integers at the start
+            memmove(x, x + pos - order, (size_t) order * sizeof(int32_t));
+            pos = order;
+        }
+        x[pos++] = (int32_t) xi;
+        v[i * stride] = sampleOf((int32_t) xi, step);
+    }
+    const size_t consumed = (size_t) (p - in) + br.consumed(p);
+    if (consumed > size) return 0;
+    for (size_t e = 0; e < nExceptions; e++) {
+        uint16_t i;
+        uint32_t d;
+        memcpy(&i, exceptionIndex + e * sizeof(uint16_t), sizeof(i));
+        memcpy(&d, exceptionDelta + e * sizeof(int32_t), sizeof(d));
+        if (i >= n) return 0;
+        v[i * stride] = bitsToFloat(floatBits(v[i * stride]) ^ d);
+    }
+    return consumed;
+}
@@ -0,0 +1,67 @@
+#ifndef ECG_CODEC_H
+#define ECG_CODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// Lossless compression of blocks of ECG samples. The samples in V are the
+// readings of the ADC times its step. The step is estimated from the
+// differences between the samples and the samples are turned back into the
+// integers of the ADC. A linear predictor (Levinson-Durbin, quantised
+// coefficients) is applied to the integers and the residuals are Rice coded
+// with a parameter which follows the mean of the previous residuals so that
+// there is no side information. Samples which the float arithmetic does not
+// reproduce bit by bit are stored as exceptions. Blocks which are not
+// quantised are stored as they are. Every block can be decoded on its own.
+class ECGCodec {
+
+public:
+    // largest block
+    static constexpr size_t maxBlockSize = 65535;
+
+    static constexpr int maxOrder = 8;
+
+    // fractional bits of the coefficients of the predictor
+    static constexpr int coefficientShift = 12;
+
+    enum Mode : uint8_t {
+        Verbatim = 0,
+        Constant = 1,
+        Predicted = 2
+    };
+
+    // maxSamples: largest block which is encoded
+    explicit ECGCodec(size_t maxSamples = 4096);
+
+    // bytes which an encoded block of n samples never exceeds
+    static size_t maxEncodedSize(size_t n);
+
+    // encodes n samples which are stride floats apart into out
+    // returns the number of bytes written
+    size_t encode(const float *v, size_t n, size_t stride, uint8_t *out);
+
+    // decodes n samples into v with stride from a block of at most size bytes
+    // returns the number of bytes read or 0 if the block is corrupt
+    static size_t decode(const uint8_t *in, size_t size, float *v, size_t n, size_t stride);
+
+    // mode of the last block encoded
+    Mode getLastMode() const {
+        return lastMode;
+    }
+
+private:
+    // the step of the ADC: approximate greatest common divisor of the
+    // differences between the samples, 0 if the samples are constant
+    static double estimateStep(const float *v, size_t n, size_t stride);
+
+    // quantised coefficients of the predictor of the integers, returns the order
+    int predictor(size_t n, int16_t *coefficients);
+
+    std::vector<int32_t> x;
+    std::vector<uint16_t> exceptionIndex;
+    std::vector<int32_t> exceptionDelta;
+    Mode lastMode = Verbatim;
+};
+
+#endif
@@ -0,0 +1,36 @@
+#include "ecg_pyramid.h"
+
+ECGPyramid::ECGPyramid(size_t columns, size_t maxWindow) :
+        maxColumns(columns > 0 ? columns : 1) {
+    size_t capacity = 1;
+    while (capacity < maxColumns) capacity *= 2;
+    size_t samplesPerColumn = 1;
+    for (;;) {
+        Level l = {};
+        l.samplesPerColumn = samplesPerColumn;
+        l.ring.resize(capacity);
+        l.mask = capacity - 1;
+        levels.push_back(l);
+        // the longest window fits into the columns of this level
+        if ((samplesPerColumn * maxColumns) >= maxWindow) break;
+        samplesPerColumn *= factor;
+    }
+    clear();
+}
+
+void ECGPyramid::clear() {
+    for (auto &l: levels) {
+        l.completed = 0;
+        l.count = 0;
+        l.current = {0, 0};
+    }
+    nSamples = 0;
+}
+
+size_t ECGPyramid::selectLevel(size_t windowLength) const {
+    for (size_t k = 0; k < levels.size(); k++) {
+        const size_t spc = levels[k].samplesPerColumn;
+        if (((windowLength + spc - 1) / spc) <= maxColumns) return k;
+    }
+    return levels.size() - 1;
+}
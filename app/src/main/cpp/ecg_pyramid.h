@@ -0,0 +1,116 @@
+#ifndef ECG_PYRAMID_H
+#define ECG_PYRAMID_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// Min/max envelope of the ECG at several resolutions so that a window of
+// any length up to maxWindow samples can be drawn with at most maxColumns
+// columns. A column of level k covers factor^k samples: level 0 holds the
+// samples themselves. Every sample updates the column which is being filled
+// on every level, and a level keeps only its last maxColumns completed
+// columns in a ring, so adding a sample takes O(levels) and the memory does
+// not depend on the length of the window.
+class ECGPyramid {
+
+public:
+    struct MinMax {
+        float min;
+        float max;
+    };
+
+    static constexpr size_t factor = 4;
+
+    // maxColumns: columns of the longest window
+    // maxWindow: longest window in samples
+    ECGPyramid(size_t maxColumns, size_t maxWindow);
+
+    void clear();
+
+    void add(float v) {
+        nSamples++;
+        for (auto &l: levels) {
+            if (l.count == l.samplesPerColumn) {
+                l.ring[l.completed & l.mask] = l.current;
+                l.completed++;
+                l.count = 0;
+            }
+            if (0 == l.count) {
+                l.current.min = v;
+                l.current.max = v;
+            } else {
+                if (v < l.current.min) l.current.min = v;
+                if (v > l.current.max) l.current.max = v;
+            }
+            l.count++;
+        }
+    }
+
+    void add(const float *v, size_t n) {
+        for (size_t i = 0; i < n; i++) {
+            add(v[i]);
+        }
+    }
+
+    size_t getLevels() const {
+        return levels.size();
+    }
+
+    // the coarsest level which is needed to show windowLength samples
+    // with at most maxColumns columns
+    size_t selectLevel(size_t windowLength) const;
+
+    size_t getSamplesPerColumn(size_t level) const {
+        return levels[level].samplesPerColumn;
+    }
+
+    // index of the column which holds the latest sample, -1 before the first one
+    int64_t getCurrentColumn(size_t level) const {
+        return nSamples > 0 ? (int64_t) levels[level].completed : -1;
+    }
+
+    // samples in the current column: 1..samplesPerColumn
+    size_t getCurrentCount(size_t level) const {
+        return levels[level].count;
+    }
+
+    // column i of a level: one of the last maxColumns completed columns or the current one
+    MinMax getColumn(size_t level, int64_t i) const {
+        const Level &l = levels[level];
+        if ((uint64_t) i == l.completed) return l.current;
+        return l.ring[(uint64_t) i & l.mask];
+    }
+
+    // the oldest column of a level which is still available
+    int64_t getFirstColumn(size_t level) const {
+        const Level &l = levels[level];
+        return l.completed > maxColumns ? (int64_t) (l.completed - maxColumns) : 0;
+    }
+
+    size_t getMaxColumns() const {
+        return maxColumns;
+    }
+
+    uint64_t getSamples() const {
+        return nSamples;
+    }
+
+private:
+    struct Level {
+        size_t samplesPerColumn;
+        std::vector<MinMax> ring;
+        size_t mask;
+        // completed columns, the current one has this index
+        uint64_t completed;
+        MinMax current;
+        // samples in the current column
+        size_t count;
+    };
+
+    const size_t maxColumns;
+    std::vector<Level> levels;
+    uint64_t nSamples = 0;
+};
+
+#endif
@@ -1,36 +1,168 @@
 #include "ecg_rr_det.h"
 
 #include <math.h>
+#include <string.h>
+
+// writes v at p and advances p
+template<typename T>
+static void put(uint8_t*& p, T v) {
+	memcpy(p,&v,sizeof(T));
+	p += sizeof(T);
+}
+
+template<typename T>
+static T get(const uint8_t*& p) {
+	T v;
+	memcpy(&v,p,sizeof(T));
+	p += sizeof(T);
+	return v;
+}
 
 ECG_rr_det::ECG_rr_det(RRlistener* _rRlistener) {
 	rrListener = _rRlistener;
 	reset();
 }
 
+void ECG_rr_det::setupFilterCascade(FilterCascade& cascade, float fs) {
+	Iir::Butterworth::BandPass<2> bandPass;
+	Iir::Butterworth::HighPass<2> highPass;
+	bandPass.setup(2,fs,20,15);
+	highPass.setup(2,fs,5);
+	cascade.clear();
+	cascade.append(highPass);
+	cascade.append(bandPass);
+}
+
 void ECG_rr_det::reset() {
         amplitude = 0;
         t2 = 0;
         timestamp = 0;
+        inputCount = 0;
         doNotDetect = (int) samplingRateInHz;
         ignoreECGdetector = (int) samplingRateInHz;
+        // the start counts as the previous R peak
+        hasPreviousPeak = true;
+        previousPeakReported = false;
+}
+
+ECG_rr_det::Snapshot ECG_rr_det::getSnapshot() const {
+	Snapshot s = {};
+	s.version = snapshotVersion;
+	s.samplingRateInHz = samplingRateInHz;
+	for(int i = 0; i < filterStages; i++) {
+		s.filterStates[i] = filterCascade.getState(i);
+	}
+	s.timestamp = timestamp;
+	s.t2 = t2;
+	s.prevBPM = prevBPM;
+	s.doNotDetect = doNotDetect;
+	s.ignoreRRvalue = ignoreRRvalue;
+	s.ignoreECGdetector = ignoreECGdetector;
+	s.amplitude = amplitude;
+	s.hasPreviousPeak = hasPreviousPeak;
+	s.previousPeakReported = previousPeakReported;
+	return s;
+}
+
+bool ECG_rr_det::restore(const Snapshot& s) {
+	if ((s.version != snapshotVersion) || (s.samplingRateInHz != samplingRateInHz)) {
+		return false;
+	}
+	for(int i = 0; i < filterStages; i++) {
+		filterCascade.getState(i) = s.filterStates[i];
+	}
+	timestamp = s.timestamp;
+	t2 = s.t2;
+	prevBPM = s.prevBPM;
+	doNotDetect = s.doNotDetect;
+	ignoreRRvalue = s.ignoreRRvalue;
+	ignoreECGdetector = s.ignoreECGdetector;
+	amplitude = s.amplitude;
+	hasPreviousPeak = s.hasPreviousPeak;
+	previousPeakReported = s.previousPeakReported;
+	return true;
+}
+
+void ECG_rr_det::serialize(const Snapshot& s, uint8_t* out) {
+	uint8_t* p = out;
+	put<uint32_t>(p,(uint32_t)s.version);
+	put<float>(p,s.samplingRateInHz);
+	for(int i = 0; i < filterStages; i++) {
+		put<double>(p,s.filterStates[i].v1);
+		put<double>(p,s.filterStates[i].v2);
+	}
+	put<int64_t>(p,s.timestamp);
+	put<int64_t>(p,s.t2);
+	put<float>(p,s.prevBPM);
+	put<int32_t>(p,s.doNotDetect);
+	put<int32_t>(p,s.ignoreRRvalue);
+	put<int32_t>(p,s.ignoreECGdetector);
+	put<double>(p,s.amplitude);
+	put<uint8_t>(p,s.hasPreviousPeak ? 1 : 0);
+	put<uint8_t>(p,s.previousPeakReported ? 1 : 0);
+}
+
+bool ECG_rr_det::deserialize(const uint8_t* in, size_t size, Snapshot& s) {
+	if (size < serializedSnapshotSize) return false;
+	const uint8_t* p = in;
+	s = {};
+	s.version = (int)get<uint32_t>(p);
+	if (s.version != snapshotVersion) return false;
+	s.samplingRateInHz = get<float>(p);
+	for(int i = 0; i < filterStages; i++) {
+		s.filterStates[i].v1 = get<double>(p);
+		s.filterStates[i].v2 = get<double>(p);
+	}
+	s.timestamp = (long)get<int64_t>(p);
+	s.t2 = (long)get<int64_t>(p);
+	s.prevBPM = get<float>(p);
+	s.doNotDetect = get<int32_t>(p);
+	s.ignoreRRvalue = get<int32_t>(p);
+	s.ignoreECGdetector = get<int32_t>(p);
+	s.amplitude = get<double>(p);
+	s.hasPreviousPeak = get<uint8_t>(p) != 0;
+	s.previousPeakReported = get<uint8_t>(p) != 0;
+	return true;
+}
+
+void ECG_rr_det::initSteadyState(float v) {
+	filterCascade.initSteadyState(1000 * (double) v);
+	ignoreECGdetector = 0;
+	hasPreviousPeak = false;
+	previousPeakReported = false;
 }
 
 // detect r peaks
 // input: ECG samples at the specified sampling rate and in V
 void ECG_rr_det::detect(float v) {
-	double h = 1000 * (double) v;
-	h = highPass.filter(h);
-	h = bandPass.filter(h);
+	const double h = filterCascade.filter(1000 * (double) v);
+	detectSquared(h * h, fabs(h) > artefact_threshold);
+}
+
+// detect r peaks in a block of samples
+// input: ECG samples at the specified sampling rate and in V
+void ECG_rr_det::detect(const float* v, size_t n) {
+	filterCascade.filter(v, n, 1000, [this](double h) {
+		detectSquared(h * h, fabs(h) > artefact_threshold);
+	});
+}
+
+// h is the squared filter output
+// sqrt(h) > artefact_threshold is identical to testing the
+// absolute value of the filter output which is done by the caller
+inline void ECG_rr_det::detectSquared(double h, bool isArtefact) {
+	inputCount++;
 	if (ignoreECGdetector > 0) {
 		ignoreECGdetector--;
 		return;
 	}
-	h = h * h;
-	if (sqrt(h) > artefact_threshold) {
+	if (isArtefact) {
 		// ignore signal for 1 sec
 		ignoreECGdetector = ((int) samplingRateInHz);
 		//Log.d(TAG,"artefact="+(Math.sqrt(h)));
 		ignoreRRvalue = 2;
+		// there might have been beats in the ignored second
+		previousPeakReported = false;
 		return;
 	}
 	if (h > amplitude) {
@@ -43,26 +175,32 @@ void ECG_rr_det::detect(float v) {
 	} else {
 		double threshold = threshold_factor * amplitude;
 		if (h > threshold) {
-			float t = (float)(timestamp - t2) / samplingRateInHz;
-			float bpm = 1 / t * 60;
-			if ((bpm > 30) && (bpm < 250)) {
-				if (ignoreRRvalue > 0) {
-					ignoreRRvalue--;
-				} else {
-					if (bpm > 0) {
-						if (((bpm * 1.5) < prevBPM) || ((bpm * 0.75) > prevBPM)) {
-							ignoreRRvalue = 3;
-						} else {
-							rrListener->hasRpeak(timestamp,
-												 bpm,
-												 amplitude, h / threshold);
+			bool reported = false;
+			if (hasPreviousPeak) {
+				float t = (float)(timestamp - t2) / samplingRateInHz;
+				float bpm = 1 / t * 60;
+				if ((bpm > 30) && (bpm < 250)) {
+					if (ignoreRRvalue > 0) {
+						ignoreRRvalue--;
+					} else {
+						if (bpm > 0) {
+							if (((bpm * 1.5) < prevBPM) || ((bpm * 0.75) > prevBPM)) {
+								ignoreRRvalue = 3;
+							} else {
+								rrListener->hasRpeak(timestamp,
+										     bpm,
+										     amplitude, h / threshold);
+								reported = true;
+							}
+							prevBPM = bpm;
 						}
-						prevBPM = bpm;
 					}
+				} else {
+					ignoreRRvalue = 3;
 				}
-			} else {
-				ignoreRRvalue = 3;
 			}
+			hasPreviousPeak = true;
+			previousPeakReported = reported;
 			t2 = timestamp;
 			// advoid 1/5 sec
 			doNotDetect = (int) samplingRateInHz / 5;
@@ -1,7 +1,11 @@
 #ifndef ECG_RR_DET_H
 #define ECG_RR_DET_H
 
+#include <stddef.h>
+#include <stdint.h>
+
 #include "Iir.h"
+#include "sos_cascade.h"
 
 // R peak detector using a DB3 wavelet. Runs only at 250Hz.
 class ECG_rr_det {
@@ -27,26 +31,132 @@ public:
     // constructor
     ECG_rr_det(RRlistener* rRlistener);
 
+    // sets up the filters and the timing of the detector for the sampling
+    // rate fs and resets the detector and the filters
     void init(float fs) {
-        bandPass.setup(2,fs,20,15);
-        highPass.setup(2,fs,5);
+        samplingRateInHz = fs;
+        setupFilterCascade(filterCascade, fs);
+        filterCascade.reset();
+        reset();
     }
 
+    // highpass and bandpass of the detector fused into one chain of biquads
+    static constexpr int filterStages = 3;
+    typedef SOSCascade<filterStages> FilterCascade;
+
+    // designs the filters of the detector for the sampling rate fs
+    static void setupFilterCascade(FilterCascade& cascade, float fs);
+
+    // how fast the adaptive threshold follows changes in ECG
+    // amplitude. Realisic values: 0.1 .. 1.0
+    // 0.1 = slow recovery after an artefact but no wrong detections
+    // 1 = fast recovery after an artefact but possibly wrong detections
+    static constexpr float adaptive_threshold_decay_constant = 0.25F;
+
+    // the threshold for the detection is 0.6 times smaller than the amplitude
+    static constexpr float threshold_factor = 0.6F;
+
+    // 10mV as the threshold the bandpass filtered ECG is an artefact
+    static constexpr double artefact_threshold = 10;
+
     // reset detector
     void reset();
 
+    // complete state of the detector: can be copied, use serialize() for a file
+    struct Snapshot {
+        int version;
+        float samplingRateInHz;
+        FilterCascade::State filterStates[filterStages];
+        long timestamp;
+        long t2;
+        float prevBPM;
+        int doNotDetect;
+        int ignoreRRvalue;
+        int ignoreECGdetector;
+        double amplitude;
+        bool hasPreviousPeak;
+        bool previousPeakReported;
+    };
+
+    static constexpr int snapshotVersion = 2;
+
+    Snapshot getSnapshot() const;
+
+    // continues exactly where the snapshot has been taken
+    // returns false if the snapshot is from another version or sampling rate
+    bool restore(const Snapshot& snapshot);
+
+    // bytes of serialize(): uint32 version, float sampling rate, v1 and v2 of
+    // the filters as doubles, int64 timestamp and t2, float prevBPM, int32
+    // doNotDetect, ignoreRRvalue and ignoreECGdetector, double amplitude and
+    // one byte for each flag, in native byte order as the recording
+    static constexpr size_t serializedSnapshotSize = 4 + 4 + filterStages * 16 + 8 + 8 + 4 + 3 * 4 + 8 + 2;
+
+    // writes serializedSnapshotSize bytes
+    static void serialize(const Snapshot& snapshot, uint8_t* out);
+
+    // returns false if there are less than serializedSnapshotSize bytes or
+    // they are from another version
+    static bool deserialize(const uint8_t* in, size_t size, Snapshot& snapshot);
+
+    // starts a new signal beginning with the sample v (in V): the filters are
+    // set to their steady state for v so that they don't need to settle and
+    // the next R peak starts the RR intervals. The adaptive amplitude and the
+    // previous heartrate are kept so that after restore() the detection
+    // continues straight away.
+    void initSteadyState(float v);
+
+    // sample number of the next sample since the last reset: the sample
+    // numbers of hasRpeak() count from here
+    long getSampleNumber() const {
+        return timestamp;
+    }
+
+    // the last sample handed to detect() counting every sample since the last
+    // reset, also the ones which are ignored after an artefact. In hasRpeak()
+    // the sample of the R peak. Not part of the snapshot: it counts the
+    // samples this detector has been given.
+    long getInputSampleNumber() const {
+        return inputCount - 1;
+    }
+
+    // in hasRpeak(): true if the R peak before has been reported as well, so
+    // that the two RR intervals are successive. False after an artefact, a
+    // beat which has been held back or a reset.
+    bool isPreviousPeakReported() const {
+        return previousPeakReported;
+    }
+
     // detect r peaks
     // input: ECG samples at the specified sampling rate and in V
     void detect(float v);
 
+    // detect r peaks in a block of samples
+    // input: n ECG samples at the specified sampling rate and in V
+    // The beats are identical to calling detect(float) for every sample.
+    void detect(const float* v, size_t n);
+
 private:
+    // state machine of the detector operating on the squared
+    // filter output
+    inline void detectSquared(double h, bool isArtefact);
+
     RRlistener* rrListener = nullptr;
 
     long timestamp = 0;
 
+    // number of samples since the last reset
+    long inputCount = 0;
+
     // previous timestamp
     long t2 = 0;
 
+    // false if no R peak has been detected since initSteadyState()
+    bool hasPreviousPeak = true;
+
+    // the previous R peak has been handed to hasRpeak()
+    bool previousPeakReported = false;
+
     // previously detected heartrate
     float prevBPM = 0;
 
@@ -63,24 +173,11 @@ private:
     // adaptive amplitude value of the detector output
     double amplitude = 0.0;
 
-    Iir::Butterworth::BandPass<2> bandPass;
-    Iir::Butterworth::HighPass<2> highPass;
+    FilterCascade filterCascade;
 
     // sampling rate in Hz
     float samplingRateInHz = 250;
 
-    // how fast the adaptive threshold follows changes in ECG
-    // amplitude. Realisic values: 0.1 .. 1.0
-    // 0.1 = slow recovery after an artefact but no wrong detections
-    // 1 = fast recovery after an artefact but possibly wrong detections
-    const float adaptive_threshold_decay_constant = 0.25F;
-
-    // the threshold for the detection is 0.6 times smaller than the amplitude
-    const float threshold_factor = 0.6F;
-
-    // 10mV as the threshold the bandpass filtered ECG is an artefact
-    const double artefact_threshold = 10;
-
 
 
 };
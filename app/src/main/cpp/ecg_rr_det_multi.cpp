@@ -0,0 +1,219 @@
+#include "ecg_rr_det_multi.h"
+
+#include <math.h>
+
+ECG_rr_det_multi::ECG_rr_det_multi(int _nStreams) :
+	nStreams(_nStreams),
+	beats(_nStreams),
+	v1(0),
+	v2(0),
+	h(_nStreams),
+	h2(_nStreams),
+	decayedAmplitude(_nStreams),
+	aboveThreshold(_nStreams),
+	active(_nStreams),
+	timestamp(_nStreams),
+	t2(_nStreams),
+	prevBPM(_nStreams, 0),
+	doNotDetect(_nStreams),
+	ignoreRRvalue(_nStreams, 3),
+	ignoreECGdetector(_nStreams),
+	amplitude(_nStreams) {
+	reset();
+}
+
+void ECG_rr_det_multi::init(float fs) {
+	samplingRateInHz = fs;
+	ECG_rr_det::setupFilterCascade(filterCascade, fs);
+	v1.assign((size_t)(filterCascade.getNumStages() * nStreams), 0);
+	v2.assign((size_t)(filterCascade.getNumStages() * nStreams), 0);
+	reset();
+}
+
+void ECG_rr_det_multi::reset() {
+	for(int i = 0; i < nStreams; i++) {
+		amplitude[i] = 0;
+		t2[i] = 0;
+		timestamp[i] = 0;
+		doNotDetect[i] = (int) samplingRateInHz;
+		ignoreECGdetector[i] = (int) samplingRateInHz;
+	}
+}
+
+void ECG_rr_det_multi::clearBeats() {
+	for(auto &b : beats) {
+		b.clear();
+	}
+}
+
+void ECG_rr_det_multi::detect(const float* v) {
+	for(int first = 0; first < nStreams; first += tileSize) {
+		const int n = (nStreams - first) < tileSize ? (nStreams - first) : tileSize;
+		detect(v, first, n);
+	}
+}
+
+// A tile of streams runs through a chunk of frames so that its state
+// stays in the cache and the chunk is read from the cache by all tiles
+void ECG_rr_det_multi::detect(const float* v, size_t nFrames) {
+	for(size_t chunk = 0; chunk < nFrames; chunk += framesPerChunk) {
+		const size_t m = (nFrames - chunk) < framesPerChunk ? (nFrames - chunk) : framesPerChunk;
+		for(int first = 0; first < nStreams; first += tileSize) {
+			const int n = (nStreams - first) < tileSize ? (nStreams - first) : tileSize;
+			for(size_t i = chunk; i < (chunk + m); i++) {
+				detect(v + i * (size_t)nStreams, first, n);
+			}
+		}
+	}
+}
+
+// The loops over the streams are in separate functions with restrict
+// pointers so that the compiler vectorises them without alias checks.
+// The arithmetic per stream is the same as in ECG_rr_det so that the
+// results are bit identical.
+
+static void filterStreams(int n,
+			  const ECG_rr_det::FilterCascade::Section &s,
+			  double* __restrict h,
+			  double* __restrict v1,
+			  double* __restrict v2) {
+	for(int i = 0; i < n; i++) {
+		const double w = h[i] - s.a1 * v1[i] - s.a2 * v2[i];
+		h[i] = s.b0 * w + s.b1 * v1[i] + s.b2 * v2[i];
+		v2[i] = v1[i];
+		v1[i] = w;
+	}
+}
+
+// The decay is calculated for all streams and selected later because the
+// compiler would otherwise move the division into a branch.
+static void decayStreams(int n,
+			 float samplingRateInHz,
+			 const double* __restrict h,
+			 const double* __restrict amplitude,
+			 double* __restrict h2,
+			 double* __restrict decayedAmplitude) {
+	for(int i = 0; i < n; i++) {
+		const double hh = h[i] * h[i];
+		double a = amplitude[i];
+		a = hh > a ? hh : a;
+		decayedAmplitude[i] = a - ECG_rr_det::adaptive_threshold_decay_constant * a / samplingRateInHz;
+		h2[i] = hh;
+	}
+}
+
+// Branch free version of the state machine up to the threshold test.
+// ignoreECGdetector is never negative so that it is zero if a sample
+// is not ignored.
+static int64_t updateStreams(int n,
+			     int64_t ignoreAfterArtefact,
+			     const double* __restrict h,
+			     const double* __restrict h2,
+			     const double* __restrict decayedAmplitude,
+			     double* __restrict amplitude,
+			     int64_t* __restrict ignoreECGdetector,
+			     int64_t* __restrict ignoreRRvalue,
+			     int64_t* __restrict doNotDetect,
+			     int64_t* __restrict active,
+			     int64_t* __restrict aboveThreshold) {
+	int64_t nAbove = 0;
+	for(int i = 0; i < n; i++) {
+		const int64_t ignored = ignoreECGdetector[i] > 0;
+		const int64_t artefact = (1 - ignored) & (int64_t)(fabs(h[i]) > ECG_rr_det::artefact_threshold);
+		const int64_t act = (1 - ignored) & (1 - artefact);
+		ignoreECGdetector[i] = ignoreECGdetector[i] - ignored + artefact * ignoreAfterArtefact;
+		ignoreRRvalue[i] = ignoreRRvalue[i] + artefact * (2 - ignoreRRvalue[i]);
+		const double d = decayedAmplitude[i];
+		const double o = amplitude[i];
+		const double a = act ? d : o;
+		amplitude[i] = a;
+		const int64_t waiting = doNotDetect[i] > 0;
+		doNotDetect[i] = doNotDetect[i] - (act & waiting);
+		const int64_t above = act & (1 - waiting) &
+			(int64_t)(h2[i] > ECG_rr_det::threshold_factor * a);
+		aboveThreshold[i] = above;
+		active[i] = act;
+		nAbove += above;
+	}
+	return nAbove;
+}
+
+static void countStreams(int n,
+			 const int64_t* __restrict active,
+			 int64_t* __restrict timestamp) {
+	for(int i = 0; i < n; i++) {
+		timestamp[i] += active[i];
+	}
+}
+
+void ECG_rr_det_multi::detect(const float* v, int first, int n) {
+	double* const hp = h.data() + first;
+	for(int i = 0; i < n; i++) {
+		hp[i] = 1000 * (double) v[first + i];
+	}
+
+	for(int j = 0; j < filterCascade.getNumStages(); j++) {
+		filterStreams(n,
+			      filterCascade.getSection(j),
+			      hp,
+			      v1.data() + j * nStreams + first,
+			      v2.data() + j * nStreams + first);
+	}
+
+	decayStreams(n,
+		     samplingRateInHz,
+		     hp,
+		     amplitude.data() + first,
+		     h2.data() + first,
+		     decayedAmplitude.data() + first);
+
+	const int64_t nAbove = updateStreams(n,
+					     (int64_t) samplingRateInHz,
+					     hp,
+					     h2.data() + first,
+					     decayedAmplitude.data() + first,
+					     amplitude.data() + first,
+					     ignoreECGdetector.data() + first,
+					     ignoreRRvalue.data() + first,
+					     doNotDetect.data() + first,
+					     active.data() + first,
+					     aboveThreshold.data() + first);
+
+	// crossing the threshold happens only about once per second
+	if (nAbove > 0) {
+		for(int i = first; i < (first + n); i++) {
+			if (aboveThreshold[i]) {
+				threshold(i);
+			}
+		}
+	}
+
+	countStreams(n, active.data() + first, timestamp.data() + first);
+}
+
+void ECG_rr_det_multi::threshold(int i) {
+	const double threshold = ECG_rr_det::threshold_factor * amplitude[i];
+	float t = (float)(timestamp[i] - t2[i]) / samplingRateInHz;
+	float bpm = 1 / t * 60;
+	if ((bpm > 30) && (bpm < 250)) {
+		if (ignoreRRvalue[i] > 0) {
+			ignoreRRvalue[i]--;
+		} else {
+			if (bpm > 0) {
+				if (((bpm * 1.5) < prevBPM[i]) || ((bpm * 0.75) > prevBPM[i])) {
+					ignoreRRvalue[i] = 3;
+				} else {
+					beats[i].push_back({(long) timestamp[i],
+							    bpm,
+							    amplitude[i], h2[i] / threshold});
+				}
+				prevBPM[i] = bpm;
+			}
+		}
+	} else {
+		ignoreRRvalue[i] = 3;
+	}
+	t2[i] = timestamp[i];
+	// advoid 1/5 sec
+	doNotDetect[i] = (int) samplingRateInHz / 5;
+}
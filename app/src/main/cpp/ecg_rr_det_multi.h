@@ -0,0 +1,113 @@
+#ifndef ECG_RR_DET_MULTI_H
+#define ECG_RR_DET_MULTI_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "ecg_rr_det.h"
+
+// R peak detector for N independent ECG streams which are processed in
+// lockstep. The state of all streams is stored in contiguous arrays
+// (structure of arrays) so that one sample of every stream is processed
+// with vector instructions. Every stream gives the same beats as an
+// ECG_rr_det instance which has received the same samples as long as
+// the compiler does not contract the filter arithmetic differently
+// (-ffp-contract=off when FMA instructions are enabled).
+class ECG_rr_det_multi {
+
+public:
+    // an R peak: the same values as ECG_rr_det::RRlistener::hasRpeak()
+    struct Beat {
+        long samplenumber;
+        float bpm;
+        double amplitude;
+        double confidence;
+    };
+
+    // constructor for nStreams independent ECG streams
+    ECG_rr_det_multi(int nStreams);
+
+    // sets up the filters and the timing for the sampling rate fs and resets
+    // the detectors as ECG_rr_det::init()
+    void init(float fs);
+
+    // resets the detectors of all streams
+    void reset();
+
+    // detect r peaks
+    // input: one ECG sample for every stream at the specified sampling rate and in V
+    void detect(const float* v);
+
+    // detect r peaks in nFrames frames of one sample per stream
+    // input: v[frame * getNumStreams() + stream]
+    void detect(const float* v, size_t nFrames);
+
+    int getNumStreams() const {
+        return nStreams;
+    }
+
+    // the queue of the beats detected for a stream since the last clearBeats()
+    const std::vector<Beat>& getBeats(int stream) const {
+        return beats[stream];
+    }
+
+    // empties the beat queues of all streams
+    void clearBeats();
+
+    double getAmplitude(int stream) const {
+        return amplitude[stream];
+    }
+
+private:
+    // number of streams processed together so that their state fits into the cache
+    static constexpr int tileSize = 128;
+
+    // number of frames which are processed tile by tile
+    static constexpr size_t framesPerChunk = 64;
+
+    // processes one sample of the streams first .. first + n - 1
+    void detect(const float* v, int first, int n);
+
+    // runs the state machine of a stream which has crossed the threshold
+    void threshold(int stream);
+
+    const int nStreams;
+
+    std::vector<std::vector<Beat>> beats;
+
+    ECG_rr_det::FilterCascade filterCascade;
+
+    // filter state: v1 and v2 per biquad and stream
+    std::vector<double> v1;
+    std::vector<double> v2;
+
+    // filter output and its square of the current sample
+    std::vector<double> h;
+    std::vector<double> h2;
+
+    // amplitude after the decay if the sample is used
+    std::vector<double> decayedAmplitude;
+
+    // one if the stream has crossed the threshold
+    std::vector<int64_t> aboveThreshold;
+
+    // one if the current sample has been passed to the state machine
+    std::vector<int64_t> active;
+
+    // state of the detectors, see ECG_rr_det
+    // The counters have the same width as a double so that
+    // they share the vector lanes with the amplitude.
+    std::vector<int64_t> timestamp;
+    std::vector<int64_t> t2;
+    std::vector<float> prevBPM;
+    std::vector<int64_t> doNotDetect;
+    std::vector<int64_t> ignoreRRvalue;
+    std::vector<int64_t> ignoreECGdetector;
+    std::vector<double> amplitude;
+
+    // sampling rate in Hz
+    float samplingRateInHz = 250;
+};
+
+#endif
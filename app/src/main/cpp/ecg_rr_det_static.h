@@ -0,0 +1,272 @@
+#ifndef ECG_RR_DET_STATIC_H
+#define ECG_RR_DET_STATIC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <array>
+#include <type_traits>
+
+#include "constexpr_iir.h"
+#include "ecg_rr_det.h"
+
+// The R peak detector of ECG_rr_det with the sampling rate, the sample
+// type and the filter order fixed at compile time. The filter coefficients
+// are constexpr and the time windows are integer sample counts so that
+// the compiler folds all constants into the code. The heartrate is only
+// calculated when a beat is reported: the RR interval is compared in samples.
+//
+// fs: sampling rate in Hz
+// Sample: float or double with the ECG in V, or int32_t with the ECG in uV
+//         which runs the filters in fixed point and the detector in integers.
+// order: order of the highpass and of the bandpass prototype (even)
+//
+// ECG_rr_det remains the detector for a sampling rate chosen at runtime.
+template<int fs, typename Sample = float, int order = 2>
+class ECG_rr_det_static {
+
+    static_assert(std::is_same<Sample, float>::value ||
+                  std::is_same<Sample, double>::value ||
+                  std::is_same<Sample, int32_t>::value,
+                  "Sample must be float, double or int32_t.");
+
+    static constexpr bool isFixedPoint = std::is_same<Sample, int32_t>::value;
+
+    // filter output in mV for floating point and in uV with 8 fractional bits for fixed point
+    typedef typename std::conditional<isFixedPoint, int32_t, Sample>::type Value;
+
+    // squared filter output and the amplitude
+    typedef typename std::conditional<isFixedPoint, int64_t, Sample>::type Square;
+
+    static constexpr int fractionalBits = 8;
+
+    static constexpr int coefficientBits = 28;
+
+    // highpass followed by the bandpass as in ECG_rr_det::setupFilterCascade()
+    static constexpr auto biquads = ConstexprIir::cascade(
+            ConstexprIir::highPass<order>(fs, 5),
+            ConstexprIir::bandPass<order>(fs, 20, 15));
+
+    static constexpr int numStages = (int) biquads.size();
+
+    // the coefficients converted to the type used by the filter
+    struct Coefficients {
+        typename std::conditional<isFixedPoint, int64_t, Sample>::type b0, b1, b2, a1, a2;
+    };
+
+    static constexpr Coefficients convert(const ConstexprIir::Biquad &b) {
+        if constexpr (isFixedPoint) {
+            constexpr double q = (double) (1L << coefficientBits);
+            auto round = [](double c) {
+                return (int64_t) (c < 0 ? c * q - 0.5 : c * q + 0.5);
+            };
+            return {round(b.b0), round(b.b1), round(b.b2), round(b.a1), round(b.a2)};
+        } else {
+            return {(Sample) b.b0, (Sample) b.b1, (Sample) b.b2, (Sample) b.a1, (Sample) b.a2};
+        }
+    }
+
+    static constexpr std::array<Coefficients, numStages> convert() {
+        std::array<Coefficients, numStages> c{};
+        for (int i = 0; i < numStages; i++) {
+            c[(size_t) i] = convert(biquads[(size_t) i]);
+        }
+        return c;
+    }
+
+    static constexpr std::array<Coefficients, numStages> coefficients = convert();
+
+    // conversion of the squared filter output to mV^2
+    static constexpr double squareToMilliVolt2 = isFixedPoint ?
+            1.0 / ((double) (1000 << fractionalBits) * (double) (1000 << fractionalBits)) : 1.0;
+
+    // 10mV as the threshold the bandpass filtered ECG is an artefact
+    static constexpr Value artefactThreshold = isFixedPoint ?
+            (Value) (ECG_rr_det::artefact_threshold * 1000 * (1 << fractionalBits)) :
+            (Value) ECG_rr_det::artefact_threshold;
+
+    // the amplitude decays by amplitude / decayDivisor every sample
+    static constexpr double decayDivisor = fs / ECG_rr_det::adaptive_threshold_decay_constant;
+
+    static_assert(!isFixedPoint || (decayDivisor == (double) (int64_t) decayDivisor),
+                  "The decay needs an integer divisor for fixed point.");
+
+    // ignores samples for 1 sec after an artefact and at the start
+    static constexpr int ignoreSamples = fs;
+
+    // time window not to detect an R peak after a beat: 1/5 sec
+    static constexpr int refractorySamples = fs / 5;
+
+    // RR intervals in samples between 250 bpm and 30 bpm
+    static constexpr long minRRsamples = 60L * fs / 250 + 1;
+    static constexpr long maxRRsamples = 60L * fs / 30 - 1;
+
+public:
+    typedef ECG_rr_det::RRlistener RRlistener;
+
+    ECG_rr_det_static(RRlistener* rRlistener) : rrListener(rRlistener) {
+        reset();
+    }
+
+    // reset detector and filters
+    void reset() {
+        for (auto &st: states) {
+            st = State();
+        }
+        amplitude = 0;
+        t2 = 0;
+        timestamp = 0;
+        prevRRsamples = 0;
+        doNotDetect = ignoreSamples;
+        ignoreECGdetector = ignoreSamples;
+        ignoreRRvalue = 3;
+    }
+
+    // detect r peaks
+    // input: ECG samples at the sampling rate fs in V or uV for int32_t
+    void detect(Sample v) {
+        const Value h = filter(v);
+        detectSquared((Square) h * (Square) h, (h > artefactThreshold) || (h < -artefactThreshold));
+    }
+
+    // detect r peaks in a block of n samples
+    void detect(const Sample* v, size_t n) {
+        for (size_t i = 0; i < n; i++) {
+            detect(v[i]);
+        }
+    }
+
+    // the adaptive amplitude in mV^2 as reported by ECG_rr_det
+    double getAmplitude() const {
+        return (double) amplitude * squareToMilliVolt2;
+    }
+
+    static constexpr int getSamplingRate() {
+        return fs;
+    }
+
+private:
+    // state of a biquad: Direct Form II for floating point, Direct Form I
+    // with 64 bit accumulators for fixed point
+    struct State {
+        Value v1 = 0;
+        Value v2 = 0;
+        Value y1 = 0;
+        Value y2 = 0;
+    };
+
+    inline Value filter(Sample v) {
+        if constexpr (isFixedPoint) {
+            int32_t out = v * (1 << fractionalBits);
+            for (int i = 0; i < numStages; i++) {
+                constexpr int64_t half = 1L << (coefficientBits - 1);
+                const Coefficients &c = coefficients[(size_t) i];
+                State &st = states[i];
+                const int64_t acc = c.b0 * out + c.b1 * st.v1 + c.b2 * st.v2
+                        - c.a1 * st.y1 - c.a2 * st.y2;
+                const int32_t y = (int32_t) ((acc + half) >> coefficientBits);
+                st.v2 = st.v1;
+                st.v1 = out;
+                st.y2 = st.y1;
+                st.y1 = y;
+                out = y;
+            }
+            return out;
+        } else {
+            Sample out = 1000 * v;
+            for (int i = 0; i < numStages; i++) {
+                const Coefficients &c = coefficients[(size_t) i];
+                State &st = states[i];
+                const Sample w = out - c.a1 * st.v1 - c.a2 * st.v2;
+                out = c.b0 * w + c.b1 * st.v1 + c.b2 * st.v2;
+                st.v2 = st.v1;
+                st.v1 = w;
+            }
+            return out;
+        }
+    }
+
+    inline void detectSquared(Square h, bool isArtefact) {
+        if (ignoreECGdetector > 0) {
+            ignoreECGdetector--;
+            return;
+        }
+        if (isArtefact) {
+            ignoreECGdetector = ignoreSamples;
+            ignoreRRvalue = 2;
+            return;
+        }
+        if (h > amplitude) {
+            amplitude = h;
+        }
+        if constexpr (isFixedPoint) {
+            amplitude = amplitude - amplitude / (int64_t) decayDivisor;
+        } else {
+            amplitude = amplitude - amplitude * (Square) (1 / decayDivisor);
+        }
+
+        if (doNotDetect > 0) {
+            doNotDetect--;
+        } else {
+            Square threshold;
+            if constexpr (isFixedPoint) {
+                threshold = amplitude * 3 / 5;
+            } else {
+                threshold = (Square) ECG_rr_det::threshold_factor * amplitude;
+            }
+            if (h > threshold) {
+                const long rr = timestamp - t2;
+                if ((rr >= minRRsamples) && (rr <= maxRRsamples)) {
+                    if (ignoreRRvalue > 0) {
+                        ignoreRRvalue--;
+                    } else {
+                        // bpm * 1.5 < prevBPM or bpm * 0.75 > prevBPM
+                        if ((0 == prevRRsamples) ||
+                            ((2 * rr) > (3 * prevRRsamples)) ||
+                            ((4 * rr) < (3 * prevRRsamples))) {
+                            ignoreRRvalue = 3;
+                        } else {
+                            const float bpm = 60.0F * (float) fs / (float) rr;
+                            rrListener->hasRpeak(timestamp,
+                                                 bpm,
+                                                 getAmplitude(),
+                                                 (double) h / (double) threshold);
+                        }
+                        prevRRsamples = rr;
+                    }
+                } else {
+                    ignoreRRvalue = 3;
+                }
+                t2 = timestamp;
+                doNotDetect = refractorySamples;
+            }
+        }
+        timestamp++;
+    }
+
+    RRlistener* rrListener = nullptr;
+
+    State states[numStages];
+
+    long timestamp = 0;
+
+    // previous timestamp
+    long t2 = 0;
+
+    // previous RR interval in samples, 0 if none
+    long prevRRsamples = 0;
+
+    // timewindow not to detect an R peak
+    int doNotDetect = 0;
+
+    // counts towards zero every RR peak
+    // if non zero the RR value is ignored
+    int ignoreRRvalue = 3;
+
+    // ignores samples to let the filter settle
+    int ignoreECGdetector = 0;
+
+    // adaptive amplitude value of the detector output
+    Square amplitude = 0;
+};
+
+#endif
@@ -0,0 +1,81 @@
+#include "ecg_trace.h"
+
+// samples moved from the queue into the pyramid in one go
+static constexpr size_t traceBatchSize = 64;
+
+ECGTrace::ECGTrace(size_t maxColumns, size_t maxWindow) :
+        pyramid(maxColumns, maxWindow),
+        ring((pyramid.getMaxColumns() + 1) * 2, 0.0f) {
+    setWindow(maxColumns);
+}
+
+void ECGTrace::setWindow(size_t windowLength) {
+    window = windowLength > 0 ? windowLength : 1;
+    level = pyramid.selectLevel(window);
+    const size_t spc = pyramid.getSamplesPerColumn(level);
+    nColumns = (window + spc - 1) / spc;
+    if (nColumns > pyramid.getMaxColumns()) nColumns = pyramid.getMaxColumns();
+    if (nColumns < 2) nColumns = 2;
+    refresh = true;
+}
+
+float ECGTrace::getColumnFill() const {
+    if (pyramid.getSamples() == 0) return 1;
+    return (float) pyramid.getCurrentCount(level) / (float) pyramid.getSamplesPerColumn(level);
+}
+
+void ECGTrace::copyColumns(int64_t first, int64_t last) {
+    for (int64_t c = first; c <= last; c++) {
+        const size_t s = slot(c) * 2;
+        if (c < 0) {
+            ring[s] = 0;
+            ring[s + 1] = 0;
+        } else {
+            const ECGPyramid::MinMax m = pyramid.getColumn(level, c);
+            ring[s] = m.min;
+            ring[s + 1] = m.max;
+        }
+    }
+    ring[nColumns * 2] = ring[0];
+    ring[nColumns * 2 + 1] = ring[1];
+}
+
+size_t ECGTrace::update(Range *ranges) {
+    float samples[traceBatchSize];
+    size_t nSamples = 0;
+    for (;;) {
+        const size_t k = queue.pop(samples, traceBatchSize);
+        if (0 == k) break;
+        pyramid.add(samples, k);
+        nSamples += k;
+    }
+    const int64_t current = pyramid.getCurrentColumn(level);
+    head = slot(current + 1);
+    if (refresh || ((current - shownColumn) >= (int64_t) nColumns)) {
+        copyColumns(current - (int64_t) nColumns + 1, current);
+        refresh = false;
+        shownColumn = current;
+        ranges[0] = {0, nColumns + 1};
+        return 1;
+    }
+    if (0 == nSamples) return 0;
+    // the column shown as the newest one so far has been filled up
+    const size_t start = slot(shownColumn);
+    const size_t n = (size_t) (current - shownColumn + 1);
+    copyColumns(shownColumn, current);
+    shownColumn = current;
+    const size_t end = start + n;
+    if (end <= nColumns) {
+        if (0 == start) {
+            ranges[0] = {0, n};
+            ranges[1] = {nColumns, 1};
+            return 2;
+        }
+        ranges[0] = {start, n};
+        return 1;
+    }
+    // wrapped around: slot 0 has been written
+    ranges[0] = {start, nColumns + 1 - start};
+    ranges[1] = {0, end - nColumns};
+    return 2;
+}
@@ -0,0 +1,109 @@
+#ifndef ECG_TRACE_H
+#define ECG_TRACE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "spsc_ring.h"
+#include "ecg_pyramid.h"
+
+// The scrolling ECG trace as columns of min and max values in a ring which
+// is mirrored by the vertex buffer. The DSP thread queues every sample in
+// O(1). The render thread adds the samples which have arrived since the
+// last frame to an ECGPyramid and copies the columns of the level which
+// fits the window into the ring, so that a window of a few seconds shows
+// every sample and one of minutes its envelope with the same number of
+// vertices. Only the columns which have changed are uploaded. The x
+// positions follow from the slot, the head of the ring and how much of the
+// newest column has been filled in the vertex shader. The ring has a copy
+// of slot 0 at its end so that the trace can be drawn as two line strips:
+// from the head to the copy and from slot 0 to the slot before the head.
+class ECGTrace {
+
+public:
+    // columns of the ring which have to be uploaded
+    struct Range {
+        size_t first;
+        size_t count;
+    };
+
+    // at most: the part up to the copy of slot 0 and the part from slot 0
+    static constexpr size_t maxRanges = 2;
+
+    // samples which can be queued between two frames: 4 secs at 250Hz
+    static constexpr size_t queueLength = 1024;
+
+    // maxColumns: columns of two vertices which are drawn at most
+    // maxWindow: longest window in samples
+    ECGTrace(size_t maxColumns, size_t maxWindow);
+
+    // DSP thread: queues a sample
+    void add(float y) {
+        queue.push(y);
+    }
+
+    // render thread: the window in samples, shown from the next update()
+    void setWindow(size_t windowLength);
+
+    size_t getWindow() const {
+        return window;
+    }
+
+    // render thread: adds the queued samples and updates the ring
+    // returns the number of ranges which have changed
+    size_t update(Range *ranges);
+
+    // render thread: min and max of nColumns + 1 columns, the last one is a copy of slot 0
+    const float *getData() const {
+        return ring.data();
+    }
+
+    // render thread: slot of the oldest column
+    size_t getHead() const {
+        return head;
+    }
+
+    size_t getNColumns() const {
+        return nColumns;
+    }
+
+    // render thread: level of the pyramid which is shown
+    size_t getLevel() const {
+        return level;
+    }
+
+    // render thread: fraction of the newest column which has been filled, 0..1
+    float getColumnFill() const;
+
+    const ECGPyramid &getPyramid() const {
+        return pyramid;
+    }
+
+    // samples dropped because the render thread was too far behind
+    unsigned long getDroppedSamples() const {
+        return queue.getOverruns();
+    }
+
+private:
+    size_t slot(int64_t column) const {
+        const int64_t n = (int64_t) nColumns;
+        return (size_t) (((column % n) + n) % n);
+    }
+
+    // copies the columns first..last of the level into their slots
+    void copyColumns(int64_t first, int64_t last);
+
+    ECGPyramid pyramid;
+    size_t window = 0;
+    size_t level = 0;
+    size_t nColumns = 1;
+    bool refresh = true;
+    // the newest column in the ring
+    int64_t shownColumn = -1;
+    std::vector<float> ring;
+    size_t head = 0;
+    SPSCRing<float, queueLength> queue;
+};
+
+#endif
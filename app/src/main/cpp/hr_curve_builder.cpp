@@ -0,0 +1,66 @@
+#include "hr_curve_builder.h"
+#include "cxx-spline.h"
+#include "util.h"
+
+HRCurveBuilder::HRCurveBuilder(double extrapolation) :
+        extrapolation(extrapolation) {
+    sem_init(&wakeup, 0, 0);
+    hrTs.reserve(maxBeats);
+    hrBuffer.reserve(maxBeats);
+}
+
+HRCurveBuilder::~HRCurveBuilder() {
+    stop();
+    sem_destroy(&wakeup);
+}
+
+void HRCurveBuilder::start() {
+    if (workerThread.joinable()) return;
+    running = true;
+    workerThread = std::thread(&HRCurveBuilder::worker, this);
+}
+
+void HRCurveBuilder::stop() {
+    if (!workerThread.joinable()) return;
+    running = false;
+    sem_post(&wakeup);
+    workerThread.join();
+}
+
+void HRCurveBuilder::worker() {
+    for (;;) {
+        while (sem_wait(&wakeup) != 0) {}
+        // the posts of the beats which are taken now
+        while (sem_trywait(&wakeup) == 0) {}
+        if (!running) return;
+        // all beats which have arrived so far go into one curve
+        Beat beat;
+        bool changed = false;
+        while (queue.pop(&beat, 1) == 1) {
+            if (nBeats < maxBeats) {
+                beats[(firstBeat + nBeats) % maxBeats] = beat;
+                nBeats++;
+            } else {
+                beats[firstBeat] = beat;
+                firstBeat = (firstBeat + 1) % maxBeats;
+            }
+            changed = true;
+        }
+        if (changed && (nBeats > 1)) build();
+    }
+}
+
+void HRCurveBuilder::build() {
+    hrTs.clear();
+    hrBuffer.clear();
+    for (size_t i = 0; i < nBeats; i++) {
+        const Beat &b = beats[(firstBeat + i) % maxBeats];
+        hrTs.push_back(b.t);
+        hrBuffer.push_back(b.hr);
+    }
+    const cubic_spline hrSpline(hrTs, hrBuffer);
+    const double t = hrTs.back();
+    ALOGV("Prediction: hr(%f)=%f", t + 1, hrSpline(t + 1));
+    curves.getWriteBuffer().fit(hrSpline, hrTs.data(), hrTs.size(), extrapolation);
+    curves.publish();
+}
@@ -0,0 +1,99 @@
+#ifndef HR_CURVE_BUILDER_H
+#define HR_CURVE_BUILDER_H
+
+#include <stddef.h>
+#include <semaphore.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "spsc_ring.h"
+#include "triple_buffer.h"
+#include "hr_history.h"
+
+// Builds the HRCurve of the last maxBeats heartrates on a worker thread so
+// that neither the DSP thread nor the render thread does any work for it.
+// The DSP thread queues a beat in O(1) and posts a semaphore, which never
+// waits. The worker keeps the beats in a fixed ring, builds the spline and
+// its cubics into a buffer which no other thread can see and publishes it
+// with one atomic exchange of the TripleBuffer. Beats which arrive while a
+// curve is built are taken together into the next one. The render thread
+// picks up the latest curve without waiting, and a published curve is never
+// changed while the render thread holds it.
+class HRCurveBuilder {
+
+public:
+    // heartrates of the spline
+    static constexpr size_t maxBeats = 60;
+
+    // beats which can wait for the worker
+    static constexpr size_t queueLength = 64;
+
+    // extrapolation: secs beyond the first and last beat, see HRCurve
+    explicit HRCurveBuilder(double extrapolation);
+
+    ~HRCurveBuilder();
+
+    // starts the worker thread
+    void start();
+
+    // stops the worker thread, the queued beats are dropped
+    void stop();
+
+    // DSP thread: a heartrate at t secs, never waits
+    void add(double t, double hr) {
+        queue.push({t, hr});
+        sem_post(&wakeup);
+    }
+
+    // render thread: makes the latest curve the current one
+    // returns true if it has changed since the last call
+    bool update() {
+        return curves.update();
+    }
+
+    // render thread: the curve which update() has picked up last
+    const HRCurve &getCurve() const {
+        return curves.getReadBuffer();
+    }
+
+    // curves built so far
+    unsigned long getBuilds() const {
+        return curves.getPublished();
+    }
+
+    // beats dropped because the worker was too far behind
+    unsigned long getDroppedBeats() const {
+        return queue.getOverruns();
+    }
+
+private:
+    struct Beat {
+        double t;
+        double hr;
+    };
+
+    void worker();
+
+    // builds the curve of the beats in the ring and publishes it
+    void build();
+
+    const double extrapolation;
+
+    SPSCRing<Beat, queueLength> queue;
+    sem_t wakeup;
+    std::atomic<bool> running{false};
+    std::thread workerThread;
+
+    // owned by the worker: the last maxBeats beats with the oldest at firstBeat
+    Beat beats[maxBeats] = {};
+    size_t firstBeat = 0;
+    size_t nBeats = 0;
+    // the beats in order for cubic_spline
+    std::vector<double> hrTs;
+    std::vector<double> hrBuffer;
+
+    TripleBuffer<HRCurve> curves;
+};
+
+#endif
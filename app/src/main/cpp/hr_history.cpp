@@ -0,0 +1,133 @@
+#include "hr_history.h"
+
+#include <math.h>
+#include <algorithm>
+
+void HRCurve::addSegment(double h, double y0, double y1, double y2, double y3) {
+    // Newton's divided differences at u = 0, h/3, 2h/3, h
+    const double s = h / 3;
+    const double d1 = (y1 - y0) / s;
+    const double d2 = ((y2 - y1) / s - d1) / (2 * s);
+    const double d3 = (((y3 - y2) / s - (y2 - y1) / s) / (2 * s) - d2) / (3 * s);
+    // y0 + d1 u + d2 u (u - s) + d3 u (u - s) (u - 2s)
+    Cubic c;
+    c.c[0] = y0;
+    c.c[1] = d1 - d2 * s + d3 * 2 * s * s;
+    c.c[2] = d2 - d3 * 3 * s;
+    c.c[3] = d3;
+    coefficients.push_back(c);
+}
+
+double HRCurve::operator()(double t) const {
+    if (coefficients.empty()) return 0;
+    if (t <= breaks.front()) return coefficients.front().c[0];
+    size_t i = (size_t) (std::upper_bound(breaks.begin(), breaks.end(), t) - breaks.begin());
+    if (i >= breaks.size()) {
+        // constant after the end of the last segment
+        t = breaks.back();
+        i = breaks.size() - 1;
+    }
+    const Cubic &c = coefficients[i - 1];
+    const double u = t - breaks[i - 1];
+    return c.c[0] + u * (c.c[1] + u * (c.c[2] + u * c.c[3]));
+}
+
+void HRCurve::evaluate(double t0, double dt, size_t n, double *values) const {
+    if (coefficients.empty()) {
+        for (size_t k = 0; k < n; k++) values[k] = 0;
+        return;
+    }
+    const size_t nSegments = coefficients.size();
+    size_t k = 0;
+    // constant before the first segment
+    const double first = coefficients.front().c[0];
+    while ((k < n) && ((t0 + (double) k * dt) <= breaks.front())) {
+        values[k++] = first;
+    }
+    size_t seg = 0;
+    while (k < n) {
+        const double t = t0 + (double) k * dt;
+        while ((seg < nSegments) && (t > breaks[seg + 1])) seg++;
+        if (seg == nSegments) break;
+        // forward differences of the cubic from u with the step dt
+        const double *c = coefficients[seg].c;
+        const double u = t - breaks[seg];
+        const double h = dt;
+        double p = c[0] + u * (c[1] + u * (c[2] + u * c[3]));
+        double d1 = c[1] * h + c[2] * (2 * u * h + h * h) + c[3] * (3 * u * u * h + 3 * u * h * h + h * h * h);
+        double d2 = c[2] * 2 * h * h + c[3] * (6 * u * h * h + 6 * h * h * h);
+        const double d3 = c[3] * 6 * h * h * h;
+        // points in this segment
+        const double end = breaks[seg + 1];
+        size_t m = (size_t) floor((end - t) / dt) + 1;
+        if (m > (n - k)) m = n - k;
+        for (size_t j = 0; j < m; j++) {
+            values[k++] = p;
+            p += d1;
+            d1 += d2;
+            d2 += d3;
+        }
+        seg++;
+        if (seg == nSegments) break;
+    }
+    // constant after the last segment
+    if (k < n) {
+        const Cubic &c = coefficients.back();
+        const double u = breaks.back() - breaks[nSegments - 1];
+        const double last = c.c[0] + u * (c.c[1] + u * (c.c[2] + u * c.c[3]));
+        while (k < n) values[k++] = last;
+    }
+}
+
+HRSampler::HRSampler(double step, size_t length) :
+        step(step),
+        length(length > 0 ? length : 1) {
+    size_t capacity = 1;
+    while (capacity < this->length) capacity *= 2;
+    ring.resize(capacity, 0);
+    mask = capacity - 1;
+}
+
+void HRSampler::setCurve(const HRCurve &c) {
+    curve = c;
+    refresh = true;
+}
+
+void HRSampler::evaluate(int64_t first, int64_t last) {
+    while (first <= last) {
+        // up to the end of the ring
+        const size_t slot = (size_t) first & mask;
+        size_t n = (size_t) (last - first + 1);
+        if (n > (ring.size() - slot)) n = ring.size() - slot;
+        curve.evaluate((double) first * step, step, n, ring.data() + slot);
+        first += (int64_t) n;
+    }
+}
+
+size_t HRSampler::update(double t) {
+    const int64_t due = (int64_t) floor(t / step);
+    const int64_t n = (int64_t) length;
+    if (refresh || ((due - newest) >= n)) {
+        newest = due;
+        refresh = false;
+        evaluate(due - n + 1, due);
+        return length;
+    }
+    if (due <= newest) return 0;
+    evaluate(newest + 1, due);
+    const size_t k = (size_t) (due - newest);
+    newest = due;
+    return k;
+}
+
+bool HRSampler::getRange(double low, double high, double &min, double &max) const {
+    min = HUGE_VAL;
+    max = -HUGE_VAL;
+    if (!curve.isValid()) return false;
+    for (size_t i = 0; i < length; i++) {
+        const double v = (*this)[i];
+        if ((v > low) && (v < min)) min = v;
+        if ((v < high) && (v > max)) max = v;
+    }
+    return (min != HUGE_VAL) || (max != -HUGE_VAL);
+}
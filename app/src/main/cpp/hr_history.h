@@ -0,0 +1,105 @@
+#ifndef HR_HISTORY_H
+#define HR_HISTORY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// A cubic spline of the heartrate as explicit cubics between its knots so
+// that sorted times can be evaluated in one pass. The cubics are taken from
+// any spline which is a cubic between the knots by sampling it four times
+// per segment. As OvrHRPlot did, the spline is extrapolated by a fixed time
+// beyond the first and the last knot and is constant further out.
+class HRCurve {
+
+public:
+    // f: the spline, x: its n sorted knots
+    template<typename F>
+    void fit(const F &f, const double *x, size_t n, double extrapolation) {
+        breaks.clear();
+        coefficients.clear();
+        if (n < 2) return;
+        breaks.push_back(x[0] - extrapolation);
+        for (size_t i = 0; i < n; i++) {
+            breaks.push_back(x[i]);
+        }
+        breaks.push_back(x[n - 1] + extrapolation);
+        for (size_t i = 0; (i + 1) < breaks.size(); i++) {
+            const double a = breaks[i];
+            const double h = breaks[i + 1] - a;
+            addSegment(h, f(a), f(a + h / 3), f(a + 2 * h / 3), f(a + h));
+        }
+    }
+
+    bool isValid() const {
+        return !coefficients.empty();
+    }
+
+    // evaluates the curve at time t
+    double operator()(double t) const;
+
+    // evaluates the curve at t0, t0 + dt, ..., in one pass with forward differences
+    void evaluate(double t0, double dt, size_t n, double *values) const;
+
+private:
+    // the cubic through 4 equally spaced values of a segment of length h
+    void addSegment(double h, double y0, double y1, double y2, double y3);
+
+    // start of the segments and the end of the last one
+    std::vector<double> breaks;
+
+    // c0 + c1 u + c2 u^2 + c3 u^3 with u = t - start of the segment
+    struct Cubic {
+        double c[4];
+    };
+    std::vector<Cubic> coefficients;
+};
+
+// The heartrate of the last length * step secs on a fixed time grid in a
+// ring for OvrHRPlot::render. A frame evaluates only the grid points which
+// have become due since the last frame. A new curve after a beat changes
+// all of them, so they are evaluated again in one pass.
+class HRSampler {
+
+public:
+    // step: grid in secs, length: number of grid points kept
+    HRSampler(double step, size_t length);
+
+    // a new curve which is used for all grid points at the next update()
+    void setCurve(const HRCurve &c);
+
+    // evaluates the grid points up to time t
+    // returns the number of grid points evaluated
+    size_t update(double t);
+
+    // heartrate i grid points before the newest one: 0..length-1
+    double operator[](size_t i) const {
+        return ring[(size_t) (newest - (int64_t) i) & mask];
+    }
+
+    size_t getLength() const {
+        return length;
+    }
+
+    bool hasCurve() const {
+        return curve.isValid();
+    }
+
+    // smallest value above low and largest value below high,
+    // +/-HUGE_VAL if there is none. False if there is neither.
+    bool getRange(double low, double high, double &min, double &max) const;
+
+private:
+    // evaluates the grid points first..last into the ring
+    void evaluate(int64_t first, int64_t last);
+
+    const double step;
+    const size_t length;
+    std::vector<double> ring;
+    size_t mask;
+    int64_t newest = 0;
+    bool refresh = true;
+    HRCurve curve;
+};
+
+#endif
@@ -0,0 +1,147 @@
+#include "hr_journal.h"
+#include "util.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <chrono>
+
+bool HRJournal::open(const std::string &fn) {
+    if (writerThread.joinable()) return fd >= 0;
+    filename = fn;
+    fd = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (fd < 0) {
+        ALOGE("Cannot open HR file: %s", filename.c_str());
+        return false;
+    }
+    struct stat st = {};
+    fstat(fd, &st);
+    fileSize = (long) st.st_size;
+    buffer.reserve(flushSize * 2);
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        running = true;
+    }
+    writerThread = std::thread(&HRJournal::writer, this);
+    ALOGV("HR journal: %s, size = %ld", filename.c_str(), fileSize);
+    return true;
+}
+
+void HRJournal::add(float bpm) {
+    struct timeval tv = {};
+    gettimeofday(&tv, nullptr);
+    add((int64_t) tv.tv_sec * 1000 + tv.tv_usec / 1000, bpm);
+}
+
+void HRJournal::add(int64_t timestampMs, float bpm) {
+    char line[64];
+    const int n = snprintf(line, sizeof(line), "%ld\t%.1f\n", (long) timestampMs, bpm);
+    if (n <= 0) return;
+    std::lock_guard<std::mutex> lock(mtx);
+    buffer.append(line, (size_t) n);
+    recordsAdded++;
+    bufferedRecords++;
+    if (buffer.size() >= flushSize) {
+        cv.notify_all();
+    }
+}
+
+void HRJournal::flush() {
+    std::unique_lock<std::mutex> lock(mtx);
+    if (!running) return;
+    syncRequested = recordsAdded;
+    cv.notify_all();
+    cv.wait(lock, [this] { return (recordsSynced >= syncRequested) || (!running); });
+}
+
+void HRJournal::close() {
+    if (!writerThread.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        running = false;
+        cv.notify_all();
+    }
+    writerThread.join();
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+    ALOGV("HR journal closed: %lu records, %lu segments",
+          recordsWritten.load(), segmentsRotated.load());
+}
+
+void HRJournal::writer() {
+    std::string data;
+    data.reserve(flushSize * 2);
+    std::unique_lock<std::mutex> lock(mtx);
+    for (;;) {
+        cv.wait_for(lock, std::chrono::milliseconds(flushIntervalMs), [this] {
+            return (!running) || (buffer.size() >= flushSize) || (syncRequested > recordsSynced);
+        });
+        // the other string keeps its capacity for the next records
+        data.swap(buffer);
+        const unsigned long nRecords = bufferedRecords;
+        const unsigned long nAdded = recordsAdded;
+        bufferedRecords = 0;
+        const bool stop = !running;
+        const bool sync = stop || (syncRequested > recordsSynced);
+        lock.unlock();
+        if (!data.empty()) {
+            write(data);
+            recordsWritten += nRecords;
+            data.clear();
+        }
+        if (sync && (fd >= 0)) {
+            fdatasync(fd);
+        }
+        lock.lock();
+        if (sync) {
+            recordsSynced = nAdded;
+            cv.notify_all();
+        }
+        if (stop) return;
+    }
+}
+
+void HRJournal::write(const std::string &data) {
+    if (fd < 0) return;
+    size_t n = 0;
+    while (n < data.size()) {
+        const ssize_t r = ::write(fd, data.data() + n, data.size() - n);
+        if (r <= 0) {
+            ALOGE("Could not write to heartrate-file!");
+            return;
+        }
+        n += (size_t) r;
+    }
+    fileSize += (long) n;
+    if (fileSize >= maxSegmentSize) {
+        rotate();
+    }
+}
+
+std::string HRJournal::segmentFilename(const std::string &filename, int n) {
+    return filename + "." + std::to_string(n);
+}
+
+void HRJournal::rotate() {
+    fdatasync(fd);
+    ::close(fd);
+    int n = 1;
+    while (access(segmentFilename(filename, n).c_str(), F_OK) == 0) {
+        n++;
+    }
+    const std::string segment = segmentFilename(filename, n);
+    if (rename(filename.c_str(), segment.c_str()) != 0) {
+        ALOGE("Could not rename %s to %s", filename.c_str(), segment.c_str());
+    }
+    fd = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (fd < 0) {
+        ALOGE("Cannot open HR file: %s", filename.c_str());
+    }
+    fileSize = 0;
+    segmentsRotated++;
+    ALOGV("HR file full: continuing in a new file, previous one is %s", segment.c_str());
+}
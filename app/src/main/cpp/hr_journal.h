@@ -0,0 +1,103 @@
+#ifndef HR_JOURNAL_H
+#define HR_JOURNAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Writes the heartrate into a tab separated file: ms since the epoch and bpm.
+// The file stays open and the records are collected in memory. A background
+// thread writes them when flushSize bytes have been collected or after
+// flushInterval. If the file grows larger than maxSegmentSize it is renamed to
+// the next free numbered segment <filename>.1, <filename>.2, ... and a new
+// file is started so that the current heartrate is always in <filename>.
+class HRJournal {
+
+public:
+    ~HRJournal() {
+        close();
+    }
+
+    // opens the file for appending and starts the writer thread
+    // returns false if the file cannot be opened
+    // open(), close() and isOpen() are called by the same thread
+    bool open(const std::string &filename);
+
+    // writes all records, syncs and closes the file
+    void close();
+
+    bool isOpen() const {
+        return writerThread.joinable();
+    }
+
+    // adds a heartrate with the current time: does not wait for the file
+    void add(float bpm);
+
+    // adds a heartrate with a timestamp in ms since the epoch
+    void add(int64_t timestampMs, float bpm);
+
+    // blocks until all records have been written and synced to the storage
+    void flush();
+
+    void setFlushInterval(int ms) {
+        flushIntervalMs = ms;
+    }
+
+    void setFlushSize(size_t bytes) {
+        flushSize = bytes;
+    }
+
+    void setMaxSegmentSize(long bytes) {
+        maxSegmentSize = bytes;
+    }
+
+    unsigned long getRecordsWritten() const {
+        return recordsWritten;
+    }
+
+    unsigned long getSegmentsRotated() const {
+        return segmentsRotated;
+    }
+
+    // filename of the numbered segment n
+    static std::string segmentFilename(const std::string &filename, int n);
+
+private:
+    void writer();
+
+    // writes the buffer and rotates the file if it is too large
+    void write(const std::string &data);
+
+    void rotate();
+
+    std::string filename;
+    int fd = -1;
+    long fileSize = 0;
+
+    int flushIntervalMs = 5000;
+    size_t flushSize = 4096;
+    long maxSegmentSize = 100000000;
+
+    std::thread writerThread;
+    std::mutex mtx;
+    std::condition_variable cv;
+    bool running = false;
+
+    // records which have not been written yet
+    std::string buffer;
+    unsigned long bufferedRecords = 0;
+
+    // flush() waits until all records up to this count are written and synced
+    unsigned long syncRequested = 0;
+    unsigned long recordsSynced = 0;
+    unsigned long recordsAdded = 0;
+
+    std::atomic<unsigned long> recordsWritten{0};
+    std::atomic<unsigned long> segmentsRotated{0};
+};
+
+#endif
@@ -0,0 +1,136 @@
+#include "hrv_metrics.h"
+
+#include <math.h>
+
+HRVMetrics::HRVMetrics(size_t window, unsigned recalcInterval) :
+        window(window < 2 ? 2 : (window > capacity ? capacity : window)),
+        recalcInterval(recalcInterval) {
+}
+
+void HRVMetrics::reset() {
+    gap = false;
+    head = 0;
+    n = 0;
+    mean = 0;
+    m2 = 0;
+    ssd = 0;
+    nn50 = 0;
+    nDifferences = 0;
+    beatsSinceRecalc = 0;
+}
+
+bool HRVMetrics::addRpeak(float bpm, bool successive) {
+    if (bpm <= 0) return false;
+    const double rr = 60000.0 / (double) bpm;
+    if ((rr < minRR) || (rr > maxRR)) {
+        gap = true;
+        return false;
+    }
+    addRR(rr, successive && !gap);
+    gap = false;
+    return true;
+}
+
+void HRVMetrics::addRR(double rr, bool successive) {
+    const bool difference = successive && (n > 0);
+    if (difference) {
+        const double d = rr - ring[(head + n - 1) % capacity];
+        ssd += d * d;
+        if (fabs(d) > nn50threshold) nn50++;
+        nDifferences++;
+    }
+    if (n < window) {
+        n++;
+        const double delta = rr - mean;
+        mean += delta / (double) n;
+        m2 += delta * (rr - mean);
+    } else {
+        // the oldest interval and its difference to the next one leave the window
+        const double old = ring[head];
+        const size_t next = (head + 1) % capacity;
+        if (hasDifference[next]) {
+            const double d = ring[next] - old;
+            ssd -= d * d;
+            if (fabs(d) > nn50threshold) nn50--;
+            nDifferences--;
+            hasDifference[next] = false;
+        }
+        const double prevMean = mean;
+        mean += (rr - old) / (double) n;
+        m2 += (rr - old) * (rr - mean + old - prevMean);
+        head = (head + 1) % capacity;
+    }
+    ring[(head + n - 1) % capacity] = rr;
+    hasDifference[(head + n - 1) % capacity] = difference;
+    if (++beatsSinceRecalc >= recalcInterval) {
+        recalc();
+    }
+}
+
+void HRVMetrics::recalc() {
+    beatsSinceRecalc = 0;
+    double sum = 0;
+    for (size_t i = 0; i < n; i++) {
+        sum += ring[(head + i) % capacity];
+    }
+    mean = n > 0 ? sum / (double) n : 0;
+    m2 = 0;
+    ssd = 0;
+    nn50 = 0;
+    nDifferences = 0;
+    for (size_t i = 0; i < n; i++) {
+        const double rr = ring[(head + i) % capacity];
+        m2 += (rr - mean) * (rr - mean);
+        if ((i > 0) && hasDifference[(head + i) % capacity]) {
+            const double d = rr - ring[(head + i - 1) % capacity];
+            ssd += d * d;
+            if (fabs(d) > nn50threshold) nn50++;
+            nDifferences++;
+        }
+    }
+}
+
+HRVMetrics::Result HRVMetrics::getResult() const {
+    Result r;
+    r.nIntervals = n;
+    if (0 == n) return r;
+    r.meanRR = mean;
+    r.meanHR = 60000.0 / mean;
+    if (n < 2) return r;
+    // the running sums can become slightly negative when the window is constant
+    r.sdnn = m2 > 0 ? sqrt(m2 / (double) (n - 1)) : 0;
+    r.nDifferences = nDifferences;
+    if (0 == nDifferences) return r;
+    r.rmssd = ssd > 0 ? sqrt(ssd / (double) nDifferences) : 0;
+    r.pnn50 = (double) nn50 * 100.0 / (double) nDifferences;
+    return r;
+}
+
+HRVMetrics::Result HRVMetrics::calc(const double* rr, size_t n) {
+    Result r;
+    r.nIntervals = n;
+    if (0 == n) return r;
+    double sum = 0;
+    for (size_t i = 0; i < n; i++) {
+        sum += rr[i];
+    }
+    r.meanRR = sum / (double) n;
+    r.meanHR = 60000.0 / r.meanRR;
+    if (n < 2) return r;
+    double m2 = 0;
+    double ssd = 0;
+    size_t nn50 = 0;
+    for (size_t i = 0; i < n; i++) {
+        m2 += (rr[i] - r.meanRR) * (rr[i] - r.meanRR);
+        if (i > 0) {
+            const double d = rr[i] - rr[i - 1];
+            ssd += d * d;
+            if (fabs(d) > nn50threshold) nn50++;
+        }
+    }
+    r.sdnn = sqrt(m2 / (double) (n - 1));
+    r.nDifferences = n - 1;
+    r.rmssd = sqrt(ssd / (double) (n - 1));
+    r.pnn50 = (double) nn50 * 100.0 / (double) (n - 1);
+    return r;
+}
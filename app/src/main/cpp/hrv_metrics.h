@@ -0,0 +1,106 @@
+#ifndef HRV_METRICS_H
+#define HRV_METRICS_H
+
+#include <stddef.h>
+
+// Time domain heartrate variability over the last RR intervals. The intervals
+// are kept in a ring of fixed capacity and the statistics are updated with
+// running sums when an interval enters and the oldest one leaves the window
+// so that every beat costs the same no matter how long the window is.
+// The sums are recalculated from the ring at regular intervals so that the
+// rounding errors of adding and removing cannot accumulate.
+// An interval which does not follow the previous one directly, for example
+// after a beat which the detector has held back, is kept without a successive
+// difference so that RMSSD and pNN50 only use neighbouring intervals.
+class HRVMetrics {
+
+public:
+    struct Result {
+        // number of RR intervals in the window
+        size_t nIntervals = 0;
+        // mean RR interval in ms
+        double meanRR = 0;
+        // mean heartrate in bpm
+        double meanHR = 0;
+        // standard deviation of the RR intervals in ms
+        double sdnn = 0;
+        // number of successive differences
+        size_t nDifferences = 0;
+        // root mean square of the successive differences in ms
+        double rmssd = 0;
+        // percentage of successive differences larger than 50 ms
+        double pnn50 = 0;
+    };
+
+    // maximum number of RR intervals in the window
+    static constexpr size_t capacity = 512;
+
+    // successive differences larger than this count for pNN50
+    static constexpr double nn50threshold = 50;
+
+    // RR intervals outside of this range in ms are artefacts and are ignored
+    static constexpr double minRR = 250;
+    static constexpr double maxRR = 2000;
+
+    // window: number of RR intervals, 2..capacity
+    // recalcInterval: the sums are recalculated after this number of beats
+    HRVMetrics(size_t window = 60, unsigned recalcInterval = 1000);
+
+    // clears the window
+    void reset();
+
+    // adds the RR interval which the detector has measured for an R peak from
+    // ECG_rr_det::RRlistener::hasRpeak: 60000 / bpm
+    // successive: ECG_rr_det::isPreviousPeakReported(), false if the
+    // previous interval is not the one directly before this one
+    // returns true if a new interval has been added
+    bool addRpeak(float bpm, bool successive);
+
+    // adds an RR interval in ms
+    // successive: false if it does not follow the previous interval directly
+    void addRR(double rr, bool successive = true);
+
+    // the statistics of the current window
+    Result getResult() const;
+
+    // the RR interval added last in ms
+    double getLastRR() const {
+        return n > 0 ? ring[(head + n - 1) % capacity] : 0;
+    }
+
+    size_t getWindow() const {
+        return window;
+    }
+
+    // calculates the statistics of n successive RR intervals from scratch
+    static Result calc(const double* rr, size_t n);
+
+private:
+    // recalculates the sums from the ring
+    void recalc();
+
+    size_t window;
+    unsigned recalcInterval;
+
+    // an interval has been rejected: the next one is not successive
+    bool gap = false;
+
+    double ring[capacity] = {};
+    // the interval has a successive difference to the one before
+    bool hasDifference[capacity] = {};
+    // index of the oldest interval
+    size_t head = 0;
+    size_t n = 0;
+
+    // mean and sum of the squared deviations from the mean (Welford)
+    double mean = 0;
+    double m2 = 0;
+    // sum of the squared successive differences and number larger than 50 ms
+    double ssd = 0;
+    size_t nn50 = 0;
+    size_t nDifferences = 0;
+
+    unsigned beatsSinceRecalc = 0;
+};
+
+#endif
@@ -0,0 +1,174 @@
+#include "hrv_spectrum.h"
+
+#include <math.h>
+#include <chrono>
+
+HRVSpectrum::HRVSpectrum() {
+    for (size_t m = 0; m < windowLength; m++) {
+        roots[m] = std::polar(1.0, -2.0 * M_PI * (double) m / (double) windowLength);
+    }
+    reset();
+}
+
+void HRVSpectrum::reset() {
+    for (auto &b: bins) {
+        b = 0;
+    }
+    for (auto &w: window) {
+        w = 0;
+    }
+    windowPos = 0;
+    nGrid = 0;
+    binToRecalc = 0;
+    hasPrevBeat = false;
+}
+
+size_t HRVSpectrum::addBeat(double t, double rr) {
+    const double maxGap = (double) maxGridPerBeat / gridRate;
+    if ((!hasPrevBeat) || (t <= prevT) || ((t - prevT) > maxGap)) {
+        if (hasPrevBeat) reset();
+        hasPrevBeat = true;
+        prevT = t;
+        prevRR = rr;
+        gridT = t;
+        return 0;
+    }
+    size_t n = 0;
+    while ((gridT <= t) && (n < maxGridPerBeat)) {
+        addGridSample(prevRR + (rr - prevRR) * (gridT - prevT) / (t - prevT));
+        gridT += 1.0 / gridRate;
+        n++;
+    }
+    prevT = t;
+    prevRR = rr;
+    return n;
+}
+
+void HRVSpectrum::addGridSample(double x) {
+    const double d = x - window[windowPos];
+    window[windowPos] = x;
+    windowPos = (windowPos + 1) % windowLength;
+    // X_k = (X_k - oldest + newest) exp(j 2 pi k / windowLength)
+    for (size_t k = 0; k < nBins; k++) {
+        bins[k] = (bins[k] + d) * std::conj(roots[k]);
+    }
+    bins[binToRecalc] = dft(binToRecalc);
+    binToRecalc = (binToRecalc + 1) % nBins;
+    if (nGrid < windowLength) nGrid++;
+}
+
+std::complex<double> HRVSpectrum::dft(size_t k) const {
+    std::complex<double> s = 0;
+    size_t m = 0;
+    for (size_t n = 0; n < windowLength; n++) {
+        s += window[(windowPos + n) & (windowLength - 1)] * roots[m];
+        m = (m + k) & (windowLength - 1);
+    }
+    return s;
+}
+
+HRVSpectrum::Result HRVSpectrum::calc(const std::complex<double>* x) const {
+    Result r;
+    r.valid = nGrid >= windowLength;
+    // one sided power of the Hann windowed bins: 0.375 is the power of the Hann window
+    const double scale = 2.0 / ((double) windowLength * (double) windowLength * 0.375);
+    double power[nBins] = {};
+    for (size_t k = 1; k < (nBins - 1); k++) {
+        const std::complex<double> y = 0.5 * x[k] - 0.25 * (x[k - 1] + x[k + 1]);
+        power[k] = std::norm(y) * scale;
+    }
+    size_t peak = lfFirstBin;
+    for (size_t k = lfFirstBin; k <= hfLastBin; k++) {
+        if (k < hfFirstBin) {
+            r.lf += power[k];
+        } else {
+            r.hf += power[k];
+        }
+        if (power[k] > power[peak]) peak = k;
+    }
+    r.lfhf = r.hf > 0 ? r.lf / r.hf : 0;
+    // parabolic interpolation between the neighbouring bins
+    const double a = power[peak - 1];
+    const double b = power[peak];
+    const double c = power[peak + 1];
+    const double den = a - 2 * b + c;
+    const double offset = den < 0 ? 0.5 * (a - c) / den : 0;
+    r.peakFrequency = ((double) peak + offset) * gridRate / (double) windowLength;
+    return r;
+}
+
+HRVSpectrum::Result HRVSpectrum::getResult() const {
+    return calc(bins);
+}
+
+HRVSpectrum::Result HRVSpectrum::calcExact() const {
+    std::complex<double> x[nBins];
+    for (size_t k = 0; k < nBins; k++) {
+        x[k] = dft(k);
+    }
+    return calc(x);
+}
+
+// beats handled in one go
+const size_t spectrumBatchSize = 16;
+
+// the beats arrive at about 1Hz
+const std::chrono::milliseconds spectrumIdleTime(20);
+
+void HRVSpectrumWorker::start() {
+    if (running) return;
+    running = true;
+    workerThread = std::thread(&HRVSpectrumWorker::worker, this);
+}
+
+void HRVSpectrumWorker::stop() {
+    if (!running) return;
+    running = false;
+    workerThread.join();
+}
+
+void HRVSpectrumWorker::worker() {
+    Beat b[spectrumBatchSize];
+    for (;;) {
+        if (resetRequested.exchange(false)) {
+            spectrum.reset();
+        }
+        const size_t n = beats.pop(b, spectrumBatchSize);
+        if (0 == n) {
+            // all beats queued before stop() have been processed
+            if (!running) return;
+            std::this_thread::sleep_for(spectrumIdleTime);
+            continue;
+        }
+        for (size_t i = 0; i < n; i++) {
+            spectrum.addBeat(b[i].t, b[i].rr);
+        }
+        const HRVSpectrum::Result r = spectrum.getResult();
+        const unsigned seq = resultSeq.load(std::memory_order_relaxed);
+        resultSeq.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        resultValid.store(r.valid, std::memory_order_relaxed);
+        resultLF.store(r.lf, std::memory_order_relaxed);
+        resultHF.store(r.hf, std::memory_order_relaxed);
+        resultPeakFrequency.store(r.peakFrequency, std::memory_order_relaxed);
+        resultSeq.store(seq + 2, std::memory_order_release);
+        if (callback && r.valid) {
+            callback(r);
+        }
+    }
+}
+
+HRVSpectrum::Result HRVSpectrumWorker::getResult() const {
+    HRVSpectrum::Result r;
+    for (;;) {
+        const unsigned seq = resultSeq.load(std::memory_order_acquire);
+        r.valid = resultValid.load(std::memory_order_relaxed);
+        r.lf = resultLF.load(std::memory_order_relaxed);
+        r.hf = resultHF.load(std::memory_order_relaxed);
+        r.peakFrequency = resultPeakFrequency.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (((seq & 1) == 0) && (resultSeq.load(std::memory_order_relaxed) == seq)) break;
+    }
+    r.lfhf = r.hf > 0 ? r.lf / r.hf : 0;
+    return r;
+}
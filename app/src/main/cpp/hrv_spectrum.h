@@ -0,0 +1,161 @@
+#ifndef HRV_SPECTRUM_H
+#define HRV_SPECTRUM_H
+
+#include <stddef.h>
+#include <atomic>
+#include <complex>
+#include <functional>
+#include <thread>
+
+#include "spsc_ring.h"
+
+// Frequency domain heartrate variability. The RR intervals are linearly
+// interpolated onto a uniform grid and a sliding DFT keeps the bins up to
+// the end of the HF band of the last windowLength grid samples. Every grid
+// sample updates all bins and recalculates one of them from the window so
+// that the rounding errors of the sliding DFT cannot accumulate. The Hann
+// window is applied to the bins. A beat adds at most maxGridPerBeat grid
+// samples so that its cost is bounded.
+class HRVSpectrum {
+
+public:
+    struct Result {
+        // true if the window has been filled
+        bool valid = false;
+        // power in the LF band (0.04-0.15Hz) in ms^2
+        double lf = 0;
+        // power in the HF band (0.15-0.4Hz) in ms^2
+        double hf = 0;
+        double lfhf = 0;
+        // frequency with the highest power in the LF and HF bands in Hz
+        double peakFrequency = 0;
+    };
+
+    // sampling rate of the interpolated RR intervals
+    static constexpr double gridRate = 4;
+
+    // 64 secs, a power of two
+    static constexpr size_t windowLength = 256;
+    static_assert((windowLength & (windowLength - 1)) == 0, "The window length must be a power of two.");
+
+    static constexpr double lfLow = 0.04;
+    static constexpr double lfHigh = 0.15;
+    static constexpr double hfHigh = 0.4;
+
+    // the bins of the LF and HF bands
+    static constexpr size_t lfFirstBin = (size_t) (lfLow * windowLength / gridRate) + 1;
+    static constexpr size_t hfFirstBin = (size_t) (lfHigh * windowLength / gridRate) + 1;
+    static constexpr size_t hfLastBin = (size_t) (hfHigh * windowLength / gridRate);
+
+    // bins which are kept: the Hann window and the interpolation of the peak
+    // need two more at the top
+    static constexpr size_t nBins = hfLastBin + 3;
+
+    // a longer gap between beats restarts the analysis: 2 secs as in HRVMetrics
+    static constexpr size_t maxGridPerBeat = (size_t) (gridRate * 2);
+
+    HRVSpectrum();
+
+    void reset();
+
+    // adds a beat at time t in secs with the RR interval rr ending there in ms
+    // returns the number of grid samples added
+    size_t addBeat(double t, double rr);
+
+    // the spectrum of the current window
+    Result getResult() const;
+
+    // calculates the spectrum of the current window from scratch
+    Result calcExact() const;
+
+private:
+    void addGridSample(double x);
+
+    // bin k of the window calculated from scratch
+    std::complex<double> dft(size_t k) const;
+
+    Result calc(const std::complex<double>* bins) const;
+
+    // exp(-j 2 pi m / windowLength)
+    std::complex<double> roots[windowLength];
+
+    std::complex<double> bins[nBins];
+
+    // circular buffer of the grid samples: windowPos is the oldest
+    double window[windowLength] = {};
+    size_t windowPos = 0;
+    size_t nGrid = 0;
+
+    size_t binToRecalc = 0;
+
+    // previous beat and the time of the next grid sample
+    double prevT = 0;
+    double prevRR = 0;
+    bool hasPrevBeat = false;
+    double gridT = 0;
+};
+
+// Runs the HRVSpectrum on its own thread. The detector hands the beats over
+// without waiting and the results are read without waiting for the worker.
+class HRVSpectrumWorker {
+
+public:
+    ~HRVSpectrumWorker() {
+        stop();
+    }
+
+    void start();
+
+    // processes the beats which are still queued and stops the thread
+    void stop();
+
+    // detector thread: queues a beat, dropped if the worker is too far behind
+    void addBeat(double t, double rr) {
+        beats.push({t, rr});
+    }
+
+    // called on the worker thread after new beats once the window has been filled
+    void setCallback(const std::function<void(const HRVSpectrum::Result &)> &f) {
+        callback = f;
+    }
+
+    // any thread: the result after the latest beat
+    HRVSpectrum::Result getResult() const;
+
+    // beats dropped because the worker was too far behind
+    unsigned long getDroppedBeats() const {
+        return beats.getOverruns();
+    }
+
+    // clears the analysis before the next beat
+    void reset() {
+        resetRequested = true;
+    }
+
+private:
+    void worker();
+
+    struct Beat {
+        double t;
+        double rr;
+    };
+
+    SPSCRing<Beat, 256> beats;
+
+    HRVSpectrum spectrum;
+
+    std::thread workerThread;
+    std::atomic<bool> running{false};
+    std::atomic<bool> resetRequested{false};
+
+    std::function<void(const HRVSpectrum::Result &)> callback;
+
+    // sequence lock: odd while the worker writes the result
+    std::atomic<unsigned> resultSeq{0};
+    std::atomic<bool> resultValid{false};
+    std::atomic<double> resultLF{0};
+    std::atomic<double> resultHF{0};
+    std::atomic<double> resultPeakFrequency{0};
+};
+
+#endif
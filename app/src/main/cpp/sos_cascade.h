@@ -0,0 +1,169 @@
+#ifndef SOS_CASCADE_H
+#define SOS_CASCADE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "Iir.h"
+
+// Chain of second order sections in Direct Form II. Several Iir filters
+// can be appended to one cascade so that they run fused in one loop.
+// The coefficients are copied from the Iir designs and the arithmetic
+// is the same as in Iir::DirectFormII so that the output is identical
+// to running the Iir filters one after the other.
+template<int maxStages>
+class SOSCascade {
+
+public:
+    struct Section {
+        double b0 = 1;
+        double b1 = 0;
+        double b2 = 0;
+        double a1 = 0;
+        double a2 = 0;
+    };
+
+    struct State {
+        double v1 = 0;
+        double v2 = 0;
+    };
+
+    // removes all sections
+    void clear() {
+        numStages = 0;
+    }
+
+    // appends the biquads of an Iir filter after the existing sections
+    // returns false if there is no space left
+    bool append(Iir::Cascade &cascade) {
+        if ((numStages + cascade.getNumStages()) > maxStages) return false;
+        for (int i = 0; i < cascade.getNumStages(); i++) {
+            const Iir::Biquad &bq = cascade[i];
+            const double a0 = bq.getA0();
+            Section &s = sections[numStages++];
+            s.b0 = bq.getB0() / a0;
+            s.b1 = bq.getB1() / a0;
+            s.b2 = bq.getB2() / a0;
+            s.a1 = bq.getA1() / a0;
+            s.a2 = bq.getA2() / a0;
+        }
+        return true;
+    }
+
+    void reset() {
+        for (auto &s: states) {
+            s = State();
+        }
+    }
+
+    int getNumStages() const {
+        return numStages;
+    }
+
+    const Section &getSection(int i) const {
+        return sections[i];
+    }
+
+    State &getState(int i) {
+        return states[i];
+    }
+
+    const State &getState(int i) const {
+        return states[i];
+    }
+
+    // bytes of serializeState(): the number of sections as int32 and then v1
+    // and v2 of every section as doubles, in native byte order
+    static constexpr size_t serializedStateSize = 4 + maxStages * 2 * 8;
+
+    void serializeState(uint8_t *out) const {
+        const int32_t n = numStages;
+        memcpy(out, &n, 4);
+        for (int i = 0; i < maxStages; i++) {
+            memcpy(out + 4 + i * 16, &states[i].v1, 8);
+            memcpy(out + 4 + i * 16 + 8, &states[i].v2, 8);
+        }
+    }
+
+    // returns false if the data is too short or from a cascade with another
+    // number of sections
+    bool deserializeState(const uint8_t *in, size_t size) {
+        if (size < serializedStateSize) return false;
+        int32_t n;
+        memcpy(&n, in, 4);
+        if (n != numStages) return false;
+        for (int i = 0; i < maxStages; i++) {
+            memcpy(&states[i].v1, in + 4 + i * 16, 8);
+            memcpy(&states[i].v2, in + 4 + i * 16 + 8, 8);
+        }
+        return true;
+    }
+
+    // sets the states as if the input had been constant forever so that
+    // the filter starts without the transient of a step from zero
+    void initSteadyState(double in) {
+        double x = in;
+        for (int i = 0; i < numStages; i++) {
+            const Section &s = sections[i];
+            const double w = x / (1 + s.a1 + s.a2);
+            states[i].v1 = w;
+            states[i].v2 = w;
+            x = (s.b0 + s.b1 + s.b2) * w;
+        }
+    }
+
+    // filters one sample through all sections
+    inline double filter(double in) {
+        double out = in;
+        for (int i = 0; i < numStages; i++) {
+            const Section &s = sections[i];
+            State &st = states[i];
+            const double w = out - s.a1 * st.v1 - s.a2 * st.v2;
+            out = s.b0 * w + s.b1 * st.v1 + s.b2 * st.v2;
+            st.v2 = st.v1;
+            st.v1 = w;
+        }
+        return out;
+    }
+
+    // filters a block of n samples which are multiplied by gain first
+    // and hands every output to process(double). The state lives in
+    // registers for the whole block. The processing is done in the same
+    // loop so that it overlaps with the recursion of the filter.
+    template<typename T, typename Func>
+    void filter(const T *x, size_t n, double gain, Func process) {
+        if (numStages != maxStages) {
+            for (size_t i = 0; i < n; i++) {
+                process(filter(gain * (double) x[i]));
+            }
+            return;
+        }
+        Section s[maxStages];
+        State st[maxStages];
+        for (int j = 0; j < maxStages; j++) {
+            s[j] = sections[j];
+            st[j] = states[j];
+        }
+        for (size_t i = 0; i < n; i++) {
+            double out = gain * (double) x[i];
+            for (int j = 0; j < maxStages; j++) {
+                const double w = out - s[j].a1 * st[j].v1 - s[j].a2 * st[j].v2;
+                out = s[j].b0 * w + s[j].b1 * st[j].v1 + s[j].b2 * st[j].v2;
+                st[j].v2 = st[j].v1;
+                st[j].v1 = w;
+            }
+            process(out);
+        }
+        for (int j = 0; j < maxStages; j++) {
+            states[j] = st[j];
+        }
+    }
+
+private:
+    Section sections[maxStages];
+    State states[maxStages];
+    int numStages = 0;
+};
+
+#endif
@@ -0,0 +1,124 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <stddef.h>
+#include <atomic>
+
+// Wait-free ring buffer between exactly one producer thread and one
+// consumer thread. The producer never blocks: if the ring is full the
+// element is dropped and counted as an overrun. The read and write
+// positions are on separate cache lines and every thread keeps a copy
+// of the other thread's position so that the shared positions are only
+// read when the copy says that the ring is full or empty.
+// capacity must be a power of two.
+template<typename T, size_t capacity>
+class SPSCRing {
+
+    static_assert((capacity > 0) && ((capacity & (capacity - 1)) == 0),
+                  "The capacity must be a power of two.");
+
+public:
+    // producer: appends an element
+    // returns false if the ring is full and the element has been dropped
+    bool push(const T &t) {
+        const size_t w = writePos.load(std::memory_order_relaxed);
+        if ((w - cachedReadPos) >= capacity) {
+            cachedReadPos = readPos.load(std::memory_order_acquire);
+            if ((w - cachedReadPos) >= capacity) {
+                overruns.store(overruns.load(std::memory_order_relaxed) + 1,
+                               std::memory_order_relaxed);
+                return false;
+            }
+        }
+        buffer[w & (capacity - 1)] = t;
+        writePos.store(w + 1, std::memory_order_release);
+        // the cached read position gives an upper bound of the level
+        if ((w + 1 - cachedReadPos) > highWaterMark.load(std::memory_order_relaxed)) {
+            cachedReadPos = readPos.load(std::memory_order_acquire);
+            const size_t level = w + 1 - cachedReadPos;
+            if (level > highWaterMark.load(std::memory_order_relaxed)) {
+                highWaterMark.store(level, std::memory_order_relaxed);
+            }
+        }
+        return true;
+    }
+
+    // producer: appends n elements with one update of the write position
+    // returns the number of elements appended, the others are overruns
+    size_t push(const T *src, size_t n) {
+        const size_t w = writePos.load(std::memory_order_relaxed);
+        if ((w + n - cachedReadPos) > capacity) {
+            cachedReadPos = readPos.load(std::memory_order_acquire);
+        }
+        const size_t space = capacity - (w - cachedReadPos);
+        const size_t m = n < space ? n : space;
+        for (size_t i = 0; i < m; i++) {
+            buffer[(w + i) & (capacity - 1)] = src[i];
+        }
+        writePos.store(w + m, std::memory_order_release);
+        if (m < n) {
+            overruns.store(overruns.load(std::memory_order_relaxed) + (n - m),
+                           std::memory_order_relaxed);
+        }
+        if ((w + m - cachedReadPos) > highWaterMark.load(std::memory_order_relaxed)) {
+            cachedReadPos = readPos.load(std::memory_order_acquire);
+            const size_t level = w + m - cachedReadPos;
+            if (level > highWaterMark.load(std::memory_order_relaxed)) {
+                highWaterMark.store(level, std::memory_order_relaxed);
+            }
+        }
+        return m;
+    }
+
+    // consumer: copies up to n elements to dest
+    // returns the number of elements copied
+    size_t pop(T *dest, size_t n) {
+        const size_t r = readPos.load(std::memory_order_relaxed);
+        if ((cachedWritePos - r) < n) {
+            cachedWritePos = writePos.load(std::memory_order_acquire);
+        }
+        const size_t available = cachedWritePos - r;
+        if (n > available) n = available;
+        for (size_t i = 0; i < n; i++) {
+            dest[i] = buffer[(r + i) & (capacity - 1)];
+        }
+        readPos.store(r + n, std::memory_order_release);
+        return n;
+    }
+
+    // number of elements waiting: exact only if called by the consumer
+    size_t size() const {
+        return writePos.load(std::memory_order_acquire) - readPos.load(std::memory_order_acquire);
+    }
+
+    static constexpr size_t getCapacity() {
+        return capacity;
+    }
+
+    // maximum number of elements which have been waiting in the ring
+    size_t getHighWaterMark() const {
+        return highWaterMark.load(std::memory_order_relaxed);
+    }
+
+    // number of elements dropped because the ring was full
+    unsigned long getOverruns() const {
+        return overruns.load(std::memory_order_relaxed);
+    }
+
+private:
+    static constexpr size_t cacheLine = 64;
+
+    // written by the producer
+    alignas(cacheLine) std::atomic<size_t> writePos{0};
+    size_t cachedReadPos = 0;
+    std::atomic<size_t> highWaterMark{0};
+    std::atomic<unsigned long> overruns{0};
+
+    // written by the consumer
+    alignas(cacheLine) std::atomic<size_t> readPos{0};
+    size_t cachedWritePos = 0;
+
+    alignas(cacheLine) T buffer[capacity];
+};
+
+#endif
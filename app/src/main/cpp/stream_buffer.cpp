@@ -0,0 +1,101 @@
+#include "stream_buffer.h"
+#include "util.h"
+
+// waiting for a fence: 100ms at a time
+static constexpr GLuint64 fenceTimeout = 100000000;
+
+bool StreamBuffer::create(size_t size, int n, bool map) {
+    destroy();
+    regionSize = (size + alignment - 1) / alignment * alignment;
+    nRegions = n < 1 ? 1 : (n > maxRegions ? maxRegions : n);
+    mapping = map;
+    // errors of earlier calls
+    while (glGetError() != GL_NO_ERROR) {}
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr) (regionSize * (size_t) nRegions), nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    if (glGetError() != GL_NO_ERROR) {
+        ALOGE("Cannot create a stream buffer of %d x %zu bytes", nRegions, regionSize);
+        destroy();
+        return false;
+    }
+    region = nRegions - 1;
+    used = 0;
+    ALOGV("Stream buffer: %d x %zu bytes", nRegions, regionSize);
+    return true;
+}
+
+void StreamBuffer::destroy() {
+    for (auto &f: fences) {
+        if (f) glDeleteSync(f);
+        f = nullptr;
+    }
+    if (buffer) glDeleteBuffers(1, &buffer);
+    buffer = 0;
+    staging.clear();
+}
+
+void StreamBuffer::beginFrame() {
+    region = (region + 1) % nRegions;
+    used = 0;
+    frameBytes = 0;
+    GLsync &f = fences[region];
+    if (!f) return;
+    GLenum r = glClientWaitSync(f, 0, 0);
+    if ((GL_TIMEOUT_EXPIRED == r) || (GL_WAIT_FAILED == r)) {
+        waits++;
+        while (GL_TIMEOUT_EXPIRED == (r = glClientWaitSync(f, GL_SYNC_FLUSH_COMMANDS_BIT, fenceTimeout))) {}
+        if (GL_WAIT_FAILED == r) {
+            ALOGE("Waiting for the stream buffer region %d failed", region);
+        }
+    }
+    glDeleteSync(f);
+    f = nullptr;
+}
+
+void StreamBuffer::endFrame() {
+    if (buffer) {
+        if (fences[region]) glDeleteSync(fences[region]);
+        fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+    lastFrameBytes = frameBytes;
+    totalBytes += frameBytes;
+    frames++;
+}
+
+void *StreamBuffer::map(size_t size) {
+    if ((!buffer) || mapped || ((used + size) > regionSize)) return nullptr;
+    mappedOffset = (GLintptr) ((size_t) region * regionSize + used);
+    mappedSize = size;
+    used += (size + alignment - 1) / alignment * alignment;
+    mapped = true;
+    if (mapping) {
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        void *p = glMapBufferRange(GL_ARRAY_BUFFER, mappedOffset, (GLsizeiptr) size,
+                                   GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT |
+                                   GL_MAP_INVALIDATE_RANGE_BIT);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        if (p) return p;
+        ALOGE("Cannot map the stream buffer: uploading with glBufferSubData");
+        mapping = false;
+    }
+    if (staging.size() < regionSize) staging.resize(regionSize);
+    return staging.data();
+}
+
+GLintptr StreamBuffer::unmap() {
+    if (!mapped) return 0;
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    if (mapping) {
+        if (glUnmapBuffer(GL_ARRAY_BUFFER) == GL_FALSE) {
+            ALOGE("The stream buffer has been corrupted while mapped");
+        }
+    } else {
+        glBufferSubData(GL_ARRAY_BUFFER, mappedOffset, (GLsizeiptr) mappedSize, staging.data());
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    mapped = false;
+    frameBytes += mappedSize;
+    return mappedOffset;
+}
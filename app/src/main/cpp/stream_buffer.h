@@ -0,0 +1,114 @@
+#ifndef STREAM_BUFFER_H
+#define STREAM_BUFFER_H
+
+#include <stddef.h>
+#include <vector>
+
+#include <GLES3/gl3.h>
+
+// One vertex buffer for the geometry which is written anew every frame,
+// split into a region for every frame in flight. A frame writes into its
+// region through glMapBufferRange() with GL_MAP_UNSYNCHRONIZED_BIT and
+// GL_MAP_INVALIDATE_RANGE_BIT, so that the driver neither reallocates the
+// buffer nor copies the data as with glBufferData(), and fences the region
+// at the end. A region is only written again once its fence has been
+// signalled, i.e. the GPU has finished the draws of that frame. The fence
+// of the oldest frame has normally been signalled long before. GLES 3.0 has
+// no persistent mapping, so the region is mapped while it is written and
+// unmapped before the draws. If mapping fails the data is written into
+// memory and uploaded with glBufferSubData(). Counts the bytes uploaded
+// per frame, including the ones which the other geometry uploads itself.
+class StreamBuffer {
+
+public:
+    static constexpr int maxRegions = 4;
+
+    // offsets of the allocations are aligned to this
+    static constexpr size_t alignment = 256;
+
+    ~StreamBuffer() {
+        destroy();
+    }
+
+    // creates the buffer with nRegions regions of regionSize bytes
+    // mapping: false to always upload with glBufferSubData()
+    bool create(size_t regionSize, int nRegions = 3, bool mapping = true);
+
+    // deletes the buffer and the fences
+    void destroy();
+
+    // start of a frame: the next region, waits for the GPU if it still reads it
+    void beginFrame();
+
+    // end of the frame: fences the region after the draws which use it
+    void endFrame();
+
+    // memory for size bytes in the region of the frame to be written
+    // until unmap(). Null if the region is full.
+    void *map(size_t size);
+
+    // ends writing the memory of map()
+    // returns the offset of the memory in the buffer for glVertexAttribPointer()
+    GLintptr unmap();
+
+    // bytes which the geometry has uploaded into its own buffers in this frame
+    void countUpload(size_t bytes) {
+        frameBytes += bytes;
+    }
+
+    GLuint getBuffer() const {
+        return buffer;
+    }
+
+    size_t getRegionSize() const {
+        return regionSize;
+    }
+
+    // bytes uploaded in the last complete frame
+    size_t getLastFrameBytes() const {
+        return lastFrameBytes;
+    }
+
+    unsigned long long getTotalBytes() const {
+        return totalBytes;
+    }
+
+    unsigned long getFrames() const {
+        return frames;
+    }
+
+    // frames which had to wait for the GPU to finish with their region
+    unsigned long getWaits() const {
+        return waits;
+    }
+
+    // false if the data is uploaded with glBufferSubData()
+    bool isMapping() const {
+        return mapping;
+    }
+
+private:
+    GLuint buffer = 0;
+    size_t regionSize = 0;
+    int nRegions = 0;
+    bool mapping = true;
+
+    int region = 0;
+    size_t used = 0;
+    GLsync fences[maxRegions] = {};
+
+    // the allocation of map()
+    GLintptr mappedOffset = 0;
+    size_t mappedSize = 0;
+    bool mapped = false;
+    // if mapping fails
+    std::vector<unsigned char> staging;
+
+    size_t frameBytes = 0;
+    size_t lastFrameBytes = 0;
+    unsigned long long totalBytes = 0;
+    unsigned long frames = 0;
+    unsigned long waits = 0;
+};
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <stddef.h>
+#include <atomic>
+
+// Wait-free handoff of the latest state from exactly one producer thread to
+// one consumer thread, for example from the DSP thread to the render loop.
+// The producer fills its back buffer and publishes it by swapping it with
+// the middle buffer. The consumer swaps its front buffer with the middle
+// one if a new state has been published since. Neither thread ever waits
+// for the other: states which the consumer has not picked up are simply
+// overwritten and the front buffer stays untouched until the next update().
+// The buffers are reused, so T should not allocate once it has been filled.
+template<typename T>
+class TripleBuffer {
+
+public:
+    // producer: the buffer to fill, it holds the state of an earlier publish()
+    T &getWriteBuffer() {
+        return buffers[back];
+    }
+
+    // producer: hands the write buffer to the consumer
+    void publish() {
+        const unsigned prev = middle.exchange(back | dirty, std::memory_order_acq_rel);
+        back = prev & indexMask;
+        published.store(published.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    // producer: copies t into the write buffer and publishes it
+    void publish(const T &t) {
+        buffers[back] = t;
+        publish();
+    }
+
+    // consumer: makes the latest published state the read buffer
+    // returns true if it has changed since the last call
+    bool update() {
+        if (!(middle.load(std::memory_order_relaxed) & dirty)) return false;
+        const unsigned prev = middle.exchange(front, std::memory_order_acq_rel);
+        front = prev & indexMask;
+        return true;
+    }
+
+    // consumer: the state which update() has picked up last
+    const T &getReadBuffer() const {
+        return buffers[front];
+    }
+
+    // number of states published so far
+    unsigned long getPublished() const {
+        return published.load(std::memory_order_relaxed);
+    }
+
+private:
+    static constexpr size_t cacheLine = 64;
+    static constexpr unsigned indexMask = 3;
+    // set in middle while it holds a state which the consumer has not seen
+    static constexpr unsigned dirty = 4;
+
+    alignas(cacheLine) T buffers[3] = {};
+
+    // index of the middle buffer and the dirty flag
+    alignas(cacheLine) std::atomic<unsigned> middle{1};
+
+    // owned by the producer
+    alignas(cacheLine) unsigned back = 0;
+    std::atomic<unsigned long> published{0};
+
+    // owned by the consumer
+    alignas(cacheLine) unsigned front = 2;
+};
+
+#endif
@@ -0,0 +1,280 @@
+#include "wave_mesh.h"
+
+#include <math.h>
+
+// 1 - cos(u) for |u| <= pi/2: Taylor series up to u^12, error below 1E-8
+static inline float oneMinusCos(float u) {
+    const float u2 = u * u;
+    return u2 * (0.5f - u2 * (1.0f / 24.0f - u2 * (1.0f / 720.0f - u2 * (1.0f / 40320.0f -
+            u2 * (1.0f / 3628800.0f - u2 * (1.0f / 479001600.0f))))));
+}
+
+WaveMesh::WaveMesh(int gridSize, double scale, size_t profileLength, int nWorkers) :
+        gridSize(gridSize),
+        rowLength(gridSize + 1),
+        nVertices((gridSize + 1) * (gridSize + 1)) {
+    const double delta = 2.0 / (double) gridSize;
+    for (int i = 0; i < rowLength; i++) {
+        gridX.push_back((float) (((double) i * delta - 1.0) * scale));
+        gridZ.push_back((float) (((double) i * delta - 1.0) * scale));
+    }
+    for (int i = 0; i < gridSize; i++) {
+        dX.push_back(gridX[i] - gridX[i + 1]);
+        dZ.push_back(gridZ[i] - gridZ[i + 1]);
+    }
+    // the radius of every vertex as an index into the profile
+    const double maxr = sqrt((double) gridSize * (double) gridSize);
+    size_t maxIndex = 0;
+    for (int y = 0; y < rowLength; y++) {
+        for (int x = 0; x < rowLength; x++) {
+            const double xc = (double) x - ((double) gridSize / 2.0);
+            const double yc = (double) y - ((double) gridSize / 2.0);
+            size_t r = (size_t) round(sqrt(yc * yc + xc * xc) / maxr * (double) profileLength);
+            // beyond the profile: its last index
+            if (r >= profileLength) r = profileLength - 1;
+            radialIndex.push_back((uint16_t) r);
+            if (r > maxIndex) maxIndex = r;
+        }
+    }
+    this->profileLength = maxIndex + 1;
+    height.resize(nVertices, 0.0f);
+    nx.resize(nVertices, 0.0f);
+    ny.resize(nVertices, 1.0f);
+    nz.resize(nVertices, 0.0f);
+    nChunks = nWorkers > 0 ? nWorkers + 1 : 1;
+    boundaryRows.resize(nChunks, std::vector<float>(rowLength, 0.0f));
+    for (int i = 1; i < nChunks; i++) {
+        workers.emplace_back(&WaveMesh::worker, this, i);
+    }
+}
+
+WaveMesh::~WaveMesh() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        running = false;
+    }
+    cv.notify_all();
+    for (auto &w: workers) {
+        w.join();
+    }
+}
+
+void WaveMesh::heightRow(int y, float *h) const {
+    const uint16_t *ri = radialIndex.data() + y * rowLength;
+    for (int x = 0; x < rowLength; x++) {
+        h[x] = profile[ri[x]];
+    }
+    const float pi = (float) M_PI;
+    const float invPi = (float) (1.0 / M_PI);
+    // pi in two parts so that n * piHi is exact
+    const float piHi = 3.140625f;
+    const float piLo = (float) (M_PI - 3.140625);
+    for (size_t w = 0; w < nWaves; w++) {
+        const RowWave &rw = rowWaves[w];
+        // |sin| has the period pi: the phase at the start of the row in [0, pi)
+        double b = rw.phase0 + rw.stepY * (double) y;
+        b -= M_PI * floor(b / M_PI);
+        const float s = rw.stepX;
+        // positive along the whole row so that truncation rounds down
+        if (s < 0) b += M_PI * ceil(-(double) s * (double) gridSize / M_PI);
+        const float b0 = (float) b - pi / 2;
+        const float a = waveAmplitude;
+        for (int x = 0; x < rowLength; x++) {
+            // |sin(p)| = cos(u) with u = p - pi/2 reduced to [-pi/2, pi/2]
+            const float v = b0 + s * (float) x;
+            const float n = (float) (int) (v * invPi + 0.5f);
+            const float u = (v - n * piHi) - n * piLo;
+            h[x] += a * oneMinusCos(u);
+        }
+    }
+}
+
+void WaveMesh::normalRow(int y, const float *__restrict h0, const float *__restrict h1) {
+    const int o = y * rowLength;
+    float *__restrict rx = nx.data() + o;
+    float *__restrict ry = ny.data() + o;
+    float *__restrict rz = nz.data() + o;
+    const float *__restrict dx = dX.data();
+    const float dz = dZ[y];
+    for (int x = 0; x < gridSize; x++) {
+        // the mean of the cross products of the triangles (x,y) (x+1,y+1) (x+1,y)
+        // and (x,y) (x,y+1) (x+1,y), see OvrHRPlot::CreateGeometry()
+        const float h00 = h0[x];
+        const float h10 = h0[x + 1];
+        const float h01 = h1[x];
+        const float h11 = h1[x + 1];
+        rx[x] = -dz * (h00 - h10);
+        ry[x] = dz * dx[x];
+        rz[x] = dx[x] * ((h11 - h10) - (h00 - h01)) * 0.5f;
+    }
+    // the last column has no quad
+    rx[gridSize] = 0;
+    ry[gridSize] = 1;
+    rz[gridSize] = 0;
+}
+
+void WaveMesh::writeRow(int y) const {
+    const int o = y * rowLength;
+    if (outVertices) {
+        float (*vertices)[3] = outVertices;
+        const float z = gridZ[y];
+        for (int x = 0; x < rowLength; x++) {
+            vertices[o + x][0] = gridX[x];
+            vertices[o + x][1] = height[o + x];
+            vertices[o + x][2] = z;
+        }
+    }
+    if (outNormals) {
+        float (*normals)[3] = outNormals;
+        for (int x = 0; x < rowLength; x++) {
+            normals[o + x][0] = nx[o + x];
+            normals[o + x][1] = ny[o + x];
+            normals[o + x][2] = nz[o + x];
+        }
+    }
+    const int n = rowLength;
+    if (outHeights) {
+        uint16_t *__restrict heights = outHeights + o;
+        const float *__restrict h = height.data() + o;
+        for (int x = 0; x < n; x++) {
+            heights[x] = toHalf(h[x]);
+        }
+    }
+    if (outPackedNormals) {
+        uint32_t *__restrict normals = outPackedNormals + o;
+        const float *__restrict rx = nx.data() + o;
+        const float *__restrict ry = ny.data() + o;
+        const float *__restrict rz = nz.data() + o;
+        for (int x = 0; x < n; x++) {
+            normals[x] = packNormal(rx[x], ry[x], rz[x]);
+        }
+    }
+}
+
+void WaveMesh::chunk(int i, int n) {
+    const int y0 = rowLength * i / n;
+    const int y1 = rowLength * (i + 1) / n;
+    if (heights) {
+        for (int y = y0; y < y1; y++) {
+            heightRow(y, height.data() + y * rowLength);
+        }
+    }
+    // the heights of the next chunk may not have been computed yet
+    float *boundary = height.data() + y1 * rowLength;
+    if (heights && (y1 < rowLength)) {
+        boundary = boundaryRows[i].data();
+        heightRow(y1, boundary);
+    }
+    for (int y = y0; y < y1; y++) {
+        if (y < gridSize) {
+            const float *h1 = (y + 1) < y1 ? height.data() + (y + 1) * rowLength : boundary;
+            normalRow(y, height.data() + y * rowLength, h1);
+        }
+        writeRow(y);
+    }
+}
+
+void WaveMesh::generate(double t, const float *profile, const Wave *waves, size_t nWaves, float waveAmplitude,
+                        float (*vertices)[3], float (*normals)[3]) {
+    outVertices = vertices;
+    outNormals = normals;
+    outHeights = nullptr;
+    outPackedNormals = nullptr;
+    compute(t, profile, waves, nWaves, waveAmplitude);
+}
+
+void WaveMesh::generate(double t, const float *profile, const Wave *waves, size_t nWaves, float waveAmplitude,
+                        uint16_t *heights, uint32_t *normals) {
+    outVertices = nullptr;
+    outNormals = nullptr;
+    outHeights = heights;
+    outPackedNormals = normals;
+    compute(t, profile, waves, nWaves, waveAmplitude);
+}
+
+void WaveMesh::compute(double t, const float *profile, const Wave *waves, size_t nWaves, float waveAmplitude) {
+    this->profile = profile;
+    this->nWaves = nWaves < maxWaves ? nWaves : maxWaves;
+    this->waveAmplitude = waveAmplitude;
+    // the waves have always been centred on the vertex (gridSize + 1) / 2
+    const double centre = (double) ((gridSize + 1) / 2);
+    const double maxr = sqrt((double) gridSize * (double) gridSize);
+    for (size_t w = 0; w < this->nWaves; w++) {
+        const double sx = waves[w].spatialFreqX / maxr;
+        const double sy = waves[w].spatialFreqY / maxr;
+        rowWaves[w].stepX = (float) sx;
+        rowWaves[w].stepY = sy;
+        rowWaves[w].phase0 = fmod(t * waves[w].temporalFreq, M_PI) - centre * sx - centre * sy;
+    }
+    heights = true;
+    if (workers.empty()) {
+        chunk(0, 1);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        frame++;
+        pending = (int) workers.size();
+    }
+    cv.notify_all();
+    chunk(0, nChunks);
+    std::unique_lock<std::mutex> lock(mtx);
+    done.wait(lock, [this] { return 0 == pending; });
+}
+
+void WaveMesh::generateNormals(float (*normals)[3]) {
+    outVertices = nullptr;
+    outNormals = normals;
+    outHeights = nullptr;
+    outPackedNormals = nullptr;
+    computeNormals();
+}
+
+void WaveMesh::generateNormals(uint32_t *normals) {
+    outVertices = nullptr;
+    outNormals = nullptr;
+    outHeights = nullptr;
+    outPackedNormals = normals;
+    computeNormals();
+}
+
+void WaveMesh::computeNormals() {
+    heights = false;
+    for (int y = 0; y < rowLength; y++) {
+        if (y < gridSize) {
+            normalRow(y, height.data() + y * rowLength, height.data() + (y + 1) * rowLength);
+        }
+        writeRow(y);
+    }
+}
+
+void WaveMesh::getStripIndices(uint16_t *indices) const {
+    int i = 0;
+    for (int y = 0; y < gridSize; y++) {
+        if (y > 0) indices[i++] = restartIndex;
+        // (x,y+1) (x,y) (x+1,y+1) (x+1,y) ...: the triangles
+        // (x,y+1) (x,y) (x+1,y+1) and (x,y) (x+1,y+1) (x+1,y)
+        for (int x = 0; x < rowLength; x++) {
+            indices[i++] = (uint16_t) ((y + 1) * rowLength + x);
+            indices[i++] = (uint16_t) (y * rowLength + x);
+        }
+    }
+}
+
+void WaveMesh::worker(int i) {
+    unsigned long seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            cv.wait(lock, [this, seen] { return (frame != seen) || (!running); });
+            if (!running) return;
+            seen = frame;
+        }
+        chunk(i, nChunks);
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            pending--;
+        }
+        done.notify_one();
+    }
+}
@@ -0,0 +1,233 @@
+#ifndef WAVE_MESH_H
+#define WAVE_MESH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// The heights and normals of the wave grid of OvrHRPlot. The height of a
+// vertex is the heartrate at its distance from the centre plus the sum of
+// waves of 1 - |sin(phase)|. The distances are turned into indices of the
+// radial profile once. The heights and normals are kept as separate float
+// arrays (structure of arrays). The phase of a wave is linear along a row,
+// so it is reduced in double at the start of every row and then stepped in
+// float. A polynomial in float gives |sin|. The loops over a row have no
+// branches, so that the compiler can vectorise them. A normal is the mean
+// of the cross products of the two triangles at its vertex, written out in
+// closed form. The rows are split across the calling thread and a small
+// pool of workers. Every worker also computes the heights of the row after
+// its last one, so that it needs no other worker for its normals and a
+// frame needs one handoff to the workers.
+// The vertex buffer can either be interleaved floats of the positions and
+// normals or the compact layout: the heights as half floats and the normals
+// packed into GL_INT_2_10_10_10_REV, while x and z are uploaded once.
+class WaveMesh {
+
+public:
+    // ends a triangle strip, GL_PRIMITIVE_RESTART_FIXED_INDEX
+    static constexpr uint16_t restartIndex = 0xffff;
+
+    // float to half float, rounded to nearest even. Without branches so that
+    // the loops over a row can be vectorised.
+    static inline uint16_t toHalf(float f) {
+        uint32_t u;
+        memcpy(&u, &f, sizeof(u));
+        const uint32_t sign = (u >> 16) & 0x8000;
+        u &= 0x7fffffff;
+        // normal: rebias the exponent and round the mantissa
+        const uint32_t normal = (u + 0xc8000fff + ((u >> 13) & 1)) >> 13;
+        // subnormal: the addition of 0.5 rounds the mantissa
+        float a;
+        memcpy(&a, &u, sizeof(a));
+        a += 0.5f;
+        uint32_t subnormal;
+        memcpy(&subnormal, &a, sizeof(subnormal));
+        subnormal -= 0x3f000000;
+        // selected with masks
+        const uint32_t isSubnormal = 0 - (uint32_t) (u < 0x38800000);
+        uint32_t r = (subnormal & isSubnormal) | (normal & ~isSubnormal);
+        // too large: infinity, or NaN
+        const uint32_t isLarge = 0 - (uint32_t) (u >= 0x47800000);
+        const uint32_t inf = 0x7c00 | ((uint32_t) (u > 0x7f800000) << 9);
+        r = (inf & isLarge) | (r & ~isLarge);
+        return (uint16_t) (sign | r);
+    }
+
+    // normal to GL_INT_2_10_10_10_REV, normalised: x in bits 0-9, y 10-19, z 20-29.
+    // 1/sqrt from the exponent and two Newton steps, an error well below 1/511, as sqrtf()
+    // would not be vectorised because of errno.
+    static inline uint32_t packNormal(float x, float y, float z) {
+        const float l2 = x * x + y * y + z * z;
+        uint32_t u;
+        memcpy(&u, &l2, sizeof(u));
+        u = 0x5f3759df - (u >> 1);
+        float r;
+        memcpy(&r, &u, sizeof(r));
+        r = r * (1.5f - 0.5f * l2 * r * r);
+        r = r * (1.5f - 0.5f * l2 * r * r);
+        const float s = 511.0f * r;
+        x *= s;
+        y *= s;
+        z *= s;
+        const int ix = (int) (x + (x < 0 ? -0.5f : 0.5f));
+        const int iy = (int) (y + (y < 0 ? -0.5f : 0.5f));
+        const int iz = (int) (z + (z < 0 ? -0.5f : 0.5f));
+        return ((uint32_t) ix & 0x3ff) | (((uint32_t) iy & 0x3ff) << 10) | (((uint32_t) iz & 0x3ff) << 20);
+    }
+
+    // a wave: 1 - |sin(spatialFreqX * x + spatialFreqY * y + temporalFreq * t)|
+    // with x and y relative to the centre and divided by the grid size
+    struct Wave {
+        double temporalFreq = 1;
+        double spatialFreqX = 0;
+        double spatialFreqY = 0;
+    };
+
+    // gridSize: quads per side, the vertices span +/- scale
+    // profileLength: radial profile from the centre to the corners
+    // nWorkers: threads in addition to the calling thread
+    WaveMesh(int gridSize, double scale, size_t profileLength, int nWorkers);
+
+    ~WaveMesh();
+
+    WaveMesh(const WaveMesh &) = delete;
+    WaveMesh &operator=(const WaveMesh &) = delete;
+
+    // length of the radial profile which is used: up to the corners
+    size_t getProfileLength() const {
+        return profileLength;
+    }
+
+    // heights and normals at time t
+    // profile: height at the radial indices 0..getProfileLength()-1
+    // waves: scaled by waveAmplitude and added
+    // vertices, normals: interleaved xyz of the vertex buffer or null,
+    // every element is written so that they can be mapped GL memory
+    void generate(double t, const float *profile, const Wave *waves, size_t nWaves, float waveAmplitude,
+                  float (*vertices)[3], float (*normals)[3]);
+
+    // the same into the compact layout
+    // heights: half floats, normals: GL_INT_2_10_10_10_REV
+    void generate(double t, const float *profile, const Wave *waves, size_t nWaves, float waveAmplitude,
+                  uint16_t *heights, uint32_t *normals);
+
+    // normals of the current heights, for example if they have been changed
+    void generateNormals(float (*normals)[3]);
+
+    void generateNormals(uint32_t *normals);
+
+    // indices of the grid as triangle strips, one per row, separated by restartIndex.
+    // The same triangles as two per quad with the diagonal from (x,y) to (x+1,y+1).
+    int getNumStripIndices() const {
+        return gridSize * 2 * rowLength + gridSize - 1;
+    }
+
+    void getStripIndices(uint16_t *indices) const;
+
+    int getNumVertices() const {
+        return nVertices;
+    }
+
+    float *getHeights() {
+        return height.data();
+    }
+
+    const float *getNormalX() const {
+        return nx.data();
+    }
+
+    const float *getNormalY() const {
+        return ny.data();
+    }
+
+    const float *getNormalZ() const {
+        return nz.data();
+    }
+
+    // coordinates of column x and row y, as in OvrHRPlot::CreateGeometry()
+    float getX(int x) const {
+        return gridX[x];
+    }
+
+    float getZ(int y) const {
+        return gridZ[y];
+    }
+
+private:
+    static constexpr size_t maxWaves = 4;
+
+    // sets the waves of the frame and computes it
+    void compute(double t, const float *profile, const Wave *waves, size_t nWaves, float waveAmplitude);
+
+    // normals of the current heights into the outputs
+    void computeNormals();
+
+    // per frame: a wave along a row
+    struct RowWave {
+        float stepX;
+        double stepY;
+        double phase0;
+    };
+
+    // heights of row y into h
+    void heightRow(int y, float *h) const;
+
+    // normals of row y from the heights of rows y and y + 1
+    void normalRow(int y, const float *h0, const float *h1);
+
+    // writes row y into the vertex buffer
+    void writeRow(int y) const;
+
+    // rows of chunk i of n
+    void chunk(int i, int n);
+
+    // computes chunk i
+    void worker(int i);
+
+    const int gridSize;
+    const int rowLength;
+    const int nVertices;
+
+    std::vector<float> gridX;
+    std::vector<float> gridZ;
+    // differences of the coordinates to the next column and row
+    std::vector<float> dX;
+    std::vector<float> dZ;
+
+    std::vector<uint16_t> radialIndex;
+    size_t profileLength = 0;
+
+    std::vector<float> height;
+    std::vector<float> nx;
+    std::vector<float> ny;
+    std::vector<float> nz;
+
+    // per frame
+    const float *profile = nullptr;
+    RowWave rowWaves[maxWaves] = {};
+    size_t nWaves = 0;
+    float waveAmplitude = 0;
+    float (*outVertices)[3] = nullptr;
+    float (*outNormals)[3] = nullptr;
+    uint16_t *outHeights = nullptr;
+    uint32_t *outPackedNormals = nullptr;
+    bool heights = true;
+
+    // the heights of the row after a chunk
+    std::vector<std::vector<float> > boundaryRows;
+
+    int nChunks = 1;
+    std::vector<std::thread> workers;
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::condition_variable done;
+    unsigned long frame = 0;
+    int pending = 0;
+    bool running = true;
+};
+
+#endif
@@ -6,24 +6,20 @@ import android.os.Bundle;
 import android.util.Log;
 
 import java.io.File;
-import java.io.FileOutputStream;
-import java.io.IOException;
-import java.io.OutputStreamWriter;
-import java.io.PrintWriter;
-import java.util.Locale;
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
 
 import tech.glasgowneuro.attyscomm.AttysComm;
 
 public class ANativeActivity extends android.app.NativeActivity {
   static final String TAG = "AttysHRV";
   static final String HR_FILE = "attyshrv_heartrate.tsv";
+  static final String RAW_FILE = "attyshrv_recording.dat";
 
   static private long instance = 0;
 
   static AttysComm attysComm;
 
-  static PrintWriter rawdatalog = null;
-
   static {
     System.loadLibrary("openxr_loader");
     System.loadLibrary("attyshrv");
@@ -31,6 +27,9 @@ public class ANativeActivity extends android.app.NativeActivity {
 
   static native void setHRfilePath(String path);
 
+  // the raw data and the beats are recorded by the native code (chunk_file.h)
+  static native void setRawFilePath(String path);
+
   @Override
   protected void onCreate (Bundle savedInstanceState) {
     super.onCreate(savedInstanceState);
@@ -38,36 +37,49 @@ public class ANativeActivity extends android.app.NativeActivity {
     String full_hr_file_path = fullpath.getAbsolutePath();
     Log.d(TAG,"Full path to local dir: "+full_hr_file_path);
     setHRfilePath(full_hr_file_path);
-    // raw data
-    try {
-      File logFile = new File(getBaseContext().getExternalFilesDir(null), "raw.csv");
-      rawdatalog =  new PrintWriter(new FileOutputStream(fullpath, true));
-    }
-    catch (IOException e) {
-      Log.e(TAG, "Raw log file could not be opened: ", e);
-    }
+    File rawpath = new File(getBaseContext().getExternalFilesDir(null), RAW_FILE);
+    setRawFilePath(rawpath.getAbsolutePath());
   }
 
-  @Override
-  public void onDestroy() {
-    super.onDestroy();
-    rawdatalog.close();
-  }
+  // The samples are handed over to the native code in batches through a
+  // direct buffer so that there is one JNI call per batch and no copying.
+  // Per sample: sample number (long), channel 1 and channel 2 (float)
+  // in native byte order.
+  static final int BATCH_SIZE = 10;
+  static final int BYTES_PER_SAMPLE = 16;
+  static final ByteBuffer batchBuffer = ByteBuffer.allocateDirect(BATCH_SIZE * BYTES_PER_SAMPLE)
+          .order(ByteOrder.nativeOrder());
+  static int batchCount = 0;
 
-  static native void dataUpdate(long inst, float v);
+  static native void dataUpdateBatch(long inst, ByteBuffer buffer, int n);
 
   static AttysComm.DataListener dataListener = new AttysComm.DataListener() {
     @Override
     public void gotData(long l, float[] f) {
-      double v = f[AttysComm.INDEX_Analogue_channel_1];
-      dataUpdate(instance, (float) v);
-      String s = String.format(Locale.US, "%d,%f,%f\n",
-              System.currentTimeMillis(), v, f[AttysComm.INDEX_Analogue_channel_2]);
-      rawdatalog.write(s);
-      rawdatalog.flush();
+      synchronized (batchBuffer) {
+        final int offset = batchCount * BYTES_PER_SAMPLE;
+        batchBuffer.putLong(offset, l);
+        batchBuffer.putFloat(offset + 8, f[AttysComm.INDEX_Analogue_channel_1]);
+        batchBuffer.putFloat(offset + 12, f[AttysComm.INDEX_Analogue_channel_2]);
+        batchCount++;
+        if (batchCount == BATCH_SIZE) {
+          dataUpdateBatch(instance, batchBuffer, batchCount);
+          batchCount = 0;
+        }
+      }
     }
   };
 
+  // hands over a partly filled batch
+  static void flushBatch() {
+    synchronized (batchBuffer) {
+      if (batchCount > 0) {
+        dataUpdateBatch(instance, batchBuffer, batchCount);
+        batchCount = 0;
+      }
+    }
+  }
+
   static native void initJava2CPP(float fs);
 
   static void startAttysComm(long inst) {
@@ -77,6 +89,7 @@ public class ANativeActivity extends android.app.NativeActivity {
     }
     Log.d(TAG, "Starting AttysComm");
     instance = inst;
+    batchCount = 0;
     attysComm = new AttysComm();
     attysComm.registerDataListener(dataListener);
     attysComm.setAdc_samplingrate_index(AttysComm.ADC_RATE_250HZ);
@@ -87,5 +100,7 @@ public class ANativeActivity extends android.app.NativeActivity {
   static void stopAttysComm() {
     Log.d(TAG,"Stopping AttysComm");
     attysComm.stop();
+    // the last samples of the session
+    flushBatch();
   }
 }
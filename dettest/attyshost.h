@@ -0,0 +1,19 @@
+#ifndef ATTYSHOST_H
+#define ATTYSHOST_H
+
+// The JNI entry points of attysjava2cpp.cpp which ANativeActivity.java
+// calls on the device. On the host they are called directly with the
+// stand-ins for jni.h in hoststubs.
+
+#include <jni.h>
+#include "../app/src/main/cpp/attysjava2cpp.h"
+
+extern "C" {
+void Java_tech_glasgowneuro_attyshrv_ANativeActivity_initJava2CPP(JNIEnv *env, jclass clazz, jfloat fs);
+void Java_tech_glasgowneuro_attyshrv_ANativeActivity_dataUpdateBatch(JNIEnv *env, jclass, jlong,
+								     jobject buffer, jint n);
+void Java_tech_glasgowneuro_attyshrv_ANativeActivity_setHRfilePath(JNIEnv *env, jclass clazz, jstring path);
+void Java_tech_glasgowneuro_attyshrv_ANativeActivity_setRawFilePath(JNIEnv *env, jclass, jstring path);
+}
+
+#endif
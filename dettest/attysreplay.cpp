@@ -0,0 +1,103 @@
+#include "attysreplay.h"
+#include "attyshost.h"
+#include "../app/src/main/cpp/attysjava2cpp.h"
+#include "../app/src/main/cpp/chunk_reader.h"
+#include "ecgreader.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+// samples processed by the DSP thread of the app
+static std::atomic<size_t> processed(0);
+
+// as fast as possible: samples in the queue before waiting for the DSP
+// thread, half of its 1024 entries
+const size_t maxQueued = 512;
+
+bool AttysReplay::load(const std::string &filename) {
+	samples.clear();
+	FILE* f = fopen(filename.c_str(),"rb");
+	if (!f) return false;
+	char magic[sizeof(ChunkFile::FileHeader::magic)] = {};
+	const bool hasMagic = fread(magic,sizeof(magic),1,f) == 1;
+	fclose(f);
+	if (hasMagic && (memcmp(magic,ChunkFile::magic,sizeof(magic)) == 0)) {
+		return loadChunks(filename);
+	}
+	return loadText(filename);
+}
+
+bool AttysReplay::loadChunks(const std::string &filename) {
+	ChunkReader reader;
+	if (!reader.open(filename)) return false;
+	fs = reader.getSamplingRate();
+	std::vector<ChunkFile::SampleRecord> r;
+	for(auto &e : reader.getChunks(ChunkFile::Samples)) {
+		r.resize(e.count);
+		if (!reader.readSamples(e,r.data())) continue;
+		for(size_t i = 0; i < e.count; i++) {
+			samples.push_back({r[i].ch1,r[i].ch2});
+		}
+	}
+	return !samples.empty();
+}
+
+bool AttysReplay::loadText(const std::string &filename) {
+	std::vector<float> c[3];
+	for(unsigned k = 0; k < 3; k++) {
+		if (!loadECG(filename,c[k],k)) break;
+	}
+	// ms since the epoch, ch1, ch2 as written by the app or ch1 [ch2]
+	const bool csv = !c[2].empty();
+	const std::vector<float> &ch1 = csv ? c[1] : c[0];
+	const std::vector<float> &ch2 = csv ? c[2] : c[1];
+	const bool hasCh2 = ch2.size() == ch1.size();
+	for(size_t i = 0; i < ch1.size(); i++) {
+		samples.push_back({ch1[i],hasCh2 ? ch2[i] : 0});
+	}
+	return !samples.empty();
+}
+
+AttysReplay::Stats AttysReplay::run() {
+	Stats stats;
+	JNIEnv env;
+	processed = 0;
+	registerAttysDataCallback([](float){ processed++; });
+	const unsigned long overruns0 = getAttysQueueOverruns();
+	Java_tech_glasgowneuro_attyshrv_ANativeActivity_initJava2CPP(&env,nullptr,fs);
+
+	std::vector<AttysBufferSample> buffer(batchSize);
+	_jobject directBuffer = {buffer.data(),(jlong)(buffer.size() * sizeof(AttysBufferSample))};
+	const auto t0 = std::chrono::steady_clock::now();
+	for(size_t i = 0; i < samples.size(); i += batchSize) {
+		const size_t n = (i + batchSize) < samples.size() ? batchSize : samples.size() - i;
+		if (speed > 0) {
+			const auto due = t0 + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+				std::chrono::duration<double>((double)i / fs / speed));
+			std::this_thread::sleep_until(due);
+			const double lag = std::chrono::duration<double>(std::chrono::steady_clock::now() - due).count();
+			if (lag > stats.maxLag) stats.maxLag = lag;
+		} else {
+			while ((i - processed) > maxQueued) {
+				std::this_thread::yield();
+			}
+		}
+		for(size_t j = 0; j < n; j++) {
+			buffer[j] = {(int64_t)(i + j),samples[i + j].ch1,samples[i + j].ch2};
+		}
+		Java_tech_glasgowneuro_attyshrv_ANativeActivity_dataUpdateBatch(&env,nullptr,0,&directBuffer,(jint)n);
+	}
+	// the DSP thread has taken all samples which have not been dropped
+	while ((processed + (getAttysQueueOverruns() - overruns0)) < samples.size()) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+	stats.samples = processed;
+	stats.overruns = getAttysQueueOverruns() - overruns0;
+	unregisterAllAttysCallbacks();
+	return stats;
+}
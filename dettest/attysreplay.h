@@ -0,0 +1,76 @@
+#ifndef ATTYSREPLAY_H
+#define ATTYSREPLAY_H
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+// Replays a recording through the JNI entry points of the app as the
+// Java code does on the device: initJava2CPP() with the sampling rate and
+// then the samples in batches via dataUpdateBatch(). The batches are sent
+// in real time, N times faster or as fast as the DSP thread takes them.
+class AttysReplay {
+
+public:
+	struct Sample {
+		float ch1;
+		float ch2;
+	};
+
+	struct Stats {
+		size_t samples = 0;
+		// wall clock time of the replay in secs
+		double seconds = 0;
+		// largest delay of a batch behind its schedule in secs
+		double maxLag = 0;
+		// samples dropped by the queue to the DSP thread
+		unsigned long overruns = 0;
+	};
+
+	// loads a recording and returns false on error. Formats:
+	// - recording of the app (ChunkRecorder): the sampling rate is taken from it
+	// - CSV as written by the app: ms since the epoch, ch1, ch2
+	// - text with one or two columns: ch1 [ch2]
+	// Text is read with ECGReader.
+	bool load(const std::string &filename);
+
+	const std::vector<Sample> &getSamples() const {
+		return samples;
+	}
+
+	float getSamplingRate() const {
+		return fs;
+	}
+
+	void setSamplingRate(float samplingRate) {
+		fs = samplingRate;
+	}
+
+	// 1 = real time, N = N times faster, 0 = as fast as possible
+	void setSpeed(double s) {
+		speed = s;
+	}
+
+	// samples per call of dataUpdateBatch(): the Java code sends 10
+	void setBatchSize(size_t n) {
+		batchSize = n > 0 ? n : 1;
+	}
+
+	// calls initJava2CPP(), replays the samples and waits until the DSP
+	// thread has processed all of them. The callbacks of the app need to be
+	// registered before. A data callback of the app is registered to follow
+	// the DSP thread.
+	Stats run();
+
+private:
+	bool loadChunks(const std::string &filename);
+
+	bool loadText(const std::string &filename);
+
+	std::vector<Sample> samples;
+	float fs = 250;
+	double speed = 0;
+	size_t batchSize = 10;
+};
+
+#endif
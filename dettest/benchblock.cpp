@@ -0,0 +1,103 @@
+// Compares the sample by sample detector with the block detector:
+// checks that both find the same beats and reports ns/sample.
+
+#include "../app/src/main/cpp/ecg_rr_det.h"
+#include "ecgreader.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <vector>
+#include "Iir.h"
+
+struct Beat {
+	long samplenumber;
+	float bpm;
+	double amplitude;
+	double confidence;
+};
+
+struct BeatRecorder : ECG_rr_det::RRlistener {
+	std::vector<Beat> beats;
+	virtual void hasRpeak(long samplenumber,
+			      float bpm,
+			      double amplitude,
+			      double confidence) {
+		beats.push_back({samplenumber, bpm, amplitude, confidence});
+	}
+};
+
+// minimal number of samples to run through the detectors
+const size_t minSamples = 10000000;
+
+int main (int argn,char** argv)
+{
+	if (argn < 2) {
+		fprintf(stderr,"Usage: %s ecgfile [ecgfile ...]\n",argv[0]);
+		exit(1);
+	}
+	const float fs = 250;
+	const float mains = 50;
+
+	std::vector<float> ecg;
+	for(int i = 1; i < argn; i++) {
+		if (!loadECG(argv[i],ecg)) {
+			fprintf(stderr,"Could not open %s\n",argv[i]);
+			exit(1);
+		}
+	}
+	if (ecg.empty()) {
+		fprintf(stderr,"No samples.\n");
+		exit(1);
+	}
+
+	// removing mains once so that only the detector is timed
+	Iir::Butterworth::BandStop<2> iirnotch;
+	iirnotch.setup(fs,mains,2);
+	std::vector<float> samples;
+	while (samples.size() < minSamples) {
+		for(auto &a : ecg) {
+			samples.push_back(iirnotch.filter(a));
+		}
+	}
+	const size_t n = samples.size();
+
+	BeatRecorder scalarBeats;
+	ECG_rr_det scalarDet(&scalarBeats);
+	scalarDet.init(fs);
+	auto t0 = std::chrono::steady_clock::now();
+	for(size_t i = 0; i < n; i++) {
+		scalarDet.detect(samples[i]);
+	}
+	auto t1 = std::chrono::steady_clock::now();
+	const double nsScalar = std::chrono::duration<double,std::nano>(t1 - t0).count() / (double)n;
+
+	BeatRecorder blockBeats;
+	ECG_rr_det blockDet(&blockBeats);
+	blockDet.init(fs);
+	t0 = std::chrono::steady_clock::now();
+	blockDet.detect(samples.data(),n);
+	t1 = std::chrono::steady_clock::now();
+	const double nsBlock = std::chrono::duration<double,std::nano>(t1 - t0).count() / (double)n;
+
+	bool identical = scalarBeats.beats.size() == blockBeats.beats.size();
+	for(size_t i = 0; identical && (i < scalarBeats.beats.size()); i++) {
+		const Beat &a = scalarBeats.beats[i];
+		const Beat &b = blockBeats.beats[i];
+		identical = (a.samplenumber == b.samplenumber) &&
+			(a.bpm == b.bpm) &&
+			(a.amplitude == b.amplitude) &&
+			(a.confidence == b.confidence);
+	}
+
+	printf("samples = %zu, beats = %zu\n",n,scalarBeats.beats.size());
+	printf("scalar: %f ns/sample\n",nsScalar);
+	printf("block:  %f ns/sample\n",nsBlock);
+	printf("speedup: %f\n",nsScalar / nsBlock);
+	if (!identical) {
+		fprintf(stderr,"Block detector gives different beats!\n");
+		return 1;
+	}
+	printf("Beats are identical.\n");
+	return 0;
+}
@@ -0,0 +1,349 @@
+// Records a day of ECG with the ChunkRecorder as the DSP thread of the app
+// does: both channels, the beats of the detector and the events. Compares the
+// size and the time to write it with the CSV and TSV files of previous
+// versions, opens it with and without the index in the footer, looks up
+// random time ranges with the index and checks that all samples and beats
+// are read back, that an index which does not match the chunks is rebuilt
+// from the chunk headers and that samples lost right at the end of a chunk are
+// recorded as dropped. A start while recording at another sampling rate
+// begins a new session with that rate in the same file.
+
+#include "../app/src/main/cpp/chunk_recorder.h"
+#include "../app/src/main/cpp/chunk_reader.h"
+#include "../app/src/main/cpp/ecg_rr_det.h"
+#include "ecgreader.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+const float fs = 250;
+
+// a day at 250Hz
+const double defaultHours = 24;
+
+// 1.1.2023 in ms since the epoch
+const int64_t t0 = 1672531200000;
+
+struct Beat {
+	long sampleNumber;
+	float bpm;
+	double amplitude;
+	double confidence;
+};
+
+struct BeatCollector : ECG_rr_det::RRlistener {
+	std::vector<Beat> beats;
+	virtual void hasRpeak(long samplenumber,
+			      float bpm,
+			      double amplitude,
+			      double confidence) {
+		beats.push_back({samplenumber,bpm,amplitude,confidence});
+	}
+};
+
+static double since(std::chrono::steady_clock::time_point t) {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - t).count();
+}
+
+static long fileSize(const std::string &filename) {
+	struct stat st = {};
+	if (stat(filename.c_str(),&st) != 0) return -1;
+	return (long)st.st_size;
+}
+
+static int64_t timeOfSample(size_t i) {
+	return t0 + (int64_t)((double)i * 1000.0 / fs);
+}
+
+int main (int argn,char** argv)
+{
+	std::string dir = "/tmp";
+	double hours = defaultHours;
+	std::vector<float> recording;
+	for(int i = 1; i < argn; i++) {
+		if ((strcmp(argv[i],"-d") == 0) && ((i + 1) < argn)) {
+			dir = argv[++i];
+			continue;
+		}
+		if ((strcmp(argv[i],"-h") == 0) && ((i + 1) < argn)) {
+			hours = atof(argv[++i]);
+			continue;
+		}
+		if (!loadECG(argv[i],recording)) {
+			fprintf(stderr,"Could not open %s\n",argv[i]);
+			exit(1);
+		}
+	}
+	if (recording.empty()) {
+		fprintf(stderr,"Usage: %s [-h hours] [-d directory] ecgfile [ecgfile ...]\n",argv[0]);
+		exit(1);
+	}
+	const size_t n = (size_t)(hours * 3600 * fs);
+	std::vector<float> ecg(n);
+	for(size_t i = 0; i < n; i++) {
+		ecg[i] = recording[i % recording.size()];
+	}
+	BeatCollector collector;
+	ECG_rr_det det(&collector);
+	det.init(fs);
+	det.detect(ecg.data(),n);
+	const std::vector<Beat> &beats = collector.beats;
+	printf("%.1f hours: %zu samples, %zu beats\n",hours,n,beats.size());
+
+	const std::string chunkFile = dir + "/benchchunks.dat";
+	const std::string csvFile = dir + "/benchchunks.csv";
+	const std::string tsvFile = dir + "/benchchunks.tsv";
+	remove(chunkFile.c_str());
+
+	// the DSP thread: a sample, the second channel and the beats
+	ChunkRecorder recorder;
+	const auto t0wall = std::chrono::steady_clock::now();
+	if (!recorder.start(chunkFile,fs)) {
+		fprintf(stderr,"Could not open %s\n",chunkFile.c_str());
+		exit(1);
+	}
+	// the recording runs much faster than real time: the writer catches up
+	// after every sync interval which is not counted as time of the DSP thread
+	const size_t samplesPerSync = (size_t)(fs * 10);
+	auto t = std::chrono::steady_clock::now();
+	double addTime = 0;
+	size_t b = 0;
+	for(size_t i = 0; i < n; i++) {
+		if ((i % samplesPerSync) == 0) {
+			addTime += since(t);
+			recorder.waitForWriter();
+			t = std::chrono::steady_clock::now();
+		}
+		recorder.add((int64_t)i,timeOfSample(i),ecg[i],-ecg[i]);
+		while ((b < beats.size()) && ((size_t)beats[b].sampleNumber <= i)) {
+			recorder.addBeat(beats[b].sampleNumber,beats[b].bpm,(float)beats[b].amplitude,(float)beats[b].confidence);
+			b++;
+		}
+		if ((i % (size_t)(3600 * fs)) == 0) {
+			recorder.addEvent(ChunkFile::Marker,(int32_t)(i / (size_t)(3600 * fs)));
+		}
+	}
+	addTime += since(t);
+	recorder.stop();
+	const double totalTime = since(t0wall);
+	printf("Chunked: %8.1f ns/sample on the DSP thread, %6.2f s in total, %ld bytes, %lu chunks, %lu dropped\n",
+	       addTime * 1E9 / (double)n,totalTime,fileSize(chunkFile),recorder.getChunksWritten(),recorder.getDroppedChunks());
+	printf("Samples compressed from %llu to %llu bytes: %.2f bits/sample/channel\n",
+	       (unsigned long long)recorder.getSampleBytes(),(unsigned long long)recorder.getCompressedSampleBytes(),
+	       (double)recorder.getCompressedSampleBytes() * 8.0 / (double)n / 2.0);
+
+	t = std::chrono::steady_clock::now();
+	FILE* csv = fopen(csvFile.c_str(),"wt");
+	FILE* tsv = fopen(tsvFile.c_str(),"wt");
+	if ((!csv) || (!tsv)) {
+		fprintf(stderr,"Could not open the CSV or TSV file\n");
+		exit(1);
+	}
+	b = 0;
+	for(size_t i = 0; i < n; i++) {
+		fprintf(csv,"%ld,%f,%f\n",(long)timeOfSample(i),ecg[i],-ecg[i]);
+		while ((b < beats.size()) && ((size_t)beats[b].sampleNumber <= i)) {
+			fprintf(tsv,"%ld\t%.1f\n",(long)timeOfSample((size_t)beats[b].sampleNumber),beats[b].bpm);
+			b++;
+		}
+	}
+	fclose(csv);
+	fclose(tsv);
+	printf("CSV/TSV: %8.1f ns/sample, %6.2f s in total, %ld bytes\n",
+	       since(t) * 1E9 / (double)n,since(t),fileSize(csvFile) + fileSize(tsvFile));
+	remove(csvFile.c_str());
+	remove(tsvFile.c_str());
+
+	ChunkReader reader;
+	t = std::chrono::steady_clock::now();
+	if (!reader.open(chunkFile)) {
+		fprintf(stderr,"Could not read %s\n",chunkFile.c_str());
+		exit(1);
+	}
+	printf("Open with the index:       %8.3f ms, %zu chunks, footer = %d\n",since(t) * 1E3,reader.getIndex().size(),reader.hasFooter());
+
+	// samples and beats read back
+	bool ok = true;
+	size_t k = 0;
+	std::vector<ChunkFile::SampleRecord> r;
+	for(auto &e : reader.getChunks(ChunkFile::Samples)) {
+		r.resize(e.count);
+		ok = ok && reader.readSamples(e,r.data());
+		for(size_t i = 0; i < e.count; i++) {
+			ok = ok && (r[i].ch1 == ecg[k]) && (r[i].ch2 == -ecg[k]) && ((e.firstSampleNumber + (int64_t)i) == (int64_t)k);
+			k++;
+		}
+	}
+	ok = ok && (k == n);
+	k = 0;
+	for(auto &e : reader.getChunks(ChunkFile::Beats)) {
+		const ChunkFile::BeatRecord* r = reader.getRecords<ChunkFile::BeatRecord>(e);
+		for(size_t i = 0; i < e.count; i++) {
+			ok = ok && (k < beats.size()) && (r[i].sampleNumber == beats[k].sampleNumber) &&
+				(r[i].timestampMs == timeOfSample((size_t)beats[k].sampleNumber));
+			k++;
+		}
+	}
+	ok = ok && (k == beats.size());
+	printf("All samples and beats read back: %s\n",ok ? "yes" : "NO");
+
+	// random 10 sec windows: binary search against a linear search of the index
+	std::mt19937 gen(1);
+	std::uniform_int_distribution<int64_t> start(t0,timeOfSample(n - 1));
+	const int nLookups = 100000;
+	std::vector<int64_t> from(nLookups);
+	for(auto &f : from) f = start(gen);
+	size_t found = 0;
+	t = std::chrono::steady_clock::now();
+	for(int i = 0; i < nLookups; i++) {
+		const auto r = reader.findChunks(ChunkFile::Samples,from[(size_t)i],from[(size_t)i] + 10000);
+		found += r.second - r.first;
+	}
+	const double binaryTime = since(t);
+	size_t foundLinear = 0;
+	const auto &chunks = reader.getChunks(ChunkFile::Samples);
+	t = std::chrono::steady_clock::now();
+	for(int i = 0; i < nLookups; i++) {
+		for(auto &e : chunks) {
+			if ((e.endMs >= from[(size_t)i]) && (e.startMs <= (from[(size_t)i] + 10000))) foundLinear++;
+		}
+	}
+	const double linearTime = since(t);
+	printf("Lookup of 10 s:  %8.1f ns with the index, %8.1f ns linear, %s\n",
+	       binaryTime * 1E9 / nLookups,linearTime * 1E9 / nLookups,
+	       found == foundLinear ? "same chunks" : "DIFFERENT chunks");
+	ok = ok && (found == foundLinear);
+	const size_t nEntries = reader.getIndex().size();
+	reader.close();
+
+	// an index entry with a wrong count is not trusted
+	const long size = fileSize(chunkFile);
+	ChunkFile::Footer footer;
+	FILE* f = fopen(chunkFile.c_str(),"r+b");
+	ChunkFile::IndexEntry entry;
+	bool rebuilt = false;
+	if (f && (fseek(f,size - (long)sizeof(footer),SEEK_SET) == 0) && (fread(&footer,sizeof(footer),1,f) == 1) &&
+	    (fseek(f,(long)footer.indexOffset,SEEK_SET) == 0) && (fread(&entry,sizeof(entry),1,f) == 1)) {
+		entry.count++;
+		fseek(f,(long)footer.indexOffset,SEEK_SET);
+		fwrite(&entry,sizeof(entry),1,f);
+		fflush(f);
+		reader.open(chunkFile);
+		rebuilt = (!reader.hasFooter()) && (reader.getIndex().size() == nEntries) &&
+			(reader.getIndex()[0].count == entry.count - 1);
+		reader.close();
+		entry.count--;
+		fseek(f,(long)footer.indexOffset,SEEK_SET);
+		fwrite(&entry,sizeof(entry),1,f);
+	}
+	printf("Index with a wrong count rebuilt from the chunks: %s\n",rebuilt ? "yes" : "NO");
+	ok = ok && rebuilt;
+
+	// a number of entries whose index size wraps around to the file size
+	rebuilt = false;
+	if (f && (fseek(f,size - (long)sizeof(footer),SEEK_SET) == 0)) {
+		ChunkFile::Footer wrapped = footer;
+		wrapped.nEntries += (uint64_t)1 << 60;
+		fwrite(&wrapped,sizeof(wrapped),1,f);
+		fflush(f);
+		reader.open(chunkFile);
+		rebuilt = (!reader.hasFooter()) && (reader.getIndex().size() == nEntries);
+		reader.close();
+		fseek(f,size - (long)sizeof(footer),SEEK_SET);
+		fwrite(&footer,sizeof(footer),1,f);
+	}
+	if (f) fclose(f);
+	printf("Footer with a wrapping number of entries rebuilt from the chunks: %s\n",rebuilt ? "yes" : "NO");
+	ok = ok && rebuilt;
+
+	// the app has been killed: no index
+	if (truncate(chunkFile.c_str(),size - (long)sizeof(footer)) != 0) {
+		fprintf(stderr,"Could not truncate %s\n",chunkFile.c_str());
+		exit(1);
+	}
+	t = std::chrono::steady_clock::now();
+	reader.open(chunkFile);
+	const size_t nChunks = reader.getIndex().size();
+	printf("Open without the index:    %8.3f ms, %zu chunks, footer = %d\n",since(t) * 1E3,nChunks,reader.hasFooter());
+	reader.close();
+
+	// the next session continues after the last chunk
+	recorder.start(chunkFile,fs);
+	for(size_t i = 0; i < 1000; i++) {
+		recorder.add((int64_t)(n + i),timeOfSample(n + i),0,0);
+	}
+	recorder.stop();
+	reader.open(chunkFile);
+	const bool appended = reader.hasFooter() && (reader.getIndex().size() > nChunks) &&
+		(reader.getChunks(ChunkFile::Samples).back().lastSampleNumber == (int64_t)(n + 999));
+	printf("Session appended after the recovery: %s\n",appended ? "yes" : "NO");
+	reader.close();
+	remove(chunkFile.c_str());
+
+	// 10 samples lost just after a chunk has been filled
+	const size_t spc = recorder.getSamplesPerChunk();
+	const int64_t lost = 10;
+	// no sync which would end the chunk earlier
+	recorder.setSyncInterval(0);
+	recorder.start(chunkFile,fs);
+	for(size_t i = 0; i < 2 * spc; i++) {
+		const int64_t sn = (int64_t)i + (i < spc ? 0 : lost);
+		recorder.add(sn,t0 + sn * 4,0,0);
+	}
+	recorder.stop();
+	reader.open(chunkFile);
+	// one event for the lost samples and the samples continue in a new chunk
+	size_t nDropped = 0;
+	for(auto &e : reader.getChunks(ChunkFile::Events)) {
+		const ChunkFile::EventRecord* ev = reader.getRecords<ChunkFile::EventRecord>(e);
+		for(size_t i = 0; i < e.count; i++) {
+			if (ev[i].code != ChunkFile::DroppedSamples) continue;
+			nDropped++;
+			if ((ev[i].value != lost) || (ev[i].sampleNumber != (int64_t)spc + lost)) nDropped++;
+		}
+	}
+	bool continued = false;
+	for(auto &e : reader.getChunks(ChunkFile::Samples)) {
+		if (e.firstSampleNumber == (int64_t)spc + lost) continued = true;
+	}
+	const bool dropped = (1 == nDropped) && continued;
+	printf("Samples dropped at the end of a chunk recorded: %s\n",dropped ? "yes" : "NO");
+	reader.close();
+	remove(chunkFile.c_str());
+
+	// a reconnect at 500Hz while recording
+	recorder.start(chunkFile,fs);
+	for(size_t i = 0; i < 1000; i++) {
+		recorder.add((int64_t)i,timeOfSample(i),0,0);
+	}
+	recorder.start(chunkFile,2 * fs);
+	for(size_t i = 0; i < 1000; i++) {
+		recorder.add((int64_t)i,timeOfSample(1000) + (int64_t)i * 2,0,0);
+	}
+	recorder.stop();
+	reader.open(chunkFile);
+	std::vector<float> sessions;
+	for(auto &e : reader.getChunks(ChunkFile::Events)) {
+		const ChunkFile::EventRecord* ev = reader.getRecords<ChunkFile::EventRecord>(e);
+		for(size_t i = 0; i < e.count; i++) {
+			if (ev[i].code == ChunkFile::SessionStart) sessions.push_back((float)ev[i].value);
+		}
+	}
+	std::vector<float> rates;
+	for(auto &e : reader.getChunks(ChunkFile::Samples)) {
+		rates.push_back(reader.getHeader(e)->fs);
+	}
+	const bool reconnected = (sessions == std::vector<float>{fs,2 * fs}) &&
+		(rates == std::vector<float>{fs,2 * fs});
+	printf("Reconnect at another sampling rate starts a new session: %s\n",reconnected ? "yes" : "NO");
+	reader.close();
+	remove(chunkFile.c_str());
+	return (ok && appended && dropped && reconnected) ? 0 : 1;
+}
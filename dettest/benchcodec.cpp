@@ -0,0 +1,125 @@
+// Compresses ECG recordings with the lossless ECGCodec in blocks as the
+// recorder does and checks that every sample is decoded bit by bit.
+// Reports the compression ratio against float32 and the CSV of the app,
+// the encoding and decoding speed in MB/s of float32 samples and the
+// CPU load of the encoder for two channels at 250Hz.
+// Recordings: the sample files and a synthetic ECG quantised by the
+// 24 bit ADC of the Attys, also with a NaN and an infinity.
+
+#include "../app/src/main/cpp/ecg_codec.h"
+#include "ecgreader.h"
+#include "ecgsyn.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+const float fs = 250;
+
+// samples per block: samples per chunk of the recorder
+const size_t blockSize = 4096;
+
+// step of the ADC of the Attys: +/-2.42V/gain 6 with 24 bits
+const double attysStep = 2.42 / 6 / 8388608.0;
+
+// bytes of a sample of one channel in the CSV of the app: "%f,"
+const double csvBytesPerSample = 10;
+
+static double since(std::chrono::steady_clock::time_point t) {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - t).count();
+}
+
+static bool run(const std::string &name, const std::vector<float> &v, int repeats) {
+	const size_t n = v.size();
+	const size_t nBlocks = (n + blockSize - 1) / blockSize;
+	std::vector<uint8_t> encoded(nBlocks * ECGCodec::maxEncodedSize(blockSize));
+	std::vector<size_t> offsets(nBlocks + 1);
+	ECGCodec codec(blockSize);
+	size_t modes[3] = {};
+	double encodeTime = 1E10;
+	for(int r = 0; r < repeats; r++) {
+		const auto t = std::chrono::steady_clock::now();
+		size_t pos = 0;
+		for(size_t b = 0; b < nBlocks; b++) {
+			const size_t m = (b + 1) * blockSize <= n ? blockSize : n - b * blockSize;
+			offsets[b] = pos;
+			pos += codec.encode(v.data() + b * blockSize,m,1,encoded.data() + pos);
+			if (0 == r) modes[codec.getLastMode()]++;
+		}
+		offsets[nBlocks] = pos;
+		const double secs = since(t);
+		if (secs < encodeTime) encodeTime = secs;
+	}
+	std::vector<float> decoded(n);
+	double decodeTime = 1E10;
+	bool ok = true;
+	for(int r = 0; r < repeats; r++) {
+		const auto t = std::chrono::steady_clock::now();
+		for(size_t b = 0; b < nBlocks; b++) {
+			const size_t m = (b + 1) * blockSize <= n ? blockSize : n - b * blockSize;
+			const size_t size = offsets[b + 1] - offsets[b];
+			ok = ok && (ECGCodec::decode(encoded.data() + offsets[b],size,decoded.data() + b * blockSize,m,1) == size);
+		}
+		const double secs = since(t);
+		if (secs < decodeTime) decodeTime = secs;
+	}
+	ok = ok && (memcmp(decoded.data(),v.data(),n * sizeof(float)) == 0);
+	const double bytes = (double)(n * sizeof(float));
+	const double compressed = (double)offsets[nBlocks];
+	// seconds of encoding per second of two channels at fs
+	const double load = encodeTime / (double)n * 2 * fs;
+	printf("%-16s %9zu %9.2f %9.2f %8.2f %10.1f %10.1f %9.5f%% %4zu/%zu/%zu %s\n",
+	       name.c_str(),n,compressed * 8 / (double)n,bytes / compressed,csvBytesPerSample * (double)n / compressed,
+	       bytes / encodeTime / 1E6,bytes / decodeTime / 1E6,load * 100,
+	       modes[ECGCodec::Predicted],modes[ECGCodec::Constant],modes[ECGCodec::Verbatim],
+	       ok ? "lossless" : "DIFFERENT");
+	fflush(stdout);
+	return ok;
+}
+
+int main (int argn,char** argv)
+{
+	if (argn < 2) {
+		fprintf(stderr,"Usage: %s ecgfile [ecgfile ...]\n",argv[0]);
+		exit(1);
+	}
+	const int repeats = 5;
+	printf("%-16s %9s %9s %9s %8s %10s %10s %10s %s\n","recording","samples","bits/smp","float32:1","CSV:1",
+	       "enc MB/s","dec MB/s","CPU load","blocks predicted/constant/verbatim");
+	bool ok = true;
+	std::vector<float> all;
+	for(int i = 1; i < argn; i++) {
+		std::vector<float> v;
+		if (!loadECG(argv[i],v)) {
+			fprintf(stderr,"Could not open %s\n",argv[i]);
+			exit(1);
+		}
+		ok = run(argv[i],v,repeats) && ok;
+	}
+
+	// an hour of the Attys
+	ECGSyn::Params p;
+	p.fs = fs;
+	ECGSyn ecgsyn(p);
+	std::vector<float> attys((size_t)(3600 * fs));
+	ecgsyn.generate(attys.data(),attys.size());
+	for(auto &v : attys) {
+		v = (float)((double)lrint(v / attysStep) * attysStep);
+	}
+	ok = run("synthetic Attys",attys,repeats) && ok;
+
+	// non-finite samples are kept verbatim
+	std::vector<float> nonFinite(attys);
+	nonFinite[1000] = NAN;
+	nonFinite[blockSize + 1000] = INFINITY;
+	ok = run("NaN and infinity",nonFinite,repeats) && ok;
+
+	// the second channel when it is not connected
+	std::vector<float> zeros(attys.size(),0);
+	ok = run("unconnected",zeros,repeats) && ok;
+	return ok ? 0 : 1;
+}
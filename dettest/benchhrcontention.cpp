@@ -0,0 +1,212 @@
+// Contention between the DSP thread which adds the heartrates and the render
+// thread which shows their history. The old OvrHRPlot took a mutex in
+// addHR() to erase the oldest beat from the vectors and to build a new
+// spline, and render() held it while it evaluated the 2000 points. Now the
+// DSP thread queues the beat for HRCurveBuilder, which builds the curve on
+// its worker and publishes it through a triple buffer, and render() picks
+// it up for HRSampler. Both threads run flat out with the beats much faster
+// than a heart so that they meet as often as possible. Reports the
+// percentiles of the time of every add() on the DSP thread and of every
+// frame on the render thread, the curves built and the beats dropped. The
+// wall clock time includes waiting for the mutex and, with fewer cores than
+// threads, being preempted by the other threads. The CPU time of the thread
+// is the work done by the call itself.
+//
+// Usage: benchhrcontention [secs] [us between beats]
+
+#include "../app/src/main/cpp/hr_curve_builder.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "cxx-spline.h"
+
+const double maxtime = 30;
+const int shiftbuffersize = 2000;
+const double spline_pred_sec = 1.5;
+const size_t maxBeats = 60;
+
+typedef std::chrono::steady_clock Clock;
+
+static double since(Clock::time_point t) {
+	return std::chrono::duration<double>(Clock::now() - t).count();
+}
+
+static double threadCpu() {
+	struct timespec ts;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID,&ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec * 1E-9;
+}
+
+// wall clock and CPU time of the calls
+struct Times {
+	std::vector<double> wall;
+	std::vector<double> cpu;
+	void reserve(size_t n) {
+		wall.reserve(n);
+		cpu.reserve(n);
+	}
+	void clear() {
+		wall.clear();
+		cpu.clear();
+	}
+	template<typename F>
+	void measure(F f) {
+		const double c0 = threadCpu();
+		const auto t0 = Clock::now();
+		f();
+		wall.push_back(since(t0));
+		cpu.push_back(threadCpu() - c0);
+	}
+};
+
+static void report(const char* name, const char* clock, std::vector<double> &times) {
+	if (times.empty()) {
+		printf("%-16s %-5s no calls\n",name,clock);
+		return;
+	}
+	std::sort(times.begin(),times.end());
+	const auto pct = [&](double p) {
+		return times[std::min(times.size() - 1,(size_t)(p * (double)times.size()))] * 1E6;
+	};
+	printf("%-16s %-5s %9zu %9.2f %9.2f %9.2f %9.2f\n",name,clock,times.size(),pct(0.5),pct(0.99),
+	       pct(0.999),times.back() * 1E6);
+}
+
+static void report(const char* name, Times &times) {
+	report(name,"wall",times.wall);
+	report(name,"cpu",times.cpu);
+}
+
+// the heartrate of the n-th beat and the time it is reached
+static double beatHR(size_t n) {
+	return 70 + 8 * sin((double)n / 4.0) + 2 * ((double)(n * 7919 % 101) / 100.0 - 0.5);
+}
+
+// the mutex, the vectors and the spline of OvrHRPlot before the worker
+struct Locked {
+	std::mutex mtx;
+	std::vector<double> hrBuffer;
+	std::vector<double> hrTs;
+	cubic_spline hrSpline;
+
+	void addHR(double t, double hr) {
+		std::lock_guard<std::mutex> lock(mtx);
+		hrTs.push_back(t);
+		hrBuffer.push_back(hr);
+		if (hrBuffer.size() > maxBeats) {
+			hrBuffer.erase(hrBuffer.begin());
+			hrTs.erase(hrTs.begin());
+		}
+		if (hrTs.size() > 1) {
+			hrSpline = cubic_spline(hrTs,hrBuffer);
+		}
+	}
+
+	double render(double t) {
+		double hrShiftBuffer[shiftbuffersize];
+		std::lock_guard<std::mutex> lock(mtx);
+		if (!hrSpline.hasSpline()) return 0;
+		for (int i = 0; i < shiftbuffersize; i++) {
+			const double dt = t - (double)i / (double)shiftbuffersize * maxtime;
+			double v;
+			if (dt < (hrSpline.lower_bound() - spline_pred_sec)) {
+				v = hrSpline(hrSpline.lower_bound() - spline_pred_sec);
+			} else if (dt > (hrSpline.upper_bound() + spline_pred_sec)) {
+				v = hrSpline(hrSpline.upper_bound() + spline_pred_sec);
+			} else {
+				v = hrSpline(dt);
+			}
+			hrShiftBuffer[i] = v;
+		}
+		return hrShiftBuffer[shiftbuffersize / 2];
+	}
+};
+
+struct Lockfree {
+	HRCurveBuilder builder{spline_pred_sec};
+	HRSampler sampler{maxtime / shiftbuffersize,shiftbuffersize};
+	double rangeMin = 0;
+	double rangeMax = 0;
+
+	void addHR(double t, double hr) {
+		builder.add(t,hr);
+	}
+
+	double render(double t) {
+		if (builder.update()) {
+			sampler.setCurve(builder.getCurve());
+		}
+		if (sampler.update(t) > 0) {
+			sampler.getRange(30,180,rangeMin,rangeMax);
+		}
+		return sampler.hasCurve() ? sampler[shiftbuffersize / 2] : 0;
+	}
+};
+
+// the DSP thread adds a beat every beatInterval secs for secs
+// the render thread renders frames until the DSP thread has finished
+template<typename P>
+static void run(P &plot, double secs, double beatInterval, Times &adds, Times &frames) {
+	std::atomic<bool> done(false);
+	// time of the latest beat for the render thread
+	std::atomic<double> beatTime(0);
+	adds.reserve((size_t)(secs / beatInterval) + 1);
+	frames.reserve(1000000);
+	std::thread dsp([&]() {
+		const auto start = Clock::now();
+		double t = 0;
+		size_t n = 0;
+		while (since(start) < secs) {
+			const double hr = beatHR(n++);
+			t += 60 / hr;
+			adds.measure([&]() { plot.addHR(t,hr); });
+			beatTime.store(t,std::memory_order_relaxed);
+			const auto next = start + std::chrono::duration<double>((double)n * beatInterval);
+			std::this_thread::sleep_until(next);
+		}
+		done = true;
+	});
+	volatile double sink = 0;
+	while (!done) {
+		frames.measure([&]() { sink = plot.render(beatTime.load(std::memory_order_relaxed)); });
+	}
+	(void)sink;
+	dsp.join();
+}
+
+int main(int argc, char* argv[]) {
+	const double secs = argc > 1 ? atof(argv[1]) : 5;
+	const double beatInterval = (argc > 2 ? atof(argv[2]) : 1000) * 1E-6;
+	printf("%.1f secs, a beat every %.0f us, %u hardware threads\n",secs,beatInterval * 1E6,
+	       std::thread::hardware_concurrency());
+	printf("%-16s %-5s %9s %9s %9s %9s %9s\n","us","","calls","p50","p99","p99.9","max");
+
+	Times adds;
+	Times frames;
+	{
+		Locked locked;
+		run(locked,secs,beatInterval,adds,frames);
+		report("mutex: addHR",adds);
+		report("mutex: render",frames);
+	}
+	adds.clear();
+	frames.clear();
+	Lockfree lockfree;
+	lockfree.builder.start();
+	run(lockfree,secs,beatInterval,adds,frames);
+	const size_t nAdds = adds.wall.size();
+	lockfree.builder.stop();
+	report("builder: addHR",adds);
+	report("builder: render",frames);
+	printf("curves built: %lu for %zu beats, beats dropped: %lu\n",lockfree.builder.getBuilds(),nAdds,
+	       lockfree.builder.getDroppedBeats());
+	return 0;
+}
@@ -0,0 +1,187 @@
+// The heartrate history of OvrHRPlot::render() on the CPU: evaluating the
+// spline of the last 60 beats at 2000 points of the last 30 secs every frame
+// as the app did before, against HRSampler which keeps the points on a
+// fixed time grid and only evaluates the ones which have become due since
+// the last frame, in one pass with forward differences. A new beat costs
+// the fit of the explicit cubics on the DSP thread and one pass over all
+// points at the next frame. Checks the points against the spline at the
+// same times and reports the difference to the spline at the frame times
+// which comes from the grid. Reports the CPU time per frame and per beat
+// at 90 frames/sec with a heartrate which varies with the breathing.
+//
+// Usage: benchhrhistory [hours]
+
+#include "../app/src/main/cpp/hr_history.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+#include "cxx-spline.h"
+
+const double fps = 90;
+const double maxtime = 30;
+const int shiftbuffersize = 2000;
+const double spline_pred_sec = 1.5;
+const size_t maxBeats = 60;
+
+static double since(std::chrono::steady_clock::time_point t) {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - t).count();
+}
+
+// beat times and heartrates: sinus arrhythmia, a slow drift and noise
+static void beats(double secs, std::vector<double> &ts, std::vector<double> &hrs) {
+	srand(42);
+	double t = 1;
+	while (t < secs) {
+		const double hr = 70 + 8 * sin(2 * M_PI * t / 4.5) + 10 * sin(2 * M_PI * t / 600) +
+			2 * ((double)rand() / RAND_MAX - 0.5);
+		ts.push_back(t);
+		hrs.push_back(hr);
+		t += 60 / hr;
+	}
+}
+
+// the loop of OvrHRPlot::render() before the sampler
+static double legacyValue(const cubic_spline &hrSpline, double dt) {
+	if (dt < (hrSpline.lower_bound() - spline_pred_sec)) {
+		return hrSpline(hrSpline.lower_bound() - spline_pred_sec);
+	} else if (dt > (hrSpline.upper_bound() + spline_pred_sec)) {
+		return hrSpline(hrSpline.upper_bound() + spline_pred_sec);
+	}
+	return hrSpline(dt);
+}
+
+struct Result {
+	double frameSecs = 0;
+	double beatSecs = 0;
+	double checksum = 0;
+};
+
+// the spline of the last 60 beats at every beat as OvrHRPlot::addHR()
+struct Beats {
+	std::vector<double> hrTs;
+	std::vector<double> hrBuffer;
+	bool add(double t, double hr) {
+		hrTs.push_back(t);
+		hrBuffer.push_back(hr);
+		if (hrBuffer.size() > maxBeats) {
+			hrBuffer.erase(hrBuffer.begin());
+			hrTs.erase(hrTs.begin());
+		}
+		return hrTs.size() > 1;
+	}
+};
+
+static Result legacy(const std::vector<double> &ts, const std::vector<double> &hrs, size_t nFrames) {
+	Result r;
+	Beats b;
+	cubic_spline hrSpline;
+	double hrShiftBuffer[shiftbuffersize];
+	double minHR = 1000;
+	double maxHR = 0;
+	size_t beat = 0;
+	for(size_t f = 1; f <= nFrames; f++) {
+		const double t = (double)f / fps;
+		for(; (beat < ts.size()) && (ts[beat] <= t); beat++) {
+			if (b.add(ts[beat],hrs[beat])) hrSpline = cubic_spline(b.hrTs,b.hrBuffer);
+		}
+		if (!hrSpline.hasSpline()) continue;
+		auto t0 = std::chrono::steady_clock::now();
+		for (int i = 0; i < shiftbuffersize; i++) {
+			const double v = legacyValue(hrSpline,t - (double)i / (double)shiftbuffersize * maxtime);
+			if ((v < minHR) && (v > 30)) minHR = v;
+			if ((v > maxHR) && (v < 180)) maxHR = v;
+			hrShiftBuffer[i] = v;
+		}
+		r.frameSecs += since(t0);
+		r.checksum += hrShiftBuffer[f % shiftbuffersize] + minHR + maxHR;
+	}
+	return r;
+}
+
+// checks every frame: the points against the spline at the same times
+// and against the spline at the frame times
+static Result sampler(const std::vector<double> &ts, const std::vector<double> &hrs, size_t nFrames,
+		      size_t checkEvery, double &maxDiff, double &maxGridDiff) {
+	Result r;
+	Beats b;
+	cubic_spline hrSpline;
+	HRCurve curve;
+	bool newCurve = false;
+	HRSampler s(maxtime / shiftbuffersize,shiftbuffersize);
+	double rangeMin = 0;
+	double rangeMax = 0;
+	double minHR = 1000;
+	double maxHR = 0;
+	size_t beat = 0;
+	maxDiff = 0;
+	maxGridDiff = 0;
+	const double step = maxtime / shiftbuffersize;
+	for(size_t f = 1; f <= nFrames; f++) {
+		const double t = (double)f / fps;
+		for(; (beat < ts.size()) && (ts[beat] <= t); beat++) {
+			if (b.add(ts[beat],hrs[beat])) {
+				hrSpline = cubic_spline(b.hrTs,b.hrBuffer);
+				auto t0 = std::chrono::steady_clock::now();
+				curve.fit(hrSpline,b.hrTs.data(),b.hrTs.size(),spline_pred_sec);
+				r.beatSecs += since(t0);
+				newCurve = true;
+			}
+		}
+		auto t0 = std::chrono::steady_clock::now();
+		if (newCurve) {
+			s.setCurve(curve);
+			newCurve = false;
+		}
+		if (s.update(t) > 0) {
+			s.getRange(30,180,rangeMin,rangeMax);
+		}
+		if (s.hasCurve()) {
+			if (rangeMin < minHR) minHR = rangeMin;
+			if (rangeMax > maxHR) maxHR = rangeMax;
+		}
+		r.frameSecs += since(t0);
+		if (!s.hasCurve()) continue;
+		r.checksum += s[f % shiftbuffersize] + minHR + maxHR;
+		if ((checkEvery > 0) && ((f % checkEvery) == 0)) {
+			const double newest = floor(t / step);
+			for (int i = 0; i < shiftbuffersize; i++) {
+				const double v = s[(size_t)i];
+				maxDiff = std::max(maxDiff,fabs(v - legacyValue(hrSpline,(newest - i) * step)));
+				maxGridDiff = std::max(maxGridDiff,fabs(v - legacyValue(hrSpline,t - i * step)));
+			}
+		}
+	}
+	return r;
+}
+
+int main(int argc, char* argv[]) {
+	const double hours = argc > 1 ? atof(argv[1]) : 1;
+	const double secs = hours * 3600;
+	const size_t nFrames = (size_t)(secs * fps);
+	std::vector<double> ts;
+	std::vector<double> hrs;
+	beats(secs,ts,hrs);
+
+	printf("%.1f hours, %zu beats, %.0f frames/sec, %d points of the last %.0f secs\n",
+	       hours,ts.size(),fps,shiftbuffersize,maxtime);
+	const Result l = legacy(ts,hrs,nFrames);
+	double maxDiff;
+	double maxGridDiff;
+	const Result s = sampler(ts,hrs,nFrames,0,maxDiff,maxGridDiff);
+	sampler(ts,hrs,nFrames / 10,97,maxDiff,maxGridDiff);
+	printf("%10s %12s %12s\n","","us/frame","us/beat");
+	printf("%10s %12.2f %12s\n","legacy",l.frameSecs * 1E6 / (double)nFrames,"-");
+	printf("%10s %12.2f %12.2f\n","sampler",s.frameSecs * 1E6 / (double)nFrames,
+	       s.beatSecs * 1E6 / (double)ts.size());
+	printf("speedup per frame: %.1f\n",l.frameSecs / s.frameSecs);
+	printf("max difference to the spline at the grid: %g bpm\n",maxDiff);
+	printf("max difference to the spline at the frame times: %g bpm\n",maxGridDiff);
+	printf("checksums: %f %f\n",l.checksum,s.checksum);
+	const bool ok = maxDiff < 1E-6;
+	printf("%s\n",ok ? "identical within 1E-6 bpm" : "DIFFERENT");
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,154 @@
+// Detects the R peaks in the ECG files and feeds the RR intervals to
+// HRVMetrics for different window lengths. Compares the running sums with
+// calculating the statistics of every window from scratch: reports ns/beat
+// and the largest difference between the two. Checks that intervals which
+// do not follow each other directly have no successive difference.
+
+#include "../app/src/main/cpp/ecg_rr_det.h"
+#include "../app/src/main/cpp/hrv_metrics.h"
+#include "ecgreader.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <chrono>
+#include <vector>
+#include "Iir.h"
+
+struct RRRecorder : ECG_rr_det::RRlistener {
+	HRVMetrics hrv;
+	ECG_rr_det* det = nullptr;
+	std::vector<double> rr;
+	size_t notSuccessive = 0;
+	virtual void hasRpeak(long,
+			      float bpm,
+			      double,
+			      double) {
+		const bool successive = det->isPreviousPeakReported();
+		if (hrv.addRpeak(bpm,successive)) {
+			rr.push_back(hrv.getLastRR());
+			if (!successive) notSuccessive++;
+		}
+	}
+};
+
+// number of beats the windows run over
+const size_t minBeats = 2000000;
+
+static double maxDiff(const HRVMetrics::Result &a, const HRVMetrics::Result &b) {
+	double d = fabs(a.meanHR - b.meanHR);
+	d = fmax(d,fabs(a.sdnn - b.sdnn));
+	d = fmax(d,fabs(a.rmssd - b.rmssd));
+	d = fmax(d,fabs(a.pnn50 - b.pnn50));
+	return d;
+}
+
+// every 7th interval does not follow the one before: RMSSD and pNN50 only
+// from the differences within the runs of successive intervals
+static bool gapCheck(const std::vector<double> &rr, size_t window) {
+	HRVMetrics hrv(window);
+	double d = 0;
+	for(size_t i = 0; i < rr.size(); i++) {
+		hrv.addRR(rr[i],(i % 7) != 0);
+		const size_t n = (i + 1) < window ? (i + 1) : window;
+		double ssd = 0;
+		size_t nn50 = 0;
+		size_t nd = 0;
+		for(size_t j = i + 2 - n; j <= i; j++) {
+			if ((j % 7) == 0) continue;
+			const double dd = rr[j] - rr[j - 1];
+			ssd += dd * dd;
+			if (fabs(dd) > HRVMetrics::nn50threshold) nn50++;
+			nd++;
+		}
+		const HRVMetrics::Result r = hrv.getResult();
+		if (r.nDifferences != nd) return false;
+		if (nd > 0) {
+			d = fmax(d,fabs(r.rmssd - sqrt(ssd / (double)nd)));
+			d = fmax(d,fabs(r.pnn50 - (double)nn50 * 100.0 / (double)nd));
+		}
+	}
+	printf("window %zu with gaps: max diff %g\n",window,d);
+	return d < 1E-6;
+}
+
+static void bench(const std::vector<double> &rr, size_t window, unsigned recalcInterval) {
+	HRVMetrics hrv(window,recalcInterval);
+	std::vector<HRVMetrics::Result> running(rr.size());
+	auto t0 = std::chrono::steady_clock::now();
+	for(size_t i = 0; i < rr.size(); i++) {
+		hrv.addRR(rr[i]);
+		running[i] = hrv.getResult();
+	}
+	auto t1 = std::chrono::steady_clock::now();
+	const double nsRunning = std::chrono::duration<double,std::nano>(t1 - t0).count() / (double)rr.size();
+
+	std::vector<HRVMetrics::Result> naive(rr.size());
+	t0 = std::chrono::steady_clock::now();
+	for(size_t i = 0; i < rr.size(); i++) {
+		const size_t n = (i + 1) < window ? (i + 1) : window;
+		naive[i] = HRVMetrics::calc(rr.data() + i + 1 - n,n);
+	}
+	t1 = std::chrono::steady_clock::now();
+	const double nsNaive = std::chrono::duration<double,std::nano>(t1 - t0).count() / (double)rr.size();
+
+	double d = 0;
+	for(size_t i = 0; i < rr.size(); i++) {
+		d = fmax(d,maxDiff(running[i],naive[i]));
+	}
+	printf("%8zu %10u %12f %12f %10f %12g\n",window,recalcInterval,nsRunning,nsNaive,nsNaive / nsRunning,d);
+}
+
+int main (int argn,char** argv)
+{
+	if (argn < 2) {
+		fprintf(stderr,"Usage: %s ecgfile [ecgfile ...]\n",argv[0]);
+		exit(1);
+	}
+	const float fs = 250;
+	const float mains = 50;
+
+	RRRecorder recorder;
+	ECG_rr_det rrDet(&recorder);
+	recorder.det = &rrDet;
+	rrDet.init(fs);
+	Iir::Butterworth::BandStop<2> iirnotch;
+	iirnotch.setup(fs,mains,2);
+	for(int i = 1; i < argn; i++) {
+		std::vector<float> ecg;
+		if (!loadECG(argv[i],ecg)) {
+			fprintf(stderr,"Could not open %s\n",argv[i]);
+			exit(1);
+		}
+		for(auto &a : ecg) {
+			rrDet.detect(iirnotch.filter(a));
+		}
+	}
+	if (recorder.rr.empty()) {
+		fprintf(stderr,"No RR intervals.\n");
+		exit(1);
+	}
+	const HRVMetrics::Result r = HRVMetrics::calc(recorder.rr.data(),recorder.rr.size());
+	printf("%zu RR intervals: HR = %f bpm, SDNN = %f ms, RMSSD = %f ms, pNN50 = %f %%\n",
+	       r.nIntervals,r.meanHR,r.sdnn,r.rmssd,r.pnn50);
+	printf("%zu intervals after a beat which has not been reported\n",recorder.notSuccessive);
+
+	std::vector<double> rr;
+	while (rr.size() < minBeats) {
+		rr.insert(rr.end(),recorder.rr.begin(),recorder.rr.end());
+	}
+	printf("%zu beats\n",rr.size());
+	printf("%8s %10s %12s %12s %10s %12s\n","window","recalc","ns/beat","naive","speedup","max diff");
+	const size_t windows[] = {10, 60, 300, HRVMetrics::capacity};
+	for(auto &w : windows) {
+		bench(rr,w,1000);
+	}
+	// without recalculation the rounding errors of the running sums add up
+	bench(rr,60,0xffffffff);
+	std::vector<double> first(rr.begin(),rr.begin() + (rr.size() < 20000 ? rr.size() : 20000));
+	if (!(gapCheck(first,10) && gapCheck(first,60))) {
+		printf("Successive differences across gaps: FAILED\n");
+		return 1;
+	}
+	return 0;
+}
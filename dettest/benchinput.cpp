@@ -0,0 +1,214 @@
+// Reads a large ECG recording as text with fscanf() as test.cpp did, with
+// the memory mapped text parser of ECGReader and in the binary float32 and
+// int24 formats. Generates the files from the sample recordings, checks
+// that all paths deliver the same samples and reports MB/s and samples/s.
+
+#include "ecgreader.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+const float fs = 250;
+
+// samples per read
+const size_t blockSize = 4096;
+
+// V per LSB of the int24 file: +/-8V at 1uV
+const float int24Scale = 1E-6f;
+
+struct Checksum {
+	size_t n = 0;
+	double sum = 0;
+	void add(const float* v, size_t k) {
+		for(size_t i = 0; i < k; i++) sum += v[i];
+		n += k;
+	}
+};
+
+static void report(const char* name, size_t bytes, const Checksum &c, double secs) {
+	printf("%-20s %12zu %12.1f %14.1f %20.9g\n",name,c.n,(double)bytes / secs / 1E6,(double)c.n / secs / 1E6,c.sum);
+	fflush(stdout);
+}
+
+static double since(std::chrono::steady_clock::time_point t0) {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+// compares the parser with strtof() for numbers printed in different ways
+static size_t checkParser(const std::vector<float> &recording) {
+	std::mt19937 gen(42);
+	std::uniform_real_distribution<double> mantissa(-10,10);
+	std::uniform_int_distribution<int> exponent(-12,6);
+	const char* formats[] = {"%.18e", "%.9g", "%g", "%f", "%.3e", "%.12f"};
+	size_t mismatches = 0;
+	size_t tested = 0;
+	char s[64];
+	for(size_t i = 0; i < 1000000; i++) {
+		const double x = i < recording.size() ? recording[i] : mantissa(gen) * pow(10,exponent(gen));
+		for(auto &fmt : formats) {
+			snprintf(s,sizeof(s),fmt,x);
+			float a = 0;
+			const char* end = ECGReader::parseFloat(s,s + strlen(s),a);
+			const float b = strtof(s,nullptr);
+			tested++;
+			if ((*end != 0) || (a != b)) {
+				if (mismatches < 10) {
+					fprintf(stderr,"%s: %.9g instead of %.9g\n",s,(double)a,(double)b);
+				}
+				mismatches++;
+			}
+		}
+	}
+	printf("Parser: %zu numbers, %zu different from strtof()\n",tested,mismatches);
+	return mismatches;
+}
+
+int main (int argn,char** argv)
+{
+	std::string dir = "/tmp";
+	size_t megabytes = 2048;
+	bool keep = false;
+	std::vector<float> recording;
+	std::vector<float> block(blockSize);
+	for(int i = 1; i < argn; i++) {
+		if ((strcmp(argv[i],"-d") == 0) && ((i + 1) < argn)) {
+			dir = argv[++i];
+			continue;
+		}
+		if ((strcmp(argv[i],"-m") == 0) && ((i + 1) < argn)) {
+			megabytes = (size_t)atol(argv[++i]);
+			continue;
+		}
+		if (strcmp(argv[i],"-k") == 0) {
+			keep = true;
+			continue;
+		}
+		ECGReader reader;
+		if (!reader.open(argv[i])) {
+			fprintf(stderr,"Could not open %s\n",argv[i]);
+			exit(1);
+		}
+		size_t n;
+		while ((n = reader.read(block.data(),blockSize)) > 0) {
+			recording.insert(recording.end(),block.begin(),block.begin() + (long)n);
+		}
+	}
+	if (recording.empty()) {
+		fprintf(stderr,"Usage: %s [-m megabytes] [-d directory] [-k] ecgfile [ecgfile ...]\n",argv[0]);
+		fprintf(stderr,"   -m: size of the text file, default 2048MB\n");
+		fprintf(stderr,"   -d: directory of the files, default /tmp\n");
+		fprintf(stderr,"   -k: keeps the files\n");
+		exit(1);
+	}
+
+	if (checkParser(recording) > 0) {
+		exit(1);
+	}
+
+	const std::string textFile = dir + "/benchinput.txt";
+	const std::string float32File = dir + "/benchinput.f32";
+	const std::string int24File = dir + "/benchinput.i24";
+
+	printf("Writing %zuMB of text\n",megabytes);
+	FILE* f = fopen(textFile.c_str(),"wb");
+	if (!f) {
+		fprintf(stderr,"Could not open %s\n",textFile.c_str());
+		exit(1);
+	}
+	ECGWriter float32Writer;
+	ECGWriter int24Writer;
+	if ((!float32Writer.open(float32File,ECGReader::Float32,1,fs)) ||
+	    (!int24Writer.open(int24File,ECGReader::Int24,1,fs,int24Scale))) {
+		fprintf(stderr,"Could not open the binary files in %s\n",dir.c_str());
+		exit(1);
+	}
+	size_t textBytes = 0;
+	std::vector<char> text(blockSize * 32);
+	for(size_t i = 0; textBytes < (megabytes << 20); i += blockSize) {
+		size_t m = 0;
+		for(size_t j = 0; j < blockSize; j++) {
+			// the format of the sample recordings
+			block[j] = recording[(i + j) % recording.size()];
+			m += (size_t)snprintf(text.data() + m,text.size() - m,"%.18e\n",(double)block[j]);
+		}
+		if (fwrite(text.data(),m,1,f) != 1) {
+			fprintf(stderr,"Could not write %s\n",textFile.c_str());
+			exit(1);
+		}
+		textBytes += m;
+		float32Writer.write(block.data(),blockSize);
+		int24Writer.write(block.data(),blockSize);
+	}
+	fclose(f);
+	if ((!float32Writer.close()) || (!int24Writer.close())) {
+		fprintf(stderr,"Could not write the binary files\n");
+		exit(1);
+	}
+
+	printf("%-20s %12s %12s %14s %20s\n","path","samples","MB/s","Msamples/s","sum");
+
+	Checksum scanned;
+	auto t0 = std::chrono::steady_clock::now();
+	FILE *finput = fopen(textFile.c_str(),"rt");
+	float a;
+	while (fscanf(finput,"%f\n",&a) == 1) {
+		scanned.add(&a,1);
+	}
+	fclose(finput);
+	report("fscanf",textBytes,scanned,since(t0));
+
+	ECGReader reader;
+	Checksum parsed;
+	t0 = std::chrono::steady_clock::now();
+	reader.open(textFile);
+	size_t n;
+	while ((n = reader.read(block.data(),blockSize)) > 0) {
+		parsed.add(block.data(),n);
+	}
+	report("mmap text",reader.getFileSize(),parsed,since(t0));
+
+	Checksum float32;
+	t0 = std::chrono::steady_clock::now();
+	reader.open(float32File);
+	while ((n = reader.read(block.data(),blockSize)) > 0) {
+		float32.add(block.data(),n);
+	}
+	report("float32",reader.getFileSize(),float32,since(t0));
+
+	Checksum zeroCopy;
+	t0 = std::chrono::steady_clock::now();
+	reader.open(float32File);
+	const float* samples = reader.getFloatSamples(n);
+	for(size_t i = 0; i < n; i += blockSize) {
+		zeroCopy.add(samples + i,(i + blockSize) < n ? blockSize : n - i);
+	}
+	report("float32 zero copy",reader.getFileSize(),zeroCopy,since(t0));
+
+	Checksum int24;
+	t0 = std::chrono::steady_clock::now();
+	reader.open(int24File);
+	while ((n = reader.read(block.data(),blockSize)) > 0) {
+		int24.add(block.data(),n);
+	}
+	report("int24",reader.getFileSize(),int24,since(t0));
+	reader.close();
+
+	const bool same = (parsed.n == scanned.n) && (parsed.sum == scanned.sum) &&
+		(float32.n == scanned.n) && (float32.sum == scanned.sum) &&
+		(zeroCopy.n == scanned.n) && (zeroCopy.sum == scanned.sum) &&
+		(int24.n == scanned.n) && (fabs(int24.sum - scanned.sum) < (double)int24.n * (double)int24Scale);
+	printf("%s\n",same ? "All paths deliver the same samples." : "The paths deliver different samples!");
+
+	if (!keep) {
+		remove(textFile.c_str());
+		remove(float32File.c_str());
+		remove(int24File.c_str());
+	}
+	return same ? 0 : 1;
+}
@@ -0,0 +1,103 @@
+// Drives the JNI entry points of attysjava2cpp.cpp on the host with the
+// stand-in headers in hoststubs: compares the delivery of the samples one
+// by one with batches through dataUpdateBatch().
+// Reports the time spent in the JNI calls (bluetooth thread) and checks
+// that the DSP thread hands every sample to the data callback.
+// The cost of the JNI transition itself is not part of the host stand-in.
+
+#include "attyshost.h"
+#include "../app/src/main/cpp/attysjava2cpp.h"
+#include "ecgreader.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+std::atomic<long> received(0);
+
+// samples delivered before waiting for the DSP thread: less than the ring
+const size_t blockSize = 500;
+
+// one sample per JNI call as a baseline for the batches
+static void dataUpdateOne(JNIEnv *env, int64_t sampleNumber, float v) {
+	AttysBufferSample sample = {sampleNumber, v, 0};
+	_jobject directBuffer = {&sample, (jlong)sizeof(sample)};
+	Java_tech_glasgowneuro_attyshrv_ANativeActivity_dataUpdateBatch(env,nullptr,0,&directBuffer,1);
+}
+
+// batchSize = 0 delivers the samples one by one via dataUpdateOne()
+static void bench(const std::vector<float> &ecg, size_t batchSize) {
+	JNIEnv env;
+	std::vector<AttysBufferSample> buffer(batchSize > 0 ? batchSize : 1);
+	_jobject directBuffer = {buffer.data(), (jlong)(buffer.size() * sizeof(AttysBufferSample))};
+	received = 0;
+	double nsInJNI = 0;
+	for(size_t b = 0; b < ecg.size(); b += blockSize) {
+		const size_t end = (b + blockSize) < ecg.size() ? b + blockSize : ecg.size();
+		const auto tj0 = std::chrono::steady_clock::now();
+		if (0 == batchSize) {
+			for(size_t i = b; i < end; i++) {
+				dataUpdateOne(&env,(int64_t)i,ecg[i]);
+			}
+		} else {
+			size_t n = 0;
+			for(size_t i = b; i < end; i++) {
+				buffer[n++] = {(int64_t)i, ecg[i], 0};
+				if ((n == batchSize) || ((i + 1) == end)) {
+					Java_tech_glasgowneuro_attyshrv_ANativeActivity_dataUpdateBatch(
+						&env,nullptr,0,&directBuffer,(jint)n);
+					n = 0;
+				}
+			}
+		}
+		const auto tj1 = std::chrono::steady_clock::now();
+		nsInJNI += std::chrono::duration<double,std::nano>(tj1 - tj0).count();
+		while (received < (long)end) {
+			std::this_thread::yield();
+		}
+	}
+	if (0 == batchSize) {
+		printf("%-16s",  "per sample");
+	} else {
+		printf("batch of %-7zu",batchSize);
+	}
+	const double ns = nsInJNI / (double)ecg.size();
+	printf(" %14f %14f\n",ns,1E3 / ns);
+}
+
+int main (int argn,char** argv)
+{
+	if (argn < 2) {
+		fprintf(stderr,"Usage: %s ecgfile [ecgfile ...]\n",argv[0]);
+		exit(1);
+	}
+	std::vector<float> recording;
+	for(int i = 1; i < argn; i++) {
+		if (!loadECG(argv[i],recording)) {
+			fprintf(stderr,"Could not open %s\n",argv[i]);
+			exit(1);
+		}
+	}
+	std::vector<float> ecg;
+	while (ecg.size() < 2000000) {
+		ecg.insert(ecg.end(),recording.begin(),recording.end());
+	}
+
+	registerAttysDataCallback([](float){ received++; });
+	JNIEnv env;
+	Java_tech_glasgowneuro_attyshrv_ANativeActivity_initJava2CPP(&env,nullptr,250);
+
+	printf("%zu samples\n",ecg.size());
+	printf("%-16s %14s %14s\n","delivery","JNI ns/sample","Msamples/s");
+	bench(ecg,0);
+	bench(ecg,10);
+	bench(ecg,100);
+
+	const unsigned long overruns = getAttysQueueOverruns();
+	printf("Queue: high water mark = %zu, overruns = %lu\n",getAttysQueueHighWaterMark(),overruns);
+	unregisterAllAttysCallbacks();
+	return overruns > 0 ? 1 : 0;
+}
@@ -0,0 +1,205 @@
+// Runs N ECG streams through the multi stream detector and through N
+// instances of ECG_rr_det. Checks that every stream gives the same
+// beats and reports the time per sample and stream for N = 1..1024.
+// Checks the same at 500Hz with the recordings interpolated.
+
+#include "../app/src/main/cpp/ecg_rr_det.h"
+#include "../app/src/main/cpp/ecg_rr_det_multi.h"
+#include "ecgreader.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <vector>
+#include "Iir.h"
+
+struct BeatRecorder : ECG_rr_det::RRlistener {
+	std::vector<ECG_rr_det_multi::Beat> beats;
+	virtual void hasRpeak(long samplenumber,
+			      float bpm,
+			      double amplitude,
+			      double confidence) {
+		beats.push_back({samplenumber, bpm, amplitude, confidence});
+	}
+};
+
+static bool sameBeats(const std::vector<ECG_rr_det_multi::Beat> &a,
+		      const std::vector<ECG_rr_det_multi::Beat> &b) {
+	if (a.size() != b.size()) return false;
+	for(size_t i = 0; i < a.size(); i++) {
+		if ((a[i].samplenumber != b[i].samplenumber) ||
+		    (a[i].bpm != b[i].bpm) ||
+		    (a[i].amplitude != b[i].amplitude) ||
+		    (a[i].confidence != b[i].confidence)) return false;
+	}
+	return true;
+}
+
+// every stream starts at a different position of the recordings
+static float streamSample(const std::vector<float> &ecg, int stream, size_t i) {
+	const size_t offset = ((size_t)stream * 997) % ecg.size();
+	return ecg[(offset + i) % ecg.size()];
+}
+
+// beats of nStreams streams of the multi stream detector against ECG_rr_det at fs
+static bool sameAtRate(const std::vector<float> &ecg, float fs, int nStreams, size_t nFrames, size_t &nBeats) {
+	ECG_rr_det_multi multi(nStreams);
+	multi.init(fs);
+	std::vector<float> frames(nFrames * (size_t)nStreams);
+	for(size_t i = 0; i < nFrames; i++) {
+		for(int s = 0; s < nStreams; s++) {
+			frames[i * (size_t)nStreams + (size_t)s] = streamSample(ecg,s,i);
+		}
+	}
+	multi.detect(frames.data(),nFrames);
+	bool same = true;
+	nBeats = 0;
+	for(int s = 0; s < nStreams; s++) {
+		BeatRecorder recorder;
+		ECG_rr_det det(&recorder);
+		det.init(fs);
+		for(size_t i = 0; i < nFrames; i++) {
+			det.detect(streamSample(ecg,s,i));
+		}
+		nBeats += recorder.beats.size();
+		same = same && sameBeats(recorder.beats,multi.getBeats(s));
+	}
+	return same;
+}
+
+// init of a detector which has run before: the filters start from zero
+// as in ECG_rr_det::init()
+static bool sameAfterInit(const std::vector<float> &ecg, float fs, int nStreams, size_t nFrames) {
+	std::vector<float> frames(nFrames * (size_t)nStreams);
+	for(size_t i = 0; i < nFrames; i++) {
+		for(int s = 0; s < nStreams; s++) {
+			frames[i * (size_t)nStreams + (size_t)s] = streamSample(ecg,s,i);
+		}
+	}
+	const size_t nBefore = nFrames / 2 + 1;
+	ECG_rr_det_multi multi(nStreams);
+	multi.init(fs);
+	multi.detect(frames.data(),nBefore);
+	multi.init(fs);
+	multi.clearBeats();
+	multi.detect(frames.data(),nFrames);
+	bool same = true;
+	for(int s = 0; s < nStreams; s++) {
+		BeatRecorder recorder;
+		ECG_rr_det det(&recorder);
+		det.init(fs);
+		for(size_t i = 0; i < nBefore; i++) {
+			det.detect(streamSample(ecg,s,i));
+		}
+		det.init(fs);
+		recorder.beats.clear();
+		for(size_t i = 0; i < nFrames; i++) {
+			det.detect(streamSample(ecg,s,i));
+		}
+		same = same && sameBeats(recorder.beats,multi.getBeats(s));
+	}
+	return same;
+}
+
+const int maxStreams = 1024;
+
+// samples per stream: 1 min
+const size_t nFrames = 15000;
+
+int main (int argn,char** argv)
+{
+	if (argn < 2) {
+		fprintf(stderr,"Usage: %s ecgfile [ecgfile ...]\n",argv[0]);
+		exit(1);
+	}
+	const float fs = 250;
+	const float mains = 50;
+
+	std::vector<float> ecg;
+	std::vector<float> raw;
+	Iir::Butterworth::BandStop<2> iirnotch;
+	iirnotch.setup(fs,mains,2);
+	for(int i = 1; i < argn; i++) {
+		if (!loadECG(argv[i],raw)) {
+			fprintf(stderr,"Could not open %s\n",argv[i]);
+			exit(1);
+		}
+	}
+	for(auto &a : raw) {
+		ecg.push_back(iirnotch.filter(a));
+	}
+	if (ecg.empty()) {
+		fprintf(stderr,"No samples.\n");
+		exit(1);
+	}
+
+	bool identical = true;
+	printf("streams\tscalar ns/sample\tmulti ns/sample\tspeedup\tbeats\n");
+	for(int nStreams = 1; nStreams <= maxStreams; nStreams *= 2) {
+		// every stream starts at a different position of the recordings
+		std::vector<float> frames(nFrames * (size_t)nStreams);
+		std::vector<std::vector<float>> streams(nStreams,std::vector<float>(nFrames));
+		for(int s = 0; s < nStreams; s++) {
+			const size_t offset = ((size_t)s * 997) % ecg.size();
+			for(size_t i = 0; i < nFrames; i++) {
+				const float a = ecg[(offset + i) % ecg.size()];
+				frames[i * (size_t)nStreams + (size_t)s] = a;
+				streams[s][i] = a;
+			}
+		}
+
+		std::vector<BeatRecorder> recorders(nStreams);
+		std::vector<ECG_rr_det> detectors;
+		detectors.reserve(nStreams);
+		for(int s = 0; s < nStreams; s++) {
+			detectors.emplace_back(&recorders[s]);
+			detectors[s].init(fs);
+		}
+		auto t0 = std::chrono::steady_clock::now();
+		for(int s = 0; s < nStreams; s++) {
+			for(size_t i = 0; i < nFrames; i++) {
+				detectors[s].detect(streams[s][i]);
+			}
+		}
+		auto t1 = std::chrono::steady_clock::now();
+		const double n = (double)nFrames * nStreams;
+		const double nsScalar = std::chrono::duration<double,std::nano>(t1 - t0).count() / n;
+
+		ECG_rr_det_multi multi(nStreams);
+		multi.init(fs);
+		t0 = std::chrono::steady_clock::now();
+		multi.detect(frames.data(),nFrames);
+		t1 = std::chrono::steady_clock::now();
+		const double nsMulti = std::chrono::duration<double,std::nano>(t1 - t0).count() / n;
+
+		size_t nBeats = 0;
+		for(int s = 0; s < nStreams; s++) {
+			nBeats += multi.getBeats(s).size();
+			if (!sameBeats(recorders[s].beats,multi.getBeats(s))) {
+				fprintf(stderr,"Stream %d: different beats!\n",s);
+				identical = false;
+			}
+		}
+		printf("%d\t%f\t%f\t%f\t%zu\n",nStreams,nsScalar,nsMulti,nsScalar / nsMulti,nBeats);
+	}
+
+	// the recordings at 500Hz
+	std::vector<float> ecg500(2 * raw.size());
+	Iir::Butterworth::BandStop<2> iirnotch500;
+	iirnotch500.setup(2 * fs,mains,2);
+	for(size_t i = 0; i < raw.size(); i++) {
+		const float next = (i + 1) < raw.size() ? raw[i + 1] : raw[i];
+		ecg500[2 * i] = iirnotch500.filter(raw[i]);
+		ecg500[2 * i + 1] = iirnotch500.filter((raw[i] + next) / 2);
+	}
+	size_t nBeats500 = 0;
+	const bool same500 = sameAtRate(ecg500,2 * fs,16,2 * nFrames,nBeats500);
+	printf("500Hz: 16 streams, %zu beats, %s\n",nBeats500,same500 ? "identical" : "DIFFERENT");
+	const bool sameInit = sameAfterInit(ecg500,2 * fs,16,2 * nFrames);
+	printf("init after detecting: %s\n",sameInit ? "identical" : "DIFFERENT");
+	if (!(identical && same500 && (nBeats500 > 0) && sameInit)) {
+		return 1;
+	}
+	printf("Beats of all streams are identical.\n");
+	return 0;
+}
@@ -0,0 +1,185 @@
+// Measures the time from the start of the ECG to the first heartbeat which
+// is reported by the detector. The ECG files are interrupted every 20 secs
+// by a gap of 5 secs as after a bluetooth reconnect and the detector starts
+// again after the gap:
+// - cold: a new detector and notch filter starting from zero
+// - steady state: the filters start in the steady state of the first sample
+// - snapshot: the detector is restored from the snapshot taken before the
+//   gap and the filters start in the steady state
+// Also checks that restoring a snapshot and the notch filter from their
+// serialised bytes without a gap gives the same beats as running the
+// detector without interruption and that a snapshot taken at another
+// sampling rate is rejected.
+
+#include "../app/src/main/cpp/ecg_rr_det.h"
+#include "../app/src/main/cpp/sos_cascade.h"
+#include "ecgreader.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "Iir.h"
+
+const float fs = 250;
+const float mains = 50;
+
+// distance of the restarts and the gap in samples
+const size_t restartInterval = (size_t)(20 * fs);
+const size_t gap = (size_t)(5 * fs);
+
+struct BeatRecorder : ECG_rr_det::RRlistener {
+	std::vector<long> beats;
+	virtual void hasRpeak(long samplenumber,
+			      float,
+			      double,
+			      double) {
+		beats.push_back(samplenumber);
+	}
+};
+
+// first beat within a number of samples: returned by the listener
+struct FirstBeat : ECG_rr_det::RRlistener {
+	size_t i = 0;
+	long first = -1;
+	virtual void hasRpeak(long,
+			      float,
+			      double,
+			      double) {
+		if (first < 0) first = (long)i;
+	}
+};
+
+enum Start { cold, steadyState, snapshot };
+
+// samples from start until the first beat or -1 if none within 30 secs
+static long firstBeat(const std::vector<float> &ecg, size_t start, Start how,
+		      const ECG_rr_det::Snapshot &snap) {
+	FirstBeat listener;
+	ECG_rr_det det(&listener);
+	det.init(fs);
+	Iir::Butterworth::BandStop<2> notchDesign;
+	notchDesign.setup(fs,mains,2);
+	SOSCascade<2> notch;
+	notch.append(notchDesign);
+	if (snapshot == how) {
+		det.restore(snap);
+	}
+	if (cold != how) {
+		notch.initSteadyState(ecg[start]);
+		det.initSteadyState(ecg[start]);
+	}
+	const size_t end = start + (size_t)(30 * fs) < ecg.size() ? start + (size_t)(30 * fs) : ecg.size();
+	for(size_t i = start; (i < end) && (listener.first < 0); i++) {
+		listener.i = i - start;
+		det.detect((float)notch.filter(ecg[i]));
+	}
+	return listener.first;
+}
+
+int main (int argn,char** argv)
+{
+	if (argn < 2) {
+		fprintf(stderr,"Usage: %s ecgfile [ecgfile ...]\n",argv[0]);
+		exit(1);
+	}
+	std::vector<float> ecg;
+	for(int i = 1; i < argn; i++) {
+		if (!loadECG(argv[i],ecg)) {
+			fprintf(stderr,"Could not open %s\n",argv[i]);
+			exit(1);
+		}
+	}
+
+	// uninterrupted run with snapshots at the restart points
+	BeatRecorder ref;
+	ECG_rr_det det(&ref);
+	det.init(fs);
+	Iir::Butterworth::BandStop<2> notchDesign;
+	notchDesign.setup(fs,mains,2);
+	SOSCascade<2> notch;
+	notch.append(notchDesign);
+	std::vector<ECG_rr_det::Snapshot> snapshots;
+	// the snapshot followed by the state of the notch filter as in a file
+	const size_t fileSize = ECG_rr_det::serializedSnapshotSize + SOSCascade<2>::serializedStateSize;
+	std::vector<std::vector<uint8_t> > files;
+	for(size_t i = 0; i < ecg.size(); i++) {
+		if ((i > 0) && ((i % restartInterval) == 0)) {
+			snapshots.push_back(det.getSnapshot());
+			std::vector<uint8_t> file(fileSize);
+			ECG_rr_det::serialize(snapshots.back(),file.data());
+			notch.serializeState(file.data() + ECG_rr_det::serializedSnapshotSize);
+			files.push_back(file);
+		}
+		det.detect((float)notch.filter(ecg[i]));
+	}
+
+	// continuing from every serialised snapshot without a gap gives the same beats
+	for(size_t s = 0; s < snapshots.size(); s++) {
+		const size_t start = (s + 1) * restartInterval;
+		BeatRecorder cont;
+		ECG_rr_det det2(&cont);
+		det2.init(fs);
+		ECG_rr_det::Snapshot restored;
+		SOSCascade<2> notch2;
+		notch2.append(notchDesign);
+		if (!(ECG_rr_det::deserialize(files[s].data(),files[s].size(),restored) &&
+		      det2.restore(restored) &&
+		      notch2.deserializeState(files[s].data() + ECG_rr_det::serializedSnapshotSize,
+					      files[s].size() - ECG_rr_det::serializedSnapshotSize))) {
+			fprintf(stderr,"Could not restore the snapshot!\n");
+			return 1;
+		}
+		for(size_t i = start; i < ecg.size(); i++) {
+			det2.detect((float)notch2.filter(ecg[i]));
+		}
+		std::vector<long> expected;
+		for(auto &b : ref.beats) {
+			if (b > snapshots[s].timestamp) expected.push_back(b);
+		}
+		if (expected != cont.beats) {
+			fprintf(stderr,"Restored detector differs from sample %zu!\n",start);
+			return 1;
+		}
+	}
+	printf("%zu snapshots restored from %zu bytes: beats identical to the uninterrupted detector\n",
+	       snapshots.size(),fileSize);
+
+	if (!snapshots.empty()) {
+		ECG_rr_det other(nullptr);
+		other.init(2 * fs);
+		if (other.restore(snapshots[0])) {
+			fprintf(stderr,"Snapshot restored at another sampling rate!\n");
+			return 1;
+		}
+		ECG_rr_det::Snapshot truncated;
+		if (ECG_rr_det::deserialize(files[0].data(),ECG_rr_det::serializedSnapshotSize - 1,truncated)) {
+			fprintf(stderr,"Truncated snapshot deserialised!\n");
+			return 1;
+		}
+	}
+
+	printf("%-16s %8s %12s %12s\n","start","restarts","mean [s]","max [s]");
+	const char* names[] = {"cold","steady state","snapshot"};
+	for(int how = cold; how <= snapshot; how++) {
+		double sum = 0;
+		long max = 0;
+		size_t n = 0;
+		size_t missing = 0;
+		for(size_t s = 0; s < snapshots.size(); s++) {
+			const size_t start = (s + 1) * restartInterval + gap;
+			if ((start + (size_t)(10 * fs)) > ecg.size()) break;
+			const long t = firstBeat(ecg,start,(Start)how,snapshots[s]);
+			if (t < 0) {
+				missing++;
+				continue;
+			}
+			sum += (double)t;
+			if (t > max) max = t;
+			n++;
+		}
+		printf("%-16s %8zu %12f %12f",names[how],n,sum / (double)n / fs,(double)max / fs);
+		if (missing > 0) printf(" (%zu without a beat)",missing);
+		printf("\n");
+	}
+	return 0;
+}
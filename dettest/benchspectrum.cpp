@@ -0,0 +1,132 @@
+// Feeds a synthetic RR series of several hours with a 0.1Hz (resonance
+// breathing) and a 0.25Hz component to HRVSpectrum. Reports the beats/s,
+// the worst time of a single beat and compares the sliding DFT with
+// calculating the spectrum of the window from scratch. Then runs an hour
+// of beats through HRVSpectrumWorker and checks its result.
+
+#include "../app/src/main/cpp/hrv_spectrum.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <vector>
+
+struct Beat {
+	double t;
+	double rr;
+};
+
+// amplitudes of the LF and HF components in ms
+const double lfAmplitude = 40;
+const double hfAmplitude = 15;
+
+static std::vector<Beat> rrSeries(double hours) {
+	std::mt19937 gen(42);
+	std::normal_distribution<double> noise(0,2);
+	std::vector<Beat> beats;
+	double t = 0;
+	while (t < (hours * 3600)) {
+		const double rr = 900 + lfAmplitude * sin(2 * M_PI * 0.1 * t) +
+			hfAmplitude * sin(2 * M_PI * 0.25 * t) + noise(gen);
+		t += rr / 1000;
+		beats.push_back({t,rr});
+	}
+	return beats;
+}
+
+static double relDiff(double a, double b) {
+	return fabs(a - b) / fmax(fabs(b),1E-9);
+}
+
+int main (int argn,char** argv)
+{
+	double hours = 8;
+	for(int i = 1; i < argn; i++) {
+		if ((strcmp(argv[i],"-h") == 0) && ((i + 1) < argn)) {
+			hours = atof(argv[++i]);
+		} else {
+			fprintf(stderr,"Usage: %s [-h hours]\n",argv[0]);
+			exit(1);
+		}
+	}
+	const std::vector<Beat> beats = rrSeries(hours);
+	printf("%zu beats = %.1f hours\n",beats.size(),hours);
+
+	HRVSpectrum spectrum;
+	double worst = 0;
+	const auto t0 = std::chrono::steady_clock::now();
+	for(auto &b : beats) {
+		const auto tb0 = std::chrono::steady_clock::now();
+		spectrum.addBeat(b.t,b.rr);
+		const HRVSpectrum::Result r = spectrum.getResult();
+		const auto tb1 = std::chrono::steady_clock::now();
+		worst = fmax(worst,std::chrono::duration<double,std::nano>(tb1 - tb0).count());
+		if (r.valid && (r.lf < 0)) exit(1);
+	}
+	const auto t1 = std::chrono::steady_clock::now();
+	const double ns = std::chrono::duration<double,std::nano>(t1 - t0).count() / (double)beats.size();
+	printf("sliding DFT: %f ns/beat, %.0f beats/s, worst beat %.0f ns\n",ns,1E9 / ns,worst);
+
+	// from scratch every beat: only for a part of the beats
+	HRVSpectrum exact;
+	const size_t nExact = beats.size() < 20000 ? beats.size() : 20000;
+	double maxDiff = 0;
+	const auto t2 = std::chrono::steady_clock::now();
+	HRVSpectrum::Result r;
+	for(size_t i = 0; i < nExact; i++) {
+		exact.addBeat(beats[i].t,beats[i].rr);
+		r = exact.calcExact();
+		if (r.valid) {
+			const HRVSpectrum::Result s = exact.getResult();
+			maxDiff = fmax(maxDiff,relDiff(s.lf,r.lf));
+			maxDiff = fmax(maxDiff,relDiff(s.hf,r.hf));
+		}
+	}
+	const auto t3 = std::chrono::steady_clock::now();
+	const double nsExact = std::chrono::duration<double,std::nano>(t3 - t2).count() / (double)nExact;
+	printf("DFT of the window: %f ns/beat, speedup of the sliding DFT = %f\n",nsExact,nsExact / ns);
+	printf("max relative difference of LF and HF = %g\n",maxDiff);
+
+	r = spectrum.getResult();
+	const HRVSpectrum::Result e = spectrum.calcExact();
+	printf("last window: LF = %f ms^2, HF = %f ms^2, LF/HF = %f, peak = %f Hz\n",
+	       r.lf,r.hf,r.lfhf,r.peakFrequency);
+	printf("from scratch: LF = %f ms^2, HF = %f ms^2, LF/HF = %f, peak = %f Hz\n",
+	       e.lf,e.hf,e.lfhf,e.peakFrequency);
+	printf("expected: LF = %f ms^2, HF = %f ms^2, peak = 0.1 Hz\n",
+	       lfAmplitude * lfAmplitude / 2,hfAmplitude * hfAmplitude / 2);
+	if ((fabs(r.peakFrequency - 0.1) > 0.01) || (maxDiff > 1E-6)) {
+		fprintf(stderr,"The spectrum is wrong!\n");
+		return 1;
+	}
+
+	// the worker thread gets the beats in bursts as from the detector
+	HRVSpectrumWorker worker;
+	HRVSpectrum reference;
+	std::atomic<long> callbacks(0);
+	worker.setCallback([&callbacks](const HRVSpectrum::Result &){ callbacks++; });
+	worker.start();
+	const size_t nWorker = beats.size() < 4000 ? beats.size() : 4000;
+	for(size_t i = 0; i < nWorker; i++) {
+		worker.addBeat(beats[i].t,beats[i].rr);
+		reference.addBeat(beats[i].t,beats[i].rr);
+		if ((i % 100) == 99) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(30));
+		}
+	}
+	std::this_thread::sleep_for(std::chrono::milliseconds(100));
+	worker.stop();
+	const HRVSpectrum::Result w = worker.getResult();
+	const HRVSpectrum::Result ref = reference.getResult();
+	printf("worker: %zu beats, %ld callbacks, %lu dropped, LF = %f ms^2, HF = %f ms^2\n",
+	       nWorker,callbacks.load(),worker.getDroppedBeats(),w.lf,w.hf);
+	if ((worker.getDroppedBeats() > 0) || (w.lf != ref.lf) || (w.hf != ref.hf)) {
+		fprintf(stderr,"The worker result differs!\n");
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,127 @@
+// Benchmarks the instantiations of the compile time detector
+// ECG_rr_det_static against ECG_rr_det and reports ns/sample and
+// how many of the beats of ECG_rr_det have been found.
+
+#include "../app/src/main/cpp/ecg_rr_det.h"
+#include "../app/src/main/cpp/ecg_rr_det_static.h"
+#include "ecgreader.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <chrono>
+#include <vector>
+#include "Iir.h"
+
+struct BeatRecorder : ECG_rr_det::RRlistener {
+	std::vector<long> beats;
+	virtual void hasRpeak(long samplenumber,
+			      float,
+			      double,
+			      double) {
+		beats.push_back(samplenumber);
+	}
+};
+
+// minimal number of samples to run through the detectors
+const size_t minSamples = 10000000;
+
+// number of beats of ref which are in beats within +/- tolerance samples
+static size_t matchingBeats(const std::vector<long> &ref, const std::vector<long> &beats, long tolerance) {
+	size_t n = 0;
+	size_t j = 0;
+	for(auto &r : ref) {
+		while ((j < beats.size()) && (beats[j] < (r - tolerance))) j++;
+		if ((j < beats.size()) && (labs(beats[j] - r) <= tolerance)) n++;
+	}
+	return n;
+}
+
+template<typename Det, typename Sample>
+static void bench(const char* name,
+		  const std::vector<Sample> &samples,
+		  const std::vector<long> &ref,
+		  long tolerance,
+		  double nsRef) {
+	BeatRecorder recorder;
+	Det det(&recorder);
+	const auto t0 = std::chrono::steady_clock::now();
+	det.detect(samples.data(),samples.size());
+	const auto t1 = std::chrono::steady_clock::now();
+	const double ns = std::chrono::duration<double,std::nano>(t1 - t0).count() / (double)samples.size();
+	std::vector<long> beats = recorder.beats;
+	// sample numbers at the reference rate
+	const long decimation = Det::getSamplingRate() / 250;
+	for(auto &b : beats) b /= decimation;
+	printf("%-28s %10f %10f %8zu %8zu\n",name,ns,nsRef / ns,beats.size(),
+	       matchingBeats(ref,beats,tolerance));
+}
+
+int main (int argn,char** argv)
+{
+	if (argn < 2) {
+		fprintf(stderr,"Usage: %s ecgfile [ecgfile ...]\n",argv[0]);
+		exit(1);
+	}
+	const float fs = 250;
+	const float mains = 50;
+
+	std::vector<float> ecg;
+	for(int i = 1; i < argn; i++) {
+		if (!loadECG(argv[i],ecg)) {
+			fprintf(stderr,"Could not open %s\n",argv[i]);
+			exit(1);
+		}
+	}
+	if (ecg.empty()) {
+		fprintf(stderr,"No samples.\n");
+		exit(1);
+	}
+
+	// removing mains once so that only the detector is timed
+	Iir::Butterworth::BandStop<2> iirnotch;
+	iirnotch.setup(fs,mains,2);
+	std::vector<float> samples;
+	while (samples.size() < minSamples) {
+		for(auto &a : ecg) {
+			samples.push_back(iirnotch.filter(a));
+		}
+	}
+	const size_t n = samples.size();
+	std::vector<double> samplesDouble(samples.begin(),samples.end());
+	std::vector<int32_t> samplesMicroVolt(n);
+	for(size_t i = 0; i < n; i++) {
+		samplesMicroVolt[i] = (int32_t)lround(samples[i] * 1E6);
+	}
+	// linear interpolation to 500Hz
+	std::vector<float> samples500(2 * n);
+	for(size_t i = 0; i < n; i++) {
+		samples500[2 * i] = samples[i];
+		samples500[2 * i + 1] = (i + 1) < n ? (samples[i] + samples[i + 1]) / 2 : samples[i];
+	}
+
+	BeatRecorder refBeats;
+	ECG_rr_det refDet(&refBeats);
+	refDet.init(fs);
+	const auto t0 = std::chrono::steady_clock::now();
+	for(size_t i = 0; i < n; i++) {
+		refDet.detect(samples[i]);
+	}
+	const auto t1 = std::chrono::steady_clock::now();
+	const double nsRef = std::chrono::duration<double,std::nano>(t1 - t0).count() / (double)n;
+	const std::vector<long> &ref = refBeats.beats;
+
+	printf("samples = %zu, beats of ECG_rr_det = %zu\n",n,ref.size());
+	printf("%-28s %10s %10s %8s %8s\n","detector","ns/sample","speedup","beats","matching");
+	printf("%-28s %10f %10f %8zu %8zu\n","ECG_rr_det",nsRef,1.0,ref.size(),ref.size());
+	bench<ECG_rr_det_static<250,float,2>>("<250,float,2>",samples,ref,0,nsRef);
+	bench<ECG_rr_det_static<250,double,2>>("<250,double,2>",samplesDouble,ref,0,nsRef);
+	bench<ECG_rr_det_static<250,int32_t,2>>("<250,int32_t,2>",samplesMicroVolt,ref,0,nsRef);
+	// the higher order filters have a longer delay: within 0.1 sec
+	bench<ECG_rr_det_static<250,float,4>>("<250,float,4>",samples,ref,25,nsRef);
+	bench<ECG_rr_det_static<250,double,4>>("<250,double,4>",samplesDouble,ref,25,nsRef);
+	bench<ECG_rr_det_static<250,int32_t,4>>("<250,int32_t,4>",samplesMicroVolt,ref,25,nsRef);
+	// twice the samples: the speedup is per sample
+	bench<ECG_rr_det_static<500,float,2>>("<500,float,2>",samples500,ref,1,nsRef);
+	return 0;
+}
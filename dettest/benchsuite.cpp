@@ -0,0 +1,400 @@
+// Benchmark suite of the DSP path of the app: notch, highpass and bandpass
+// of the Iir library, the fused filters, the detector, the callback fan-out,
+// the HRV and the spline of OvrHRPlot::addHR() and render(). Reports for
+// every benchmark ns per operation, operations/s, heap allocations per
+// operation and the cache misses per operation if the hardware counters
+// can be read. Writes JSON with -o so that releases can be compared. The
+// spline benchmarks need cxx-spline.h (HAVE_CXX_SPLINE).
+
+#include "../app/src/main/cpp/ecg_rr_det.h"
+#include "../app/src/main/cpp/sos_cascade.h"
+#include "../app/src/main/cpp/hrv_metrics.h"
+#include "../app/src/main/cpp/hrv_spectrum.h"
+#include "ecgreader.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <new>
+#include <string>
+#include <vector>
+#include "Iir.h"
+#ifdef HAVE_CXX_SPLINE
+#include "cxx-spline.h"
+#endif
+
+// counts every allocation of the process
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+static std::atomic<unsigned long> allocations(0);
+
+void* operator new(size_t size) {
+	allocations.fetch_add(1,std::memory_order_relaxed);
+	void* p = malloc(size > 0 ? size : 1);
+	if (!p) throw std::bad_alloc();
+	return p;
+}
+
+void operator delete(void* p) noexcept {
+	free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+	free(p);
+}
+
+// the cache miss counter of the CPU, not available in many VMs and containers
+class CacheMisses {
+public:
+	CacheMisses() {
+		struct perf_event_attr attr = {};
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.size = sizeof(attr);
+		attr.config = PERF_COUNT_HW_CACHE_MISSES;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		fd = (int)syscall(__NR_perf_event_open,&attr,0,-1,-1,0);
+	}
+
+	~CacheMisses() {
+		if (fd >= 0) close(fd);
+	}
+
+	bool isAvailable() const {
+		return fd >= 0;
+	}
+
+	long long read() const {
+		long long count = 0;
+		if ((fd < 0) || (::read(fd,&count,sizeof(count)) != sizeof(count))) return -1;
+		return count;
+	}
+
+private:
+	int fd = -1;
+};
+
+struct Result {
+	std::string name;
+	// what one operation is: sample, beat or evaluation
+	std::string unit;
+	double nsPerOp = 0;
+	double opsPerSec = 0;
+	double allocsPerOp = 0;
+	// negative if the counter is not available
+	double cacheMissesPerOp = -1;
+	// heartbeats per second of processing time, negative if no beats
+	double beatsPerSec = -1;
+};
+
+static std::vector<Result> results;
+static CacheMisses cacheMisses;
+static int repeats = 5;
+
+// runs body() which returns the number of operations and keeps the fastest run
+static void bench(const std::string &name, const std::string &unit,
+		  const std::function<size_t()> &body, size_t beats = 0) {
+	Result r;
+	r.name = name;
+	r.unit = unit;
+	double best = 0;
+	for(int i = 0; i < repeats; i++) {
+		const unsigned long a0 = allocations.load();
+		const long long m0 = cacheMisses.read();
+		const auto t0 = std::chrono::steady_clock::now();
+		const size_t ops = body();
+		const auto t1 = std::chrono::steady_clock::now();
+		const long long m1 = cacheMisses.read();
+		const unsigned long a1 = allocations.load();
+		const double secs = std::chrono::duration<double>(t1 - t0).count();
+		if ((0 == i) || (secs < best)) {
+			best = secs;
+			r.nsPerOp = secs * 1E9 / (double)ops;
+			r.opsPerSec = (double)ops / secs;
+			r.allocsPerOp = (double)(a1 - a0) / (double)ops;
+			r.cacheMissesPerOp = ((m0 >= 0) && (m1 >= 0)) ? (double)(m1 - m0) / (double)ops : -1;
+			r.beatsPerSec = beats > 0 ? (double)beats / secs : -1;
+		}
+	}
+	results.push_back(r);
+	printf("%-24s %-8s %12.2f %14.0f %10.4f",r.name.c_str(),r.unit.c_str(),r.nsPerOp,r.opsPerSec,r.allocsPerOp);
+	if (r.cacheMissesPerOp >= 0) {
+		printf(" %12.4f",r.cacheMissesPerOp);
+	} else {
+		printf(" %12s","n/a");
+	}
+	if (r.beatsPerSec > 0) {
+		printf(" %12.0f",r.beatsPerSec);
+	}
+	printf("\n");
+	fflush(stdout);
+}
+
+static void writeJSON(const char* filename, size_t nSamples) {
+	FILE* f = fopen(filename,"wt");
+	if (!f) {
+		fprintf(stderr,"Could not open %s\n",filename);
+		exit(1);
+	}
+	char date[64];
+	const time_t now = time(nullptr);
+	strftime(date,sizeof(date),"%Y-%m-%dT%H:%M:%SZ",gmtime(&now));
+	fprintf(f,"{\n");
+	fprintf(f,"  \"suite\": \"attyshrv-dsp\",\n");
+	fprintf(f,"  \"date\": \"%s\",\n",date);
+	fprintf(f,"  \"compiler\": \"%s\",\n",__VERSION__);
+	fprintf(f,"  \"samples\": %zu,\n",nSamples);
+	fprintf(f,"  \"repeats\": %d,\n",repeats);
+	fprintf(f,"  \"results\": [\n");
+	for(size_t i = 0; i < results.size(); i++) {
+		const Result &r = results[i];
+		fprintf(f,"    {\"name\": \"%s\", \"unit\": \"%s\", \"ns_per_op\": %.4f, \"ops_per_s\": %.1f, "
+			"\"allocs_per_op\": %.6f, ",
+			r.name.c_str(),r.unit.c_str(),r.nsPerOp,r.opsPerSec,r.allocsPerOp);
+		if (r.cacheMissesPerOp >= 0) {
+			fprintf(f,"\"cache_misses_per_op\": %.6f, ",r.cacheMissesPerOp);
+		} else {
+			fprintf(f,"\"cache_misses_per_op\": null, ");
+		}
+		if (r.beatsPerSec > 0) {
+			fprintf(f,"\"beats_per_s\": %.1f}",r.beatsPerSec);
+		} else {
+			fprintf(f,"\"beats_per_s\": null}");
+		}
+		fprintf(f,"%s\n",(i + 1) < results.size() ? "," : "");
+	}
+	fprintf(f,"  ]\n}\n");
+	fclose(f);
+}
+
+struct BeatCounter : ECG_rr_det::RRlistener {
+	size_t beats = 0;
+	std::vector<long> samplenumbers;
+	virtual void hasRpeak(long samplenumber,
+			      float,
+			      double,
+			      double) {
+		beats++;
+		if (samplenumbers.size() < samplenumbers.capacity()) {
+			samplenumbers.push_back(samplenumber);
+		}
+	}
+};
+
+// minimal number of samples the benchmarks run over
+const size_t minSamples = 1000000;
+
+// the spline of OvrHRPlot: 60 heartrates and 10 * QUAD_GRID_SIZE evaluations per frame
+const size_t splineBeats = 60;
+const size_t splineEvaluations = 2000;
+
+int main (int argn,char** argv)
+{
+	const char* jsonFile = nullptr;
+	std::vector<float> recording;
+	for(int i = 1; i < argn; i++) {
+		if ((strcmp(argv[i],"-o") == 0) && ((i + 1) < argn)) {
+			jsonFile = argv[++i];
+			continue;
+		}
+		if ((strcmp(argv[i],"-r") == 0) && ((i + 1) < argn)) {
+			repeats = atoi(argv[++i]);
+			continue;
+		}
+		if (!loadECG(argv[i],recording)) {
+			fprintf(stderr,"Could not open %s\n",argv[i]);
+			exit(1);
+		}
+	}
+	if (recording.empty()) {
+		fprintf(stderr,"Usage: %s [-o results.json] [-r repeats] ecgfile [ecgfile ...]\n",argv[0]);
+		exit(1);
+	}
+	const float fs = 250;
+	std::vector<float> ecg;
+	while (ecg.size() < minSamples) {
+		ecg.insert(ecg.end(),recording.begin(),recording.end());
+	}
+	const size_t n = ecg.size();
+	std::vector<float> out(n);
+
+	printf("%zu samples, best of %d runs, cache miss counter %s\n",n,repeats,
+	       cacheMisses.isAvailable() ? "available" : "not available");
+	printf("%-24s %-8s %12s %14s %10s %12s %12s\n","benchmark","op","ns/op","ops/s","allocs/op","misses/op","beats/s");
+
+	Iir::Butterworth::BandStop<2> notch;
+	notch.setup(fs,50,2.5);
+	bench("notch_iir","sample",[&]() {
+		for(size_t i = 0; i < n; i++) out[i] = notch.filter(ecg[i]);
+		return n;
+	});
+
+	SOSCascade<2> notchSOS;
+	notchSOS.append(notch);
+	bench("notch_sos","sample",[&]() {
+		for(size_t i = 0; i < n; i++) out[i] = (float)notchSOS.filter(ecg[i]);
+		return n;
+	});
+	// the input of the detector
+	const std::vector<float> notched = out;
+
+	Iir::Butterworth::HighPass<2> highPass;
+	highPass.setup(2,fs,5);
+	bench("highpass_iir","sample",[&]() {
+		for(size_t i = 0; i < n; i++) out[i] = highPass.filter(notched[i]);
+		return n;
+	});
+
+	Iir::Butterworth::BandPass<2> bandPass;
+	bandPass.setup(2,fs,20,15);
+	bench("bandpass_iir","sample",[&]() {
+		for(size_t i = 0; i < n; i++) out[i] = bandPass.filter(notched[i]);
+		return n;
+	});
+
+	BeatCounter beatCounter;
+	beatCounter.samplenumbers.reserve(n / 100);
+	{
+		ECG_rr_det det(&beatCounter);
+		det.init(fs);
+		for(size_t i = 0; i < n; i++) det.detect(notched[i]);
+	}
+	const size_t beats = beatCounter.beats;
+
+	bench("detect_sample","sample",[&]() {
+		BeatCounter counter;
+		ECG_rr_det det(&counter);
+		det.init(fs);
+		for(size_t i = 0; i < n; i++) det.detect(notched[i]);
+		return n;
+	},beats);
+
+	bench("detect_block","sample",[&]() {
+		BeatCounter counter;
+		ECG_rr_det det(&counter);
+		det.init(fs);
+		const size_t block = 64;
+		for(size_t i = 0; i < n; i += block) {
+			det.detect(notched.data() + i,(i + block) < n ? block : n - i);
+		}
+		return n;
+	},beats);
+
+	// the data callbacks of the app: ECG plot, audio and one more consumer
+	for(int nCallbacks : {1, 3}) {
+		std::vector<std::function<void(float)>> callbacks;
+		volatile float sink = 0;
+		for(int c = 0; c < nCallbacks; c++) {
+			callbacks.emplace_back([&sink](float v){ sink = v; });
+		}
+		bench("fanout_" + std::to_string(nCallbacks),"sample",[&]() {
+			for(size_t i = 0; i < n; i++) {
+				for(auto &cb : callbacks) cb(notched[i]);
+			}
+			return n;
+		});
+	}
+
+	// what the DSP thread does for every sample
+	bench("dsp_pipeline","sample",[&]() {
+		BeatCounter counter;
+		ECG_rr_det det(&counter);
+		det.init(fs);
+		SOSCascade<2> nf = notchSOS;
+		nf.reset();
+		volatile float sink = 0;
+		std::vector<std::function<void(float)>> callbacks(3,[&sink](float v){ sink = v; });
+		const size_t block = 64;
+		float data[block];
+		for(size_t i = 0; i < n; i += block) {
+			const size_t m = (i + block) < n ? block : n - i;
+			for(size_t j = 0; j < m; j++) data[j] = (float)nf.filter(ecg[i + j]);
+			det.detect(data,m);
+			for(auto &cb : callbacks) {
+				for(size_t j = 0; j < m; j++) cb(data[j]);
+			}
+		}
+		return n;
+	},beats);
+
+	const std::vector<long> &rPeaks = beatCounter.samplenumbers;
+	bench("hrv_metrics","beat",[&]() {
+		HRVMetrics hrv;
+		double sum = 0;
+		for(size_t i = 1; i < rPeaks.size(); i++) {
+			hrv.addRpeak((float)(60 * fs / (double)(rPeaks[i] - rPeaks[i - 1])),true);
+			sum += hrv.getResult().rmssd;
+		}
+		return rPeaks.size() + (sum < 0 ? 1 : 0);
+	});
+
+	bench("hrv_spectrum","beat",[&]() {
+		HRVSpectrum spectrum;
+		long prev = 0;
+		double sum = 0;
+		for(auto &p : rPeaks) {
+			spectrum.addBeat((double)p / fs,(double)(p - prev) * 1000 / fs);
+			sum += spectrum.getResult().lf;
+			prev = p;
+		}
+		return rPeaks.size() + (sum < 0 ? 1 : 0);
+	});
+
+#ifdef HAVE_CXX_SPLINE
+	// OvrHRPlot::addHR(): 60 heartrates in vectors and a new spline every beat
+	bench("spline_addhr","beat",[&]() {
+		std::vector<double> hrBuffer;
+		std::vector<double> hrTs;
+		cubic_spline hrSpline;
+		for(size_t i = 0; i < rPeaks.size(); i++) {
+			const double t = (double)rPeaks[i] / fs;
+			const double hr = i > 0 ? 60 * fs / (double)(rPeaks[i] - rPeaks[i - 1]) : 60;
+			hrTs.push_back(t);
+			hrBuffer.push_back(hr);
+			if (hrBuffer.size() > splineBeats) {
+				hrBuffer.erase(hrBuffer.begin());
+				hrTs.erase(hrTs.begin());
+			}
+			if (hrTs.size() > 1) {
+				hrSpline = cubic_spline(hrTs,hrBuffer);
+			}
+		}
+		return rPeaks.size();
+	});
+
+	// OvrHRPlot::render(): the last 30 secs of the spline every frame
+	std::vector<double> hrTs;
+	std::vector<double> hrBuffer;
+	for(size_t i = rPeaks.size() - splineBeats; i < rPeaks.size(); i++) {
+		hrTs.push_back((double)rPeaks[i] / fs);
+		hrBuffer.push_back(60 * fs / (double)(rPeaks[i] - rPeaks[i - 1]));
+	}
+	const cubic_spline spline(hrTs,hrBuffer);
+	const size_t frames = 500;
+	bench("spline_eval","eval",[&]() {
+		volatile double sink = 0;
+		const double t = hrTs.back();
+		for(size_t f = 0; f < frames; f++) {
+			for(size_t i = 0; i < splineEvaluations; i++) {
+				sink = spline(t - (double)i / (double)splineEvaluations * 30.0);
+			}
+		}
+		return frames * splineEvaluations + (sink < 0 ? 1 : 0);
+	});
+#endif
+
+	if (jsonFile) {
+		writeJSON(jsonFile,n);
+		printf("Results written to %s\n",jsonFile);
+	}
+	return 0;
+}
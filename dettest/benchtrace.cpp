@@ -0,0 +1,161 @@
+// The ECG trace of the app on the CPU: shifting all points by one for every
+// sample and uploading all vertices every frame as OvrECGPlot did before,
+// against ECGTrace which adds the samples to a min/max pyramid and only
+// uploads the columns which have changed. The uploads go into a copy of the
+// vertex buffer which is checked after every frame: against the shifted
+// trace if every sample is shown and against the min and max of the samples
+// of every column otherwise. Reports the CPU time per second of ECG, the
+// bytes uploaded per frame and the vertices drawn for windows of 2 secs,
+// 30 secs and 5 mins at 250Hz and 90 frames/sec.
+//
+// Usage: benchtrace [ecgfile] [hours]
+
+#include "../app/src/main/cpp/ecg_trace.h"
+#include "ecgreader.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+const size_t maxColumns = 512;
+const double fs = 250;
+const double fps = 90;
+
+static double since(std::chrono::steady_clock::time_point t) {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - t).count();
+}
+
+// samples which arrive until frame f
+static size_t samplesUntil(size_t f) {
+	return (size_t)((double)f * fs / fps);
+}
+
+// OvrECGPlot before the ring: xyz and rgba per point
+static double legacy(const std::vector<float> &ecg, size_t nPoints, size_t nFrames, double &bytesPerFrame) {
+	std::vector<float> positions(nPoints * 3,0.0f);
+	std::vector<unsigned char> colors(nPoints * 4,255);
+	std::vector<unsigned char> gpu(nPoints * 16);
+	size_t uploaded = 0;
+	size_t s = 0;
+	auto t = std::chrono::steady_clock::now();
+	for(size_t f = 1; f <= nFrames; f++) {
+		for(; s < samplesUntil(f); s++) {
+			for(size_t i = 0; i < (nPoints - 1); i++) {
+				positions[i * 3 + 1] = positions[(i + 1) * 3 + 1];
+			}
+			positions[(nPoints - 1) * 3 + 1] = ecg[s % ecg.size()];
+		}
+		// glBufferData of the whole struct
+		memcpy(gpu.data(),positions.data(),nPoints * 12);
+		memcpy(gpu.data() + nPoints * 12,colors.data(),nPoints * 4);
+		uploaded += nPoints * 16;
+	}
+	const double dt = since(t);
+	bytesPerFrame = (double)uploaded / (double)nFrames;
+	return dt;
+}
+
+// checks the vertex buffer against the samples: the column of age a
+// covers the samples of its column index at the level
+static bool checkFrame(const ECGTrace &trace, const std::vector<float> &gpu, const std::vector<float> &ecg, size_t nSamples) {
+	const ECGPyramid &p = trace.getPyramid();
+	const size_t level = trace.getLevel();
+	const size_t spc = p.getSamplesPerColumn(level);
+	const size_t n = trace.getNColumns();
+	const int64_t current = p.getCurrentColumn(level);
+	for(size_t a = 0; a < n; a++) {
+		const int64_t c = current - (int64_t)(n - 1 - a);
+		const size_t slot = (trace.getHead() + a) % n;
+		float mn = 0;
+		float mx = 0;
+		if (c >= 0) {
+			const size_t first = (size_t)c * spc;
+			const size_t last = std::min(first + spc,nSamples);
+			mn = mx = ecg[first % ecg.size()];
+			for(size_t i = first; i < last; i++) {
+				mn = std::min(mn,ecg[i % ecg.size()]);
+				mx = std::max(mx,ecg[i % ecg.size()]);
+			}
+		}
+		if ((gpu[slot * 2] != mn) || (gpu[slot * 2 + 1] != mx)) return false;
+	}
+	// the copy of slot 0
+	return (gpu[n * 2] == gpu[0]) && (gpu[n * 2 + 1] == gpu[1]);
+}
+
+static double ring(const std::vector<float> &ecg, size_t window, size_t nFrames, double &bytesPerFrame,
+		   size_t &vertices, size_t checkEvery, bool &ok) {
+	ECGTrace trace(maxColumns,(size_t)(300 * fs));
+	trace.setWindow(window);
+	std::vector<float> gpu((maxColumns + 1) * 2,0.0f);
+	ECGTrace::Range ranges[ECGTrace::maxRanges];
+	size_t uploaded = 0;
+	size_t s = 0;
+	ok = true;
+	auto t = std::chrono::steady_clock::now();
+	for(size_t f = 1; f <= nFrames; f++) {
+		for(; s < samplesUntil(f); s++) {
+			trace.add(ecg[s % ecg.size()]);
+		}
+		// glBufferSubData of the ranges
+		const size_t n = trace.update(ranges);
+		for(size_t i = 0; i < n; i++) {
+			memcpy(gpu.data() + ranges[i].first * 2,trace.getData() + ranges[i].first * 2,
+			       ranges[i].count * 2 * sizeof(float));
+			uploaded += ranges[i].count * 2 * sizeof(float);
+		}
+		if ((checkEvery > 0) && ((f % checkEvery) == 0)) {
+			ok = ok && checkFrame(trace,gpu,ecg,s);
+		}
+	}
+	const double dt = since(t);
+	bytesPerFrame = (double)uploaded / (double)nFrames;
+	vertices = (trace.getNColumns() + 1) * 2;
+	return dt;
+}
+
+int main(int argc, char* argv[]) {
+	std::vector<float> ecg;
+	if (argc > 1) {
+		ECGReader reader;
+		if (!reader.open(argv[1])) {
+			fprintf(stderr,"Could not open %s\n",argv[1]);
+			exit(1);
+		}
+		float v;
+		while (reader.read(&v,1) == 1) ecg.push_back(v * 1000);
+	} else {
+		for(int i = 0; i < 2500; i++) ecg.push_back((float)sin(i / 10.0) * 0.1f);
+	}
+	const double hours = argc > 2 ? atof(argv[2]) : 1;
+	const double secs = hours * 3600;
+	const size_t nFrames = (size_t)(secs * fps);
+
+	printf("%.1f hours of ECG at %.0f Hz, %.0f frames/sec, at most %zu columns\n",hours,fs,fps,maxColumns);
+	printf("%8s %6s %12s %12s %12s %12s %9s %s\n","window","level","legacy us/s","ring us/s",
+	       "legacy B/f","ring B/f","vertices","vertex buffer");
+	bool ok = true;
+	for(const double windowSecs : {2.0, 30.0, 300.0}) {
+		const size_t window = (size_t)(windowSecs * fs);
+		// shifting 5 mins for every sample is slow: a few minutes are enough
+		const double legacySecs = std::min(secs,600.0 * 500.0 / (double)window);
+		double bytesLegacy;
+		const double tLegacy = legacy(ecg,window,(size_t)(legacySecs * fps),bytesLegacy);
+		double bytesRing;
+		size_t vertices;
+		bool frameOk;
+		const double tRing = ring(ecg,window,nFrames,bytesRing,vertices,0,frameOk);
+		// not a multiple of the frames per column so that the columns are checked at all fill levels
+		ring(ecg,window,nFrames / 4,bytesRing,vertices,97,frameOk);
+		ok = ok && frameOk;
+		ECGPyramid p(maxColumns,(size_t)(300 * fs));
+		printf("%6.0f s %6zu %12.2f %12.2f %12.1f %12.1f %9zu %s\n",windowSecs,p.selectLevel(window),
+		       tLegacy * 1E6 / legacySecs,tRing * 1E6 / secs,bytesLegacy,bytesRing,vertices,
+		       frameOk ? "identical" : "DIFFERENT");
+	}
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,176 @@
+// The compact vertex layout of the wave grid of OvrHRPlot against the
+// interleaved floats of the positions and normals: WaveMesh writes the
+// heights as half floats and the normals as GL_INT_2_10_10_10_REV. Decodes
+// them as GLES does and reports the largest differences of the heights and
+// the angles of the normals, the bytes uploaded per frame and the time per
+// frame of both layouts. Checks that the triangle strips of
+// WaveMesh::getStripIndices() give the same triangles as the triangle list
+// of OvrHRPlot::CreateGeometry() before.
+//
+// Usage: benchwavecompact [frames]
+
+#include "../app/src/main/cpp/wave_mesh.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <vector>
+
+const int QUAD_GRID_SIZE = 200;
+const int shiftbuffersize = QUAD_GRID_SIZE * 10;
+const double scaleGrid = 50.0;
+const int NR_VERTICES = (QUAD_GRID_SIZE + 1) * (QUAD_GRID_SIZE + 1);
+const float windDir = (float)M_PI / 5;
+const float windSpeed = 100;
+const double temporalFreqs[3] = {7 / 4.0, 4 / 2.0, 5 / 3.0};
+
+// as before: positions and normals, all of it every frame
+struct FloatVertices {
+	float vertices[NR_VERTICES][3] = {};
+	float normals[NR_VERTICES][3] = {};
+};
+
+// as OvrHRPlot::HRVertices
+struct CompactVertices {
+	uint32_t normals[NR_VERTICES] = {};
+	uint16_t heights[NR_VERTICES] = {};
+};
+
+static double since(std::chrono::steady_clock::time_point t) {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - t).count();
+}
+
+static float fromHalf(uint16_t h) {
+	const int e = (h >> 10) & 0x1f;
+	const int m = h & 0x3ff;
+	float f;
+	if (0 == e) {
+		f = ldexpf((float)m,-24);
+	} else if (31 == e) {
+		f = m ? NAN : INFINITY;
+	} else {
+		f = ldexpf((float)(m + 1024),e - 25);
+	}
+	return (h & 0x8000) ? -f : f;
+}
+
+// signed normalised as GLES 3: max(c / 511, -1)
+static float component(uint32_t p, int shift) {
+	int c = (int)((p >> shift) & 0x3ff);
+	if (c >= 512) c -= 1024;
+	return std::max((float)c / 511.0f,-1.0f);
+}
+
+static void waves(WaveMesh::Wave *w) {
+	auto wd = (float)(windDir - M_PI / 7.0f);
+	for(int i = 0; i < 3; i++) {
+		wd += (float)(M_PI / 7.0f);
+		w[i].temporalFreq = temporalFreqs[i];
+		w[i].spatialFreqX = cos(wd) * windSpeed;
+		w[i].spatialFreqY = sin(wd) * windSpeed;
+	}
+}
+
+// the triangles of the list of OvrHRPlot::CreateGeometry() before, sorted
+static std::vector<std::array<int,3> > listTriangles() {
+	std::vector<std::array<int,3> > t;
+	const int n = QUAD_GRID_SIZE + 1;
+	for (int y = 0; y < QUAD_GRID_SIZE; y++) {
+		for (int x = 0; x < QUAD_GRID_SIZE; x++) {
+			t.push_back({y * n + x,(y + 1) * n + x + 1,y * n + x + 1});
+			t.push_back({y * n + x,(y + 1) * n + x,(y + 1) * n + x + 1});
+		}
+	}
+	for(auto &a : t) std::sort(a.begin(),a.end());
+	std::sort(t.begin(),t.end());
+	return t;
+}
+
+// the triangles of the strips, sorted
+static std::vector<std::array<int,3> > stripTriangles(const std::vector<uint16_t> &indices) {
+	std::vector<std::array<int,3> > t;
+	size_t start = 0;
+	for (size_t i = 0; i < indices.size(); i++) {
+		if (WaveMesh::restartIndex == indices[i]) {
+			start = i + 1;
+			continue;
+		}
+		if (i >= start + 2) {
+			std::array<int,3> a = {indices[i - 2],indices[i - 1],indices[i]};
+			// degenerate triangles are not drawn
+			if ((a[0] == a[1]) || (a[1] == a[2]) || (a[0] == a[2])) continue;
+			std::sort(a.begin(),a.end());
+			t.push_back(a);
+		}
+	}
+	std::sort(t.begin(),t.end());
+	return t;
+}
+
+int main(int argc, char* argv[]) {
+	const int nFrames = argc > 1 ? atoi(argv[1]) : 500;
+	WaveMesh mesh(QUAD_GRID_SIZE,scaleGrid,(size_t)shiftbuffersize,2);
+	std::vector<float> p(mesh.getProfileLength());
+	for (size_t i = 0; i < p.size(); i++) {
+		p[i] = (float)(2.5 + 2 * sin((double)i / 60.0) + 0.5 * sin((double)i / 700.0));
+	}
+	WaveMesh::Wave w[3];
+	waves(w);
+	static FloatVertices reference;
+	static CompactVertices compact;
+
+	auto t0 = std::chrono::steady_clock::now();
+	for (int f = 0; f < nFrames; f++) {
+		mesh.generate(f / 90.0,p.data(),w,3,0.1f,reference.vertices,reference.normals);
+	}
+	const double tFloat = since(t0) / nFrames;
+	t0 = std::chrono::steady_clock::now();
+	for (int f = 0; f < nFrames; f++) {
+		mesh.generate(f / 90.0,p.data(),w,3,0.1f,compact.heights,compact.normals);
+	}
+	const double tCompact = since(t0) / nFrames;
+
+	// the heights within half a unit in the last place, the normals within a degree
+	double maxDh = 0;
+	double maxAngle = 0;
+	for (const double t : {0.0, 1.234, 100.5, 3600.25, 36000.75}) {
+		mesh.generate(t,p.data(),w,3,0.1f,reference.vertices,reference.normals);
+		mesh.generate(t,p.data(),w,3,0.1f,compact.heights,compact.normals);
+		for (int i = 0; i < NR_VERTICES; i++) {
+			const float h = reference.vertices[i][1];
+			// the spacing of the half floats at h
+			const double ulp = ldexp(1.0,std::max(ilogbf(fabsf(h)),-14) - 10);
+			maxDh = std::max(maxDh,fabs(fromHalf(compact.heights[i]) - h) / ulp);
+			const float* n = reference.normals[i];
+			const double len = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+			const float nx = component(compact.normals[i],0);
+			const float ny = component(compact.normals[i],10);
+			const float nz = component(compact.normals[i],20);
+			const double plen = sqrt(nx * nx + ny * ny + nz * nz);
+			const double c = (n[0] * nx + n[1] * ny + n[2] * nz) / len / plen;
+			maxAngle = std::max(maxAngle,acos(std::min(c,1.0)) * 180 / M_PI);
+		}
+	}
+
+	std::vector<uint16_t> indices((size_t)mesh.getNumStripIndices());
+	mesh.getStripIndices(indices.data());
+	const bool sameTriangles = stripTriangles(indices) == listTriangles();
+
+	const size_t listIndices = 6 * QUAD_GRID_SIZE * QUAD_GRID_SIZE;
+	printf("%d x %d grid, %d vertices\n",QUAD_GRID_SIZE,QUAD_GRID_SIZE,NR_VERTICES);
+	printf("%-10s %10s %14s\n","","us/frame","bytes/frame");
+	printf("%-10s %10.1f %14zu\n","float",tFloat * 1E6,sizeof(FloatVertices));
+	printf("%-10s %10.1f %14zu  %.1f times less, plus %zu bytes of x and z once\n","compact",tCompact * 1E6,
+	       sizeof(CompactVertices),(double)sizeof(FloatVertices) / (double)sizeof(CompactVertices),
+	       (size_t)NR_VERTICES * 2 * sizeof(float));
+	printf("max height error %.4f ulp of half, max normal error %.3f degrees\n",maxDh,maxAngle);
+	printf("indices: %zu of the triangle list, %zu of the strips, same triangles: %s\n",listIndices,
+	       indices.size(),sameTriangles ? "yes" : "NO");
+	const bool ok = (maxDh <= 0.5) && (maxAngle < 1.0) && sameTriangles &&
+		((double)sizeof(FloatVertices) / (double)sizeof(CompactVertices) > 3.99);
+	printf("%s\n",ok ? "passed" : "FAILED");
+	return ok ? 0 : 1;
+}
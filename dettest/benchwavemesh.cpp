@@ -0,0 +1,216 @@
+// The wave grid of OvrHRPlot::render(): the heights from the HR history and
+// three waves in double with sin() and the normals from the cross products
+// of the triangles of every quad over the interleaved vertices as the app
+// did before, against WaveMesh with its float arrays, the radial index
+// table, the polynomial for |sin|, the closed form of the normals and its
+// worker threads. Checks the heights and normals of WaveMesh against the
+// old loops at times from the start up to 10 hours and reports the largest
+// differences and the time per frame.
+//
+// Usage: benchwavemesh [frames]
+
+#include "../app/src/main/cpp/wave_mesh.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+const int QUAD_GRID_SIZE = 200;
+const int shiftbuffersize = QUAD_GRID_SIZE * 10;
+const double scaleGrid = 50.0;
+const double deltaGrid = 2.0 / (double)QUAD_GRID_SIZE;
+const int NR_VERTICES = (QUAD_GRID_SIZE + 1) * (QUAD_GRID_SIZE + 1);
+const float windDir = (float)M_PI / 5;
+const float windSpeed = 100;
+const double temporalFreqs[3] = {7 / 4.0, 4 / 2.0, 5 / 3.0};
+
+struct HRVertices {
+	float vertices[NR_VERTICES][3] = {};
+	float normals[NR_VERTICES][3] = {};
+};
+
+static double since(std::chrono::steady_clock::time_point t) {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - t).count();
+}
+
+// the waves of OvrHRPlot before WaveMesh
+struct WavesAnim {
+	const double centerX = (QUAD_GRID_SIZE + 1) / 2;
+	const double centerY = (QUAD_GRID_SIZE + 1) / 2;
+	double temporalFreq = 1;
+	const double maxr = sqrt((QUAD_GRID_SIZE) * (QUAD_GRID_SIZE));
+	double spatialFreqX = 0;
+	double spatialFreqY = 0;
+	void updateSpatialFreq(float angle, float speed) {
+		spatialFreqX = cos(angle) * speed;
+		spatialFreqY = sin(angle) * speed;
+	}
+	float calcHeight(int x, int y, double t) {
+		const double xc = ((double)x - centerX) / maxr;
+		const double yc = ((double)y - centerY) / maxr;
+		const double dx = (xc * spatialFreqX + yc * spatialFreqY);
+		return (float)(1 - fabs(sin(dx + t * temporalFreq)));
+	}
+};
+
+static void crossProduct(const float v_A[3], const float v_B[3], float c_P[3]) {
+	c_P[0] = v_A[1] * v_B[2] - v_A[2] * v_B[1];
+	c_P[1] = v_A[2] * v_B[0] - v_A[0] * v_B[2];
+	c_P[2] = v_A[0] * v_B[1] - v_A[1] * v_B[0];
+}
+
+static void vecDiff(const float v_A[3], const float v_B[3], float c_P[3]) {
+	c_P[0] = v_A[0] - v_B[0];
+	c_P[1] = v_A[1] - v_B[1];
+	c_P[2] = v_A[2] - v_B[2];
+}
+
+static void createGeometry(HRVertices &v) {
+	for (int y = 0; y <= QUAD_GRID_SIZE; y++) {
+		for (int x = 0; x <= QUAD_GRID_SIZE; x++) {
+			const int p = y * (QUAD_GRID_SIZE + 1) + x;
+			v.vertices[p][0] = (float)(((double)x * deltaGrid - 1.0) * scaleGrid);
+			v.vertices[p][1] = 0;
+			v.vertices[p][2] = (float)(((double)y * deltaGrid - 1.0) * scaleGrid);
+			v.normals[p][0] = 0;
+			v.normals[p][1] = 1;
+			v.normals[p][2] = 0;
+		}
+	}
+}
+
+// the loops of OvrHRPlot::render() before WaveMesh
+static void legacy(HRVertices &v, const std::vector<double> &hrShiftBuffer, double minHR, double hrnorm, double t) {
+	WavesAnim wavesAnim[3];
+	for(int i = 0; i < 3; i++) wavesAnim[i].temporalFreq = temporalFreqs[i];
+	auto wd = (float)(windDir - M_PI / 7.0f);
+	for(auto &da : wavesAnim) {
+		wd += (float)(M_PI / 7.0f);
+		da.updateSpatialFreq(wd,windSpeed);
+	}
+	for (int x = 0; x <= QUAD_GRID_SIZE; x++) {
+		for (int y = 0; y <= QUAD_GRID_SIZE; y++) {
+			int vertexPosition = y * (QUAD_GRID_SIZE + 1) + x;
+			const double xc = (double)x - (QUAD_GRID_SIZE / 2.0);
+			const double yc = (double)y - (QUAD_GRID_SIZE / 2.0);
+			const double maxr = sqrt((QUAD_GRID_SIZE) * (QUAD_GRID_SIZE));
+			int r = (int)(round(sqrt(yc * yc + xc * xc) / maxr * (double)shiftbuffersize));
+			float h = 0;
+			if ((r < shiftbuffersize) && (hrnorm > 0)) {
+				if (hrShiftBuffer[(size_t)r] > 0) {
+					h += (float)((hrShiftBuffer[(size_t)r] - minHR) / hrnorm * 5.0);
+				}
+			}
+			for(auto &da : wavesAnim) {
+				h += da.calcHeight(x,y,t) * 0.1f;
+			}
+			v.vertices[vertexPosition][1] = h;
+		}
+	}
+	for (int x = 0; x < QUAD_GRID_SIZE; x++) {
+		for (int y = 0; y < QUAD_GRID_SIZE; y++) {
+			int vertexPosition1 = y * (QUAD_GRID_SIZE + 1) + x;
+			int vertexPosition2 = (y + 1) * (QUAD_GRID_SIZE + 1) + x + 1;
+			int vertexPosition3 = y * (QUAD_GRID_SIZE + 1) + x + 1;
+			float a[3];
+			float b[3];
+			float c1[3];
+			vecDiff(v.vertices[vertexPosition1],v.vertices[vertexPosition2],a);
+			vecDiff(v.vertices[vertexPosition1],v.vertices[vertexPosition3],b);
+			crossProduct(a,b,c1);
+			float c2[3];
+			vertexPosition1 = y * (QUAD_GRID_SIZE + 1) + x;
+			vertexPosition2 = (y + 1) * (QUAD_GRID_SIZE + 1) + x;
+			vertexPosition3 = y * (QUAD_GRID_SIZE + 1) + x + 1;
+			vecDiff(v.vertices[vertexPosition1],v.vertices[vertexPosition2],a);
+			vecDiff(v.vertices[vertexPosition1],v.vertices[vertexPosition3],b);
+			crossProduct(a,b,c2);
+			v.normals[vertexPosition1][0] = (c1[0] + c2[0]) / 2;
+			v.normals[vertexPosition1][1] = (c1[1] + c2[1]) / 2;
+			v.normals[vertexPosition1][2] = (c1[2] + c2[2]) / 2;
+		}
+	}
+}
+
+// the heights of the HR history as OvrHRPlot::render() hands them to WaveMesh
+static void profile(std::vector<float> &p, const std::vector<double> &hrShiftBuffer, double minHR, double hrnorm) {
+	for (size_t r = 0; r < p.size(); r++) {
+		float h = 0;
+		if (((int)r < shiftbuffersize) && (hrnorm > 0) && (hrShiftBuffer[r] > 0)) {
+			h = (float)((hrShiftBuffer[r] - minHR) / hrnorm * 5.0);
+		}
+		p[r] = h;
+	}
+}
+
+static void waves(WaveMesh::Wave *w) {
+	auto wd = (float)(windDir - M_PI / 7.0f);
+	for(int i = 0; i < 3; i++) {
+		wd += (float)(M_PI / 7.0f);
+		w[i].temporalFreq = temporalFreqs[i];
+		w[i].spatialFreqX = cos(wd) * windSpeed;
+		w[i].spatialFreqY = sin(wd) * windSpeed;
+	}
+}
+
+int main(int argc, char* argv[]) {
+	const int nFrames = argc > 1 ? atoi(argv[1]) : 500;
+	std::vector<double> hrShiftBuffer((size_t)shiftbuffersize);
+	for (size_t i = 0; i < hrShiftBuffer.size(); i++) {
+		hrShiftBuffer[i] = 70 + 8 * sin((double)i / 60.0) + 5 * sin((double)i / 700.0);
+	}
+	const double minHR = 55;
+	const double hrnorm = 30;
+	static HRVertices reference;
+	static HRVertices generated;
+	createGeometry(reference);
+	createGeometry(generated);
+	WaveMesh::Wave w[3];
+	waves(w);
+
+	printf("%d x %d grid, %d vertices, %u hardware threads\n",QUAD_GRID_SIZE,QUAD_GRID_SIZE,NR_VERTICES,
+	       std::thread::hardware_concurrency());
+	auto t0 = std::chrono::steady_clock::now();
+	for (int f = 0; f < nFrames; f++) {
+		legacy(reference,hrShiftBuffer,minHR,hrnorm,f / 90.0);
+	}
+	const double tLegacy = since(t0) / nFrames;
+	printf("%-12s %10s %14s %14s\n","","us/frame","max dh","max dnormal");
+	printf("%-12s %10.1f\n","legacy",tLegacy * 1E6);
+
+	bool ok = true;
+	for (int nWorkers = 0; nWorkers <= 3; nWorkers++) {
+		WaveMesh mesh(QUAD_GRID_SIZE,scaleGrid,(size_t)shiftbuffersize,nWorkers);
+		std::vector<float> p(mesh.getProfileLength());
+		t0 = std::chrono::steady_clock::now();
+		for (int f = 0; f < nFrames; f++) {
+			profile(p,hrShiftBuffer,minHR,hrnorm);
+			mesh.generate(f / 90.0,p.data(),w,3,0.1f,generated.vertices,generated.normals);
+		}
+		const double tMesh = since(t0) / nFrames;
+		// against the old loops up to 10 hours
+		double maxDh = 0;
+		double maxDn = 0;
+		for (const double t : {0.0, 1.234, 100.5, 3600.25, 36000.75}) {
+			legacy(reference,hrShiftBuffer,minHR,hrnorm,t);
+			profile(p,hrShiftBuffer,minHR,hrnorm);
+			mesh.generate(t,p.data(),w,3,0.1f,generated.vertices,generated.normals);
+			for (int i = 0; i < NR_VERTICES; i++) {
+				for (int k = 0; k < 3; k++) {
+					maxDh = std::max(maxDh,(double)fabsf(generated.vertices[i][k] - reference.vertices[i][k]));
+					maxDn = std::max(maxDn,(double)fabsf(generated.normals[i][k] - reference.normals[i][k]));
+				}
+			}
+		}
+		char name[32];
+		snprintf(name,sizeof(name),"%d workers",nWorkers);
+		printf("%-12s %10.1f %14.3g %14.3g  speedup %.1f\n",name,tMesh * 1E6,maxDh,maxDn,tLegacy / tMesh);
+		ok = ok && (maxDh < 1E-4) && (maxDn < 1E-4);
+	}
+	printf("%s\n",ok ? "identical within 1E-4" : "DIFFERENT");
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,261 @@
+// Converts between the chunked recording of the app (chunk_file.h) and the
+// formats of previous versions: the raw data as CSV (ms since the epoch,
+// channel 1, channel 2) and the heartrate as TSV (ms since the epoch, bpm).
+// Can export a time range and list the chunks of a recording.
+
+#include "../app/src/main/cpp/chunk_recorder.h"
+#include "../app/src/main/cpp/chunk_reader.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits>
+#include <string>
+#include <vector>
+
+static void usage(const char* name) {
+	fprintf(stderr,"Usage: %s import recording [-c raw.csv] [-t hr.tsv] [-s fs]\n",name);
+	fprintf(stderr,"       %s export recording [-c raw.csv] [-t hr.tsv] [-b beats.tsv] [-e events.tsv] [-f fromMs] [-u toMs]\n",name);
+	fprintf(stderr,"       %s info recording\n",name);
+	fprintf(stderr,"  import: appends the CSV and TSV to the recording as a new session\n");
+	fprintf(stderr,"  export: writes the CSV and TSV of the app, the beats with amplitude and\n");
+	fprintf(stderr,"          confidence and the events between fromMs and toMs\n");
+	fprintf(stderr,"  -s: sampling rate (default 250)\n");
+	exit(1);
+}
+
+struct HRLine {
+	int64_t t;
+	float bpm;
+};
+
+static bool readHR(FILE* f, HRLine &hr) {
+	char line[256];
+	while (fgets(line,sizeof(line),f)) {
+		char* end;
+		hr.t = strtoll(line,&end,10);
+		if (end == line) continue;
+		char* end2;
+		hr.bpm = strtof(end,&end2);
+		if (end2 != end) return true;
+	}
+	return false;
+}
+
+static int import(const std::string &recording, const std::string &csvFile, const std::string &tsvFile, float fs) {
+	FILE* csv = nullptr;
+	FILE* tsv = nullptr;
+	if ((!csvFile.empty()) && (!(csv = fopen(csvFile.c_str(),"rt")))) {
+		fprintf(stderr,"Could not open %s\n",csvFile.c_str());
+		return 1;
+	}
+	if ((!tsvFile.empty()) && (!(tsv = fopen(tsvFile.c_str(),"rt")))) {
+		fprintf(stderr,"Could not open %s\n",tsvFile.c_str());
+		return 1;
+	}
+	ChunkRecorder recorder;
+	recorder.setSyncInterval(0);
+	if (!recorder.start(recording,fs)) {
+		fprintf(stderr,"Could not open %s\n",recording.c_str());
+		return 1;
+	}
+	HRLine hr = {};
+	bool hasHR = tsv && readHR(tsv,hr);
+	long samples = 0;
+	long beats = 0;
+	int64_t lastT = 0;
+	if (csv) {
+		char line[256];
+		while (fgets(line,sizeof(line),csv)) {
+			char* p;
+			const int64_t t = strtoll(line,&p,10);
+			if (p == line) continue;
+			if (*p == ',') p++;
+			char* q;
+			const float ch1 = strtof(p,&q);
+			if (*q == ',') q++;
+			const float ch2 = strtof(q,nullptr);
+			// the beats up to this sample
+			while (hasHR && (hr.t <= t)) {
+				recorder.addBeat(samples,hr.t,hr.bpm,0,0);
+				beats++;
+				hasHR = readHR(tsv,hr);
+			}
+			recorder.add(samples,t,ch1,ch2);
+			lastT = t;
+			samples++;
+			// the file is read much faster than real time: no chunk must be dropped
+			if ((samples % (long)recorder.getSamplesPerChunk()) == 0) {
+				recorder.waitForWriter();
+			}
+		}
+		fclose(csv);
+	}
+	// beats after the samples or without samples
+	const int64_t t0 = samples > 0 ? lastT : hr.t;
+	const long n0 = samples > 0 ? samples - 1 : 0;
+	while (hasHR) {
+		recorder.addBeat(n0 + (long)((double)(hr.t - t0) * fs / 1000.0 + 0.5),hr.t,hr.bpm,0,0);
+		beats++;
+		hasHR = readHR(tsv,hr);
+	}
+	if (tsv) fclose(tsv);
+	recorder.stop();
+	printf("%ld samples and %ld beats imported into %s\n",samples,beats,recording.c_str());
+	return 0;
+}
+
+static FILE* openOutput(const std::string &filename) {
+	if (filename.empty()) return nullptr;
+	FILE* f = fopen(filename.c_str(),"wt");
+	if (!f) {
+		fprintf(stderr,"Could not open %s\n",filename.c_str());
+		exit(1);
+	}
+	return f;
+}
+
+static int exportRecording(const std::string &recording, const std::string &csvFile, const std::string &tsvFile,
+			   const std::string &beatsFile, const std::string &eventsFile, int64_t fromMs, int64_t toMs) {
+	ChunkReader reader;
+	if (!reader.open(recording)) {
+		fprintf(stderr,"%s is not a chunked recording\n",recording.c_str());
+		return 1;
+	}
+	FILE* csv = openOutput(csvFile);
+	FILE* tsv = openOutput(tsvFile);
+	FILE* beats = openOutput(beatsFile);
+	FILE* events = openOutput(eventsFile);
+	long nSamples = 0;
+	long nBeats = 0;
+	long nEvents = 0;
+	if (csv) {
+		const auto &c = reader.getChunks(ChunkFile::Samples);
+		const auto range = reader.findChunks(ChunkFile::Samples,fromMs,toMs);
+		std::vector<ChunkFile::SampleRecord> r;
+		for(size_t k = range.first; k < range.second; k++) {
+			r.resize(c[k].count);
+			if (!reader.readSamples(c[k],r.data())) {
+				fprintf(stderr,"Chunk at %ld is corrupt\n",(long)c[k].offset);
+				continue;
+			}
+			for(size_t i = 0; i < c[k].count; i++) {
+				const int64_t t = ChunkFile::sampleTimeMs(c[k],i);
+				if ((t < fromMs) || (t > toMs)) continue;
+				// as the CSV of previous versions of the app
+				fprintf(csv,"%ld,%f,%f\n",(long)t,r[i].ch1,r[i].ch2);
+				nSamples++;
+			}
+		}
+		fclose(csv);
+	}
+	if (tsv || beats) {
+		const auto &c = reader.getChunks(ChunkFile::Beats);
+		const auto range = reader.findChunks(ChunkFile::Beats,fromMs,toMs);
+		if (beats) fprintf(beats,"sample\tms\tbpm\tamplitude\tconfidence\n");
+		for(size_t k = range.first; k < range.second; k++) {
+			const ChunkFile::BeatRecord* r = reader.getRecords<ChunkFile::BeatRecord>(c[k]);
+			for(size_t i = 0; i < c[k].count; i++) {
+				if ((r[i].timestampMs < fromMs) || (r[i].timestampMs > toMs)) continue;
+				// as written by HRJournal
+				if (tsv) fprintf(tsv,"%ld\t%.1f\n",(long)r[i].timestampMs,r[i].bpm);
+				if (beats) fprintf(beats,"%ld\t%ld\t%f\t%f\t%f\n",(long)r[i].sampleNumber,(long)r[i].timestampMs,
+						   r[i].bpm,r[i].amplitude,r[i].confidence);
+				nBeats++;
+			}
+		}
+		if (tsv) fclose(tsv);
+		if (beats) fclose(beats);
+	}
+	if (events) {
+		const auto &c = reader.getChunks(ChunkFile::Events);
+		const auto range = reader.findChunks(ChunkFile::Events,fromMs,toMs);
+		fprintf(events,"sample\tms\tcode\tvalue\n");
+		for(size_t k = range.first; k < range.second; k++) {
+			const ChunkFile::EventRecord* r = reader.getRecords<ChunkFile::EventRecord>(c[k]);
+			for(size_t i = 0; i < c[k].count; i++) {
+				if ((r[i].timestampMs < fromMs) || (r[i].timestampMs > toMs)) continue;
+				fprintf(events,"%ld\t%ld\t%u\t%d\n",(long)r[i].sampleNumber,(long)r[i].timestampMs,
+					r[i].code,r[i].value);
+				nEvents++;
+			}
+		}
+		fclose(events);
+	}
+	printf("%ld samples, %ld beats and %ld events exported\n",nSamples,nBeats,nEvents);
+	return 0;
+}
+
+static int info(const std::string &recording) {
+	ChunkReader reader;
+	if (!reader.open(recording)) {
+		fprintf(stderr,"%s is not a chunked recording\n",recording.c_str());
+		return 1;
+	}
+	printf("%s: %zu bytes, fs = %g Hz, %zu chunks, index %s\n",recording.c_str(),reader.getFileSize(),
+	       (double)reader.getSamplingRate(),reader.getIndex().size(),
+	       reader.hasFooter() ? "from the footer" : "rebuilt from the chunk headers");
+	const char* names[] = {"samples","beats","events"};
+	for(uint32_t type = 1; type <= ChunkFile::nChunkTypes; type++) {
+		const auto &c = reader.getChunks(type);
+		size_t n = 0;
+		size_t corrupt = 0;
+		for(auto &e : c) {
+			n += e.count;
+			if (!reader.verify(e)) corrupt++;
+		}
+		printf("%-8s %8zu chunks %12zu records",names[type - 1],c.size(),n);
+		if (!c.empty()) {
+			printf("  %ld..%ld ms",(long)c.front().startMs,(long)c.back().endMs);
+		}
+		if (corrupt > 0) {
+			printf("  %zu chunks with wrong checksum",corrupt);
+		}
+		printf("\n");
+	}
+	return 0;
+}
+
+int main (int argn,char** argv)
+{
+	if (argn < 3) usage(argv[0]);
+	const std::string command = argv[1];
+	const std::string recording = argv[2];
+	std::string csvFile;
+	std::string tsvFile;
+	std::string beatsFile;
+	std::string eventsFile;
+	float fs = 250;
+	int64_t fromMs = std::numeric_limits<int64_t>::min();
+	int64_t toMs = std::numeric_limits<int64_t>::max();
+	for(int i = 3; i < argn; i++) {
+		if ((i + 1) >= argn) usage(argv[0]);
+		if (strcmp(argv[i],"-c") == 0) {
+			csvFile = argv[++i];
+		} else if (strcmp(argv[i],"-t") == 0) {
+			tsvFile = argv[++i];
+		} else if (strcmp(argv[i],"-b") == 0) {
+			beatsFile = argv[++i];
+		} else if (strcmp(argv[i],"-e") == 0) {
+			eventsFile = argv[++i];
+		} else if (strcmp(argv[i],"-s") == 0) {
+			fs = (float)atof(argv[++i]);
+		} else if (strcmp(argv[i],"-f") == 0) {
+			fromMs = atoll(argv[++i]);
+		} else if (strcmp(argv[i],"-u") == 0) {
+			toMs = atoll(argv[++i]);
+		} else {
+			usage(argv[0]);
+		}
+	}
+	if (command == "import") {
+		return import(recording,csvFile,tsvFile,fs);
+	} else if (command == "export") {
+		return exportRecording(recording,csvFile,tsvFile,beatsFile,eventsFile,fromMs,toMs);
+	} else if (command == "info") {
+		return info(recording);
+	}
+	usage(argv[0]);
+	return 1;
+}
@@ -0,0 +1,344 @@
+#include "ecgreader.h"
+
+#include <fcntl.h>
+#include <math.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+constexpr char ECGReader::magic[9];
+
+// the pages before the read position are released in steps of 64MB
+static constexpr size_t releaseStep = 64 << 20;
+
+// exact in double
+static const double powersOfTen[] = {
+	1E0, 1E1, 1E2, 1E3, 1E4, 1E5, 1E6, 1E7, 1E8, 1E9, 1E10, 1E11,
+	1E12, 1E13, 1E14, 1E15, 1E16, 1E17, 1E18, 1E19, 1E20, 1E21, 1E22
+};
+
+static constexpr int maxExactPower = 22;
+
+// digits which fit into the 64 bit mantissa
+static constexpr int maxDigits = 19;
+
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+// true if all eight bytes of w are ASCII digits
+static inline bool isEightDigits(uint64_t w) {
+	return ((w & 0xF0F0F0F0F0F0F0F0) |
+		(((w + 0x0606060606060606) & 0xF0F0F0F0F0F0F0F0) >> 4)) == 0x3333333333333333;
+}
+
+// the value of eight ASCII digits in w with the first digit in the lowest byte
+static inline uint64_t eightDigits(uint64_t w) {
+	const uint64_t mask = 0x000000FF000000FF;
+	// 100 + (1000000 << 32) and 1 + (10000 << 32)
+	const uint64_t mul1 = 0x000F424000000064;
+	const uint64_t mul2 = 0x0000271000000001;
+	w -= 0x3030303030303030;
+	w = (w * 10) + (w >> 8);
+	return (((w & mask) * mul1) + (((w >> 16) & mask) * mul2)) >> 32;
+}
+#endif
+
+// adds the digits at p to the mantissa m which has n digits. Digits after
+// the maxDigits are dropped and counted in dropped. Returns the position
+// after the digits.
+static inline const char* parseDigits(const char* p, const char* end, uint64_t &m, int &n, int &dropped) {
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+	while (((end - p) >= 8) && ((n + 8) <= maxDigits)) {
+		uint64_t w;
+		memcpy(&w,p,sizeof(w));
+		if (!isEightDigits(w)) break;
+		m = m * 100000000 + eightDigits(w);
+		// leading zeros do not count
+		if (m > 0) n += 8;
+		p += 8;
+	}
+#endif
+	while (p < end) {
+		const unsigned d = (unsigned)(*p - '0');
+		if (d > 9) break;
+		if (n < maxDigits) {
+			m = m * 10 + d;
+			if (m > 0) n++;
+		} else {
+			dropped++;
+		}
+		p++;
+	}
+	return p;
+}
+
+const char* ECGReader::parseFloat(const char* p, const char* end, float &v) {
+	const char* start = p;
+	bool negative = false;
+	if ((p < end) && ((*p == '-') || (*p == '+'))) {
+		negative = *p == '-';
+		p++;
+	}
+	uint64_t m = 0;
+	int n = 0;
+	int dropped = 0;
+	const char* q = parseDigits(p,end,m,n,dropped);
+	bool hasDigits = q != p;
+	// the dropped digits of the integer part multiply by ten
+	int exp10 = dropped;
+	p = q;
+	if ((p < end) && (*p == '.')) {
+		p++;
+		dropped = 0;
+		q = parseDigits(p,end,m,n,dropped);
+		hasDigits = hasDigits || (q != p);
+		// every digit of the fraction taken into the mantissa divides by ten
+		exp10 -= (int)(q - p) - dropped;
+		p = q;
+	}
+	if (!hasDigits) return start;
+	if ((p < end) && ((*p == 'e') || (*p == 'E'))) {
+		const char* e = p + 1;
+		bool negativeExp = false;
+		if ((e < end) && ((*e == '-') || (*e == '+'))) {
+			negativeExp = *e == '-';
+			e++;
+		}
+		int x = 0;
+		const char* d = e;
+		while ((d < end) && ((unsigned)(*d - '0') <= 9)) {
+			if (x < 10000) x = x * 10 + (*d - '0');
+			d++;
+		}
+		if (d != e) {
+			exp10 += negativeExp ? -x : x;
+			p = d;
+		}
+	}
+	double r = (double)m;
+	if (m > 0) {
+		while (exp10 > maxExactPower) {
+			r *= powersOfTen[maxExactPower];
+			exp10 -= maxExactPower;
+		}
+		while (exp10 < -maxExactPower) {
+			r /= powersOfTen[maxExactPower];
+			exp10 += maxExactPower;
+		}
+		r = exp10 < 0 ? r / powersOfTen[-exp10] : r * powersOfTen[exp10];
+	}
+	v = (float)(negative ? -r : r);
+	return p;
+}
+
+bool ECGReader::open(const std::string &filename, unsigned c) {
+	close();
+	fd = ::open(filename.c_str(),O_RDONLY);
+	if (fd < 0) return false;
+	struct stat st;
+	if (fstat(fd,&st) != 0) {
+		close();
+		return false;
+	}
+	size = (size_t)st.st_size;
+	if (size > 0) {
+		void* p = mmap(nullptr,size,PROT_READ,MAP_PRIVATE,fd,0);
+		if (MAP_FAILED == p) {
+			close();
+			return false;
+		}
+		madvise(p,size,MADV_SEQUENTIAL);
+		data = (const char*)p;
+	}
+	pos = 0;
+	released = 0;
+	column = c;
+	if ((size >= sizeof(Header)) && (memcmp(data,magic,sizeof(Header::magic)) == 0)) {
+		Header header;
+		memcpy(&header,data,sizeof(header));
+		if (((header.format != Float32) && (header.format != Int24)) ||
+		    (header.channels == 0) || (c >= header.channels)) {
+			close();
+			return false;
+		}
+		format = (Format)header.format;
+		channels = header.channels;
+		fs = header.fs;
+		scale = header.scale;
+		pos = sizeof(Header);
+	} else {
+		format = Text;
+		channels = 1;
+		fs = 0;
+		scale = 1;
+	}
+	return true;
+}
+
+void ECGReader::close() {
+	if (data) {
+		munmap((void*)data,size);
+		data = nullptr;
+	}
+	if (fd >= 0) {
+		::close(fd);
+		fd = -1;
+	}
+	size = 0;
+	pos = 0;
+	format = None;
+}
+
+size_t ECGReader::read(float* v, size_t n) {
+	switch (format) {
+	case Text:
+		return readText(v,n);
+	case Float32:
+	case Int24:
+		return readBinary(v,n);
+	default:
+		return 0;
+	}
+}
+
+static inline bool isSeparator(char c) {
+	return (c == ',') || (c == ' ') || (c == '\t');
+}
+
+size_t ECGReader::readText(float* v, size_t n) {
+	const char* p = data + pos;
+	const char* end = data + size;
+	size_t k = 0;
+	while ((k < n) && (p < end)) {
+		while ((p < end) && ((*p == ' ') || (*p == '\t') || (*p == '\r'))) p++;
+		for(unsigned c = 0; c < column; c++) {
+			while ((p < end) && (!isSeparator(*p)) && (*p != '\n')) p++;
+			while ((p < end) && isSeparator(*p)) p++;
+		}
+		const char* q = parseFloat(p,end,v[k]);
+		if (q != p) k++;
+		// usually the number is the end of the line
+		if ((q < end) && (*q == '\n')) {
+			p = q + 1;
+		} else {
+			const char* eol = (const char*)memchr(q,'\n',(size_t)(end - q));
+			p = eol ? eol + 1 : end;
+		}
+	}
+	pos = (size_t)(p - data);
+	releasePages(pos);
+	return k;
+}
+
+size_t ECGReader::readBinary(float* v, size_t n) {
+	const size_t bytesPerSample = Float32 == format ? 4 : 3;
+	const size_t frameSize = channels * bytesPerSample;
+	const size_t available = (size - pos) / frameSize;
+	if (n > available) n = available;
+	const unsigned char* p = (const unsigned char*)data + pos + column * bytesPerSample;
+	if (Float32 == format) {
+		if (1 == channels) {
+			memcpy(v,p,n * sizeof(float));
+		} else {
+			for(size_t i = 0; i < n; i++) {
+				memcpy(v + i,p + i * frameSize,sizeof(float));
+			}
+		}
+	} else {
+		for(size_t i = 0; i < n; i++) {
+			const unsigned char* s = p + i * frameSize;
+			// sign extension of the 24 bits
+			const int32_t x = (int32_t)(((uint32_t)s[0] << 8) | ((uint32_t)s[1] << 16) | ((uint32_t)s[2] << 24)) >> 8;
+			v[i] = (float)x * scale;
+		}
+	}
+	pos += n * frameSize;
+	releasePages(pos);
+	return n;
+}
+
+const float* ECGReader::getFloatSamples(size_t &n) const {
+	if ((Float32 != format) || (channels != 1)) {
+		n = 0;
+		return nullptr;
+	}
+	n = (size - sizeof(Header)) / sizeof(float);
+	return (const float*)(data + sizeof(Header));
+}
+
+void ECGReader::releasePages(size_t offset) {
+	const size_t steps = (offset - released) / releaseStep;
+	if (0 == steps) return;
+	madvise((void*)(data + released),steps * releaseStep,MADV_DONTNEED);
+	released += steps * releaseStep;
+}
+
+bool loadECG(const std::string &filename, std::vector<float> &v, unsigned column) {
+	ECGReader reader;
+	if (!reader.open(filename,column)) return false;
+	const size_t block = 4096;
+	size_t n = v.size();
+	for(;;) {
+		v.resize(n + block);
+		const size_t m = reader.read(v.data() + n,block);
+		n += m;
+		if (0 == m) break;
+	}
+	v.resize(n);
+	return true;
+}
+
+bool ECGWriter::open(const std::string &filename, ECGReader::Format fmt,
+		     unsigned nChannels, float fs, float s) {
+	close();
+	if (((fmt != ECGReader::Float32) && (fmt != ECGReader::Int24)) || (0 == nChannels)) return false;
+	f = fopen(filename.c_str(),"wb");
+	if (!f) return false;
+	format = fmt;
+	channels = nChannels;
+	scale = ECGReader::Int24 == fmt ? s : 1;
+	ECGReader::Header header = {};
+	memcpy(header.magic,ECGReader::magic,sizeof(header.magic));
+	header.version = ECGReader::version;
+	header.format = fmt;
+	header.channels = nChannels;
+	header.fs = fs;
+	header.scale = scale;
+	failed = fwrite(&header,sizeof(header),1,f) != 1;
+	nBuffer = 0;
+	return !failed;
+}
+
+void ECGWriter::write(const float* v, size_t n) {
+	if (!f) return;
+	const size_t nValues = n * channels;
+	for(size_t i = 0; i < nValues; i++) {
+		if ((nBuffer + sizeof(float)) > sizeof(buffer)) flush();
+		if (ECGReader::Float32 == format) {
+			memcpy(buffer + nBuffer,v + i,sizeof(float));
+			nBuffer += sizeof(float);
+		} else {
+			double x = round((double)v[i] / (double)scale);
+			if (x > 8388607) x = 8388607;
+			if (x < -8388608) x = -8388608;
+			const int32_t k = (int32_t)x;
+			buffer[nBuffer++] = (unsigned char)(k & 0xff);
+			buffer[nBuffer++] = (unsigned char)((k >> 8) & 0xff);
+			buffer[nBuffer++] = (unsigned char)((k >> 16) & 0xff);
+		}
+	}
+}
+
+void ECGWriter::flush() {
+	if (nBuffer > 0) {
+		if (fwrite(buffer,nBuffer,1,f) != 1) failed = true;
+		nBuffer = 0;
+	}
+}
+
+bool ECGWriter::close() {
+	if (!f) return !failed;
+	flush();
+	if (fclose(f) != 0) failed = true;
+	f = nullptr;
+	return !failed;
+}
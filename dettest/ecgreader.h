@@ -0,0 +1,135 @@
+#ifndef ECGREADER_H
+#define ECGREADER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+// Reads ECG recordings for the offline tools. The file is memory mapped and
+// the samples are delivered in blocks so that there is no syscall or
+// allocation per sample. Formats:
+// - text: one sample per line, columns separated by comma, space or tab.
+//   The numbers are parsed in place: runs of eight digits are converted at
+//   once and the lines are found with memchr. Lines which do not start with
+//   a number are skipped.
+// - binary: a header and the samples as interleaved float32 or as 24 bit
+//   integers which are scaled to V. Written by ECGWriter.
+// Pages which have been read are released so that files of many GB can be
+// read without filling the memory.
+class ECGReader {
+
+public:
+	enum Format {
+		None = 0,
+		Text = 1,
+		Float32 = 2,
+		Int24 = 3
+	};
+
+	struct Header {
+		char magic[8];
+		uint32_t version;
+		uint32_t format;
+		uint32_t channels;
+		float fs;
+		// V per LSB of Int24
+		float scale;
+		uint32_t reserved;
+	};
+
+	static constexpr char magic[9] = "ATTYSECG";
+
+	static constexpr uint32_t version = 1;
+
+	~ECGReader() {
+		close();
+	}
+
+	// maps the file and reads the samples of the given column or channel
+	// returns false if the file cannot be opened or, for binary files, the
+	// channel does not exist
+	bool open(const std::string &filename, unsigned column = 0);
+
+	void close();
+
+	// reads up to n samples into v and returns their number: 0 at the end
+	size_t read(float* v, size_t n);
+
+	// single channel Float32 file: the samples in the mapping without any copy
+	const float* getFloatSamples(size_t &n) const;
+
+	Format getFormat() const {
+		return format;
+	}
+
+	// from the header of binary files, 0 for text files
+	float getSamplingRate() const {
+		return fs;
+	}
+
+	size_t getFileSize() const {
+		return size;
+	}
+
+	// parses the number at p and returns the position after it or p if
+	// there is no number
+	static const char* parseFloat(const char* p, const char* end, float &v);
+
+private:
+	size_t readText(float* v, size_t n);
+
+	size_t readBinary(float* v, size_t n);
+
+	// releases the pages before the read position
+	void releasePages(size_t offset);
+
+	int fd = -1;
+	const char* data = nullptr;
+	size_t size = 0;
+	size_t pos = 0;
+	size_t released = 0;
+
+	Format format = None;
+	unsigned column = 0;
+	unsigned channels = 1;
+	float fs = 0;
+	float scale = 1;
+};
+
+// appends all samples of the column or channel of the file to v
+// returns false if the file cannot be opened
+bool loadECG(const std::string &filename, std::vector<float> &v, unsigned column = 0);
+
+// Writes the binary format of ECGReader
+class ECGWriter {
+
+public:
+	~ECGWriter() {
+		close();
+	}
+
+	// format: Float32 or Int24 with scale V per LSB
+	bool open(const std::string &filename, ECGReader::Format format,
+		  unsigned channels, float fs, float scale = 1E-9f);
+
+	// writes n frames of interleaved channels
+	void write(const float* v, size_t n);
+
+	// returns false if a write has failed
+	bool close();
+
+private:
+	void flush();
+
+	FILE* f = nullptr;
+	ECGReader::Format format = ECGReader::None;
+	unsigned channels = 1;
+	float scale = 1;
+	bool failed = false;
+	unsigned char buffer[65536];
+	size_t nBuffer = 0;
+};
+
+#endif
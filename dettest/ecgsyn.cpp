@@ -0,0 +1,107 @@
+#include "ecgsyn.h"
+
+// angles, amplitudes and widths of the P, Q, R, S and T waves
+// from the paper
+static const int nWaves = 5;
+static const double waveTheta[nWaves] = {-M_PI / 3, -M_PI / 12, 0, M_PI / 12, M_PI / 2};
+static const double waveA[nWaves] = {1.2, -5, 30, -7.5, 0.75};
+static const double waveB[nWaves] = {0.25, 0.1, 0.1, 0.1, 0.4};
+
+// frequencies of the Mayer waves and the respiration in Hz
+static const double lfFrequency = 0.1;
+static const double hfFrequency = 0.25;
+
+ECGSyn::ECGSyn(const Params &p) : params(p), gen(p.seed) {
+	meanRR = 60 / params.meanHR;
+	// standard deviation of the RR intervals: mostly the two modulations
+	const double stdRR = 60 * params.stdHR / (params.meanHR * params.meanHR);
+	const double lfVar = stdRR * stdRR * 0.9 * params.lfhf / (1 + params.lfhf);
+	const double hfVar = stdRR * stdRR * 0.9 / (1 + params.lfhf);
+	lfAmplitude = sqrt(2 * lfVar);
+	hfAmplitude = sqrt(2 * hfVar);
+	rrJitter = stdRR * sqrt(0.1);
+	lfPhase = 2 * M_PI * uniform(gen);
+	hfPhase = 2 * M_PI * uniform(gen);
+	rr = nextRR();
+
+	// scales the model so that the R peak has the amplitude requested
+	const double dt = 1 / (double)params.fs;
+	const double omega = 2 * M_PI / meanRR;
+	double th = -M_PI;
+	double zc = 0;
+	double zmax = 0;
+	for(int i = 0; i < (int)(3 * meanRR * params.fs); i++) {
+		zc = step(th,zc,omega,dt);
+		th += omega * dt;
+		if (th >= M_PI) th -= 2 * M_PI;
+		if (zc > zmax) zmax = zc;
+	}
+	scale = params.amplitude / zmax;
+}
+
+double ECGSyn::nextRR() {
+	const double t = (double)sampleNumber / (double)params.fs;
+	double r = meanRR +
+		lfAmplitude * sin(2 * M_PI * lfFrequency * t + lfPhase) +
+		hfAmplitude * sin(2 * M_PI * hfFrequency * t + hfPhase) +
+		rrJitter * normal(gen);
+	if (r < 0.3) r = 0.3;
+	if (r > 2) r = 2;
+	return r;
+}
+
+double ECGSyn::dz(double th, double zc, double omega) const {
+	double d = 0;
+	for(int i = 0; i < nWaves; i++) {
+		double dth = th - waveTheta[i];
+		if (dth < -M_PI) dth += 2 * M_PI;
+		if (dth >= M_PI) dth -= 2 * M_PI;
+		d -= waveA[i] * omega * dth * exp(-dth * dth / (2 * waveB[i] * waveB[i]));
+	}
+	return d - zc;
+}
+
+// Runge Kutta: the angle moves with the constant speed omega
+double ECGSyn::step(double th, double zc, double omega, double dt) const {
+	const double k1 = dz(th,zc,omega);
+	const double k2 = dz(th + omega * dt / 2,zc + dt / 2 * k1,omega);
+	const double k3 = dz(th + omega * dt / 2,zc + dt / 2 * k2,omega);
+	const double k4 = dz(th + omega * dt,zc + dt * k3,omega);
+	return zc + dt / 6 * (k1 + 2 * k2 + 2 * k3 + k4);
+}
+
+float ECGSyn::next() {
+	const double dt = 1 / (double)params.fs;
+	const double t = (double)sampleNumber * dt;
+	const double omega = 2 * M_PI / rr;
+	z = step(theta,z,omega,dt);
+	const double prevTheta = theta;
+	theta += omega * dt;
+	if ((prevTheta < 0) && (theta >= 0) && rPeakListener) {
+		// the sample closest to the R wave
+		const long n = (-prevTheta) < theta ? sampleNumber - 1 : sampleNumber;
+		rPeakListener(n,artefactSamples > 0);
+	}
+	if (theta >= M_PI) {
+		theta -= 2 * M_PI;
+		rr = nextRR();
+	}
+
+	if (artefactSamples > 0) {
+		artefact = 0.95 * artefact + 0.3 * params.artefactAmplitude * normal(gen);
+		artefactSamples--;
+	} else {
+		artefact = 0;
+		if (uniform(gen) < (params.artefactsPerHour * dt / 3600)) {
+			artefactSamples = (long)(params.artefactDuration * params.fs);
+		}
+	}
+
+	const double v = scale * z +
+		params.wanderAmplitude * sin(2 * M_PI * params.wanderFrequency * t) +
+		params.mainsAmplitude * sin(2 * M_PI * params.mainsFrequency * t) +
+		params.noise * normal(gen) +
+		artefact;
+	sampleNumber++;
+	return (float)v;
+}
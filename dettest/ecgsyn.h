@@ -0,0 +1,113 @@
+#ifndef ECGSYN_H
+#define ECGSYN_H
+
+#include <stddef.h>
+#include <math.h>
+#include <functional>
+#include <random>
+
+// Synthetic ECG with the dynamical model of McSharry et al. (ECGSYN,
+// IEEE Trans Biomed Eng 50(3), 2003). A point moves around the unit
+// circle once per heartbeat and the P, Q, R, S and T waves are gaussian
+// events at fixed angles which push the ECG up or down. The RR intervals
+// are modulated by the Mayer waves (0.1Hz) and the respiration (0.25Hz).
+// Baseline wander, mains hum, noise and artefact bursts are added so that
+// the output looks like the Attys in V. The sample number of every R peak
+// is reported so that a detector can be checked against the truth.
+class ECGSyn {
+
+public:
+	struct Params {
+		// sampling rate of the Attys: 125, 250, 500 or 1000Hz
+		float fs = 250;
+		// mean heartrate and its standard deviation in bpm
+		double meanHR = 60;
+		double stdHR = 1;
+		// power of the 0.1Hz modulation divided by that of the 0.25Hz one
+		double lfhf = 0.5;
+		// amplitude of the R peak in V
+		double amplitude = 1E-3;
+		// standard deviation of white noise in V
+		double noise = 10E-6;
+		// baseline wander by the respiration
+		double wanderAmplitude = 200E-6;
+		double wanderFrequency = 0.25;
+		// powerline interference
+		double mainsAmplitude = 100E-6;
+		double mainsFrequency = 50;
+		// bursts of movement artefacts: average number per hour, length in
+		// secs and amplitude in V
+		double artefactsPerHour = 0;
+		double artefactDuration = 2;
+		double artefactAmplitude = 20E-3;
+		unsigned seed = 1;
+	};
+
+	ECGSyn(const Params &p);
+
+	// the next sample in V
+	float next();
+
+	// generates n samples
+	void generate(float* v, size_t n) {
+		for(size_t i = 0; i < n; i++) {
+			v[i] = next();
+		}
+	}
+
+	// called with the sample number of every R peak and true if the
+	// R peak is within an artefact burst
+	void setRpeakListener(const std::function<void(long,bool)> &f) {
+		rPeakListener = f;
+	}
+
+	// number of samples generated so far
+	long getSampleNumber() const {
+		return sampleNumber;
+	}
+
+	// true while an artefact burst is generated
+	bool isArtefact() const {
+		return artefactSamples > 0;
+	}
+
+private:
+	// the next RR interval in secs
+	double nextRR();
+
+	// dz/dt of the model at the angle theta for the angular speed omega
+	double dz(double theta, double z, double omega) const;
+
+	// one step of dt secs of the model starting at the angle theta
+	double step(double theta, double z, double omega, double dt) const;
+
+	const Params params;
+
+	std::mt19937 gen;
+	std::normal_distribution<double> normal{0,1};
+	std::uniform_real_distribution<double> uniform{0,1};
+
+	// modulation of the RR intervals in secs
+	double meanRR;
+	double lfAmplitude;
+	double hfAmplitude;
+	double lfPhase;
+	double hfPhase;
+	double rrJitter;
+
+	// state of the model
+	double theta = -M_PI;
+	double z = 0;
+	double rr;
+	double scale = 1;
+
+	long sampleNumber = 0;
+
+	// samples left in the current artefact burst and its random walk
+	long artefactSamples = 0;
+	double artefact = 0;
+
+	std::function<void(long,bool)> rPeakListener;
+};
+
+#endif
@@ -0,0 +1,29 @@
+#ifndef HOSTSTUBS_ANDROID_LOG_H
+#define HOSTSTUBS_ANDROID_LOG_H
+
+// Stand-in for the Android log: warnings and errors go to stderr,
+// verbose, debug and info messages are discarded.
+
+#include <stdio.h>
+#include <stdarg.h>
+
+enum {
+    ANDROID_LOG_VERBOSE = 2,
+    ANDROID_LOG_DEBUG = 3,
+    ANDROID_LOG_INFO = 4,
+    ANDROID_LOG_WARN = 5,
+    ANDROID_LOG_ERROR = 6
+};
+
+static inline int __android_log_print(int prio, const char* tag, const char* fmt, ...) {
+    if (prio < ANDROID_LOG_WARN) return 0;
+    va_list args;
+    va_start(args, fmt);
+    fprintf(stderr, "%s: ", tag);
+    const int r = vfprintf(stderr, fmt, args);
+    fprintf(stderr, "\n");
+    va_end(args);
+    return r;
+}
+
+#endif
@@ -0,0 +1,7 @@
+#ifndef HOSTSTUBS_ANDROID_NATIVE_WINDOW_JNI_H
+#define HOSTSTUBS_ANDROID_NATIVE_WINDOW_JNI_H
+
+// Stand-in: the host build has no native windows, only the JNI types.
+#include <jni.h>
+
+#endif
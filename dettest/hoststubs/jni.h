@@ -0,0 +1,56 @@
+#ifndef HOSTSTUBS_JNI_H
+#define HOSTSTUBS_JNI_H
+
+// Minimal stand-in for the JNI of the Android NDK so that the native
+// code of the app can be compiled and driven on a Linux host.
+// Only the types and JNIEnv functions used by the app are provided.
+// A jobject is a host buffer and a jstring a C string.
+
+#include <stdint.h>
+#include <string.h>
+
+#define JNIEXPORT __attribute__((visibility("default")))
+#define JNICALL
+
+typedef uint8_t jboolean;
+typedef int32_t jint;
+typedef int64_t jlong;
+typedef float jfloat;
+typedef double jdouble;
+
+// a direct buffer (java.nio.ByteBuffer.allocateDirect())
+struct _jobject {
+    void* address;
+    jlong capacity;
+};
+
+struct _jclass {
+};
+
+struct _jstring {
+    const char* chars;
+};
+
+typedef _jobject* jobject;
+typedef _jclass* jclass;
+typedef _jstring* jstring;
+
+struct JNIEnv {
+    void* GetDirectBufferAddress(jobject buf) {
+        return nullptr == buf ? nullptr : buf->address;
+    }
+
+    jlong GetDirectBufferCapacity(jobject buf) {
+        return nullptr == buf ? -1 : buf->capacity;
+    }
+
+    const char* GetStringUTFChars(jstring str, jboolean* isCopy) {
+        if (nullptr != isCopy) *isCopy = 0;
+        return str->chars;
+    }
+
+    void ReleaseStringUTFChars(jstring, const char*) {
+    }
+};
+
+#endif
@@ -0,0 +1,137 @@
+// Writes millions of heartbeats with the HRJournal while another thread
+// flushes it now and then as the app does at every session change.
+// Compares the cost per beat with opening, appending and closing the file
+// for every beat as the app did before. Then reads all segments back and
+// checks that every beat is there in the right order.
+
+#include "../app/src/main/cpp/hr_journal.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+
+const int64_t t0ms = 1700000000000;
+
+// beat i at 60 bpm plus a bit of variability so that the lines differ
+static float bpm(long i) {
+	return 60.0f + (float)(i % 40);
+}
+
+// reads one file and checks that it continues the beats from beat i
+// returns the next beat or -1 on error
+static long check(const std::string &filename, long i) {
+	FILE* f = fopen(filename.c_str(),"rt");
+	if (!f) return i;
+	long t;
+	float b;
+	while (fscanf(f,"%ld\t%f\n",&t,&b) == 2) {
+		if ((t != (t0ms + i * 1000)) || (b != bpm(i))) {
+			fprintf(stderr,"%s: beat %ld is wrong: %ld %f\n",filename.c_str(),i,t,b);
+			fclose(f);
+			return -1;
+		}
+		i++;
+	}
+	fclose(f);
+	return i;
+}
+
+static void removeAll(const std::string &filename) {
+	unlink(filename.c_str());
+	for(int n = 1; access(HRJournal::segmentFilename(filename,n).c_str(),F_OK) == 0; n++) {
+		unlink(HRJournal::segmentFilename(filename,n).c_str());
+	}
+}
+
+int main (int argn,char** argv)
+{
+	std::string dir = "/tmp";
+	long n = 5000000;
+	for(int i = 1; i < argn; i++) {
+		if ((strcmp(argv[i],"-d") == 0) && ((i + 1) < argn)) {
+			dir = argv[++i];
+		} else if ((strcmp(argv[i],"-n") == 0) && ((i + 1) < argn)) {
+			n = atol(argv[++i]);
+		} else {
+			fprintf(stderr,"Usage: %s [-n beats] [-d directory]\n",argv[0]);
+			exit(1);
+		}
+	}
+	const std::string filename = dir + "/hrjournaltest.tsv";
+	removeAll(filename);
+
+	printf("%-28s %10s %14s\n","writer","beats","ns/beat");
+
+	// as the app did before: open, seek, tell, append and close per beat
+	const long nOld = n / 50;
+	auto t0 = std::chrono::steady_clock::now();
+	for(long i = 0; i < nOld; i++) {
+		FILE* f = fopen(filename.c_str(),"at");
+		if (!f) {
+			fprintf(stderr,"Could not open %s\n",filename.c_str());
+			exit(1);
+		}
+		fseek(f,0,SEEK_END);
+		if (ftell(f) < 100000000) {
+			fprintf(f,"%ld\t%.1f\n",(long)(t0ms + i * 1000),bpm(i));
+		}
+		fclose(f);
+	}
+	auto t1 = std::chrono::steady_clock::now();
+	printf("%-28s %10ld %14f\n","fopen/fclose per beat",nOld,
+	       std::chrono::duration<double,std::nano>(t1 - t0).count() / (double)nOld);
+	removeAll(filename);
+
+	HRJournal journal;
+	// small segments so that the rotation happens often
+	journal.setMaxSegmentSize(10000000);
+	if (!journal.open(filename)) {
+		fprintf(stderr,"Could not open %s\n",filename.c_str());
+		exit(1);
+	}
+	std::atomic<bool> done(false);
+	std::atomic<long> flushes(0);
+	std::thread sessionChanges([&]() {
+		while (!done) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(20));
+			journal.flush();
+			flushes++;
+		}
+	});
+	t0 = std::chrono::steady_clock::now();
+	for(long i = 0; i < n; i++) {
+		journal.add(t0ms + i * 1000,bpm(i));
+	}
+	t1 = std::chrono::steady_clock::now();
+	done = true;
+	sessionChanges.join();
+	journal.close();
+	const auto t2 = std::chrono::steady_clock::now();
+	printf("%-28s %10ld %14f\n","HRJournal add()",n,
+	       std::chrono::duration<double,std::nano>(t1 - t0).count() / (double)n);
+	printf("%-28s %10ld %14f\n","HRJournal incl. close()",n,
+	       std::chrono::duration<double,std::nano>(t2 - t0).count() / (double)n);
+	printf("%lu beats written, %lu segments, %ld flushes\n",
+	       journal.getRecordsWritten(),journal.getSegmentsRotated(),flushes.load());
+
+	// the oldest segment is .1 and the newest beats are in the file itself
+	long i = 0;
+	for(int s = 1; s <= (int)journal.getSegmentsRotated(); s++) {
+		i = check(HRJournal::segmentFilename(filename,s),i);
+		if (i < 0) return 1;
+	}
+	i = check(filename,i);
+	if (i < 0) return 1;
+	if (i != n) {
+		fprintf(stderr,"%ld beats read back instead of %ld!\n",i,n);
+		return 1;
+	}
+	printf("All beats read back in order.\n");
+	removeAll(filename);
+	return 0;
+}
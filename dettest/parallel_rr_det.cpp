@@ -0,0 +1,99 @@
+#include "parallel_rr_det.h"
+#include "../app/src/main/cpp/ecg_rr_det.h"
+
+#include <atomic>
+#include <thread>
+#include "Iir.h"
+
+// collects the beats and converts the sample number of the detector
+// into the index of the recording: the detector does not count the
+// samples it has ignored
+namespace {
+struct BeatCollector : ECG_rr_det::RRlistener {
+	std::vector<Parallel_rr_det::Beat> &beats;
+	size_t currentIndex = 0;
+	size_t start = 0;
+	BeatCollector(std::vector<Parallel_rr_det::Beat> &b) : beats(b) {}
+	virtual void hasRpeak(long,
+			      float bpm,
+			      double amplitude,
+			      double confidence) {
+		if (currentIndex < start) return;
+		beats.push_back({currentIndex, bpm, amplitude, confidence});
+	}
+};
+}
+
+Parallel_rr_det::Parallel_rr_det(float fs, float mains) :
+	samplingRateInHz(fs),
+	mainsInHz(mains) {
+}
+
+void Parallel_rr_det::detectChunk(const std::vector<float> &ecg,
+				  size_t start,
+				  size_t end,
+				  std::vector<Beat> &beats) const {
+	Iir::Butterworth::BandStop<2> iirnotch;
+	iirnotch.setup(samplingRateInHz,mainsInHz,2);
+	BeatCollector recorder(beats);
+	recorder.start = start;
+	ECG_rr_det rr_det(&recorder);
+	rr_det.init(samplingRateInHz);
+	const size_t first = start > warmupSamples ? start - warmupSamples : 0;
+	for(size_t i = first; i < end; i++) {
+		recorder.currentIndex = i;
+		rr_det.detect(iirnotch.filter(ecg[i]));
+	}
+}
+
+std::vector<Parallel_rr_det::Beat> Parallel_rr_det::detectSerial(const std::vector<float> &ecg) const {
+	std::vector<Beat> beats;
+	Iir::Butterworth::BandStop<2> iirnotch;
+	iirnotch.setup(samplingRateInHz,mainsInHz,2);
+	BeatCollector recorder(beats);
+	ECG_rr_det rr_det(&recorder);
+	rr_det.init(samplingRateInHz);
+	for(size_t i = 0; i < ecg.size(); i++) {
+		recorder.currentIndex = i;
+		rr_det.detect(iirnotch.filter(ecg[i]));
+	}
+	return beats;
+}
+
+std::vector<Parallel_rr_det::Beat> Parallel_rr_det::detect(const std::vector<float> &ecg, unsigned nThreads) const {
+	if (nThreads < 1) nThreads = 1;
+	size_t chunk = chunkSamples;
+	if (0 == chunk) {
+		// a few chunks per thread to balance the load but
+		// large compared to the warmup which is done twice
+		chunk = ecg.size() / (nThreads * 4) + 1;
+		if (chunk < (warmupSamples * 10)) chunk = warmupSamples * 10;
+	}
+	const size_t nChunks = (ecg.size() + chunk - 1) / chunk;
+	std::vector<std::vector<Beat>> chunkBeats(nChunks);
+
+	std::atomic<size_t> nextChunk(0);
+	auto worker = [&]() {
+		for(;;) {
+			const size_t c = nextChunk++;
+			if (c >= nChunks) return;
+			const size_t start = c * chunk;
+			const size_t end = (start + chunk) < ecg.size() ? start + chunk : ecg.size();
+			detectChunk(ecg,start,end,chunkBeats[c]);
+		}
+	};
+	std::vector<std::thread> threads;
+	for(unsigned i = 1; i < nThreads; i++) {
+		threads.emplace_back(worker);
+	}
+	worker();
+	for(auto &t : threads) {
+		t.join();
+	}
+
+	std::vector<Beat> beats;
+	for(auto &b : chunkBeats) {
+		beats.insert(beats.end(),b.begin(),b.end());
+	}
+	return beats;
+}
@@ -0,0 +1,63 @@
+#ifndef PARALLEL_RR_DET_H
+#define PARALLEL_RR_DET_H
+
+#include <stddef.h>
+#include <vector>
+
+// Offline R peak detection of a long recording with a pool of threads.
+// The recording is split into chunks and every chunk is processed by its
+// own notch filter and ECG_rr_det. A chunk starts warmupSamples earlier
+// so that the filters and the adaptive threshold have settled when the
+// chunk begins. Only the beats inside a chunk are kept so that the
+// stitched list has no duplicates.
+class Parallel_rr_det {
+
+public:
+	struct Beat {
+		// index of the sample in the recording where the R peak was detected
+		size_t sampleIndex;
+		float bpm;
+		double amplitude;
+		double confidence;
+	};
+
+	// fs is the sampling rate and mains the powerline frequency in Hz
+	Parallel_rr_det(float fs = 250, float mains = 50);
+
+	// the samples before a chunk used to settle the detector
+	void setWarmupSamples(size_t n) {
+		warmupSamples = n;
+	}
+
+	size_t getWarmupSamples() const {
+		return warmupSamples;
+	}
+
+	// length of a chunk; 0 means that it is chosen from the number of threads
+	void setChunkSamples(size_t n) {
+		chunkSamples = n;
+	}
+
+	// detects the beats of the whole recording in one go in this thread
+	std::vector<Beat> detectSerial(const std::vector<float> &ecg) const;
+
+	// detects the beats with nThreads threads
+	std::vector<Beat> detect(const std::vector<float> &ecg, unsigned nThreads) const;
+
+private:
+	// detects the beats in [start,end) by starting warmupSamples earlier
+	void detectChunk(const std::vector<float> &ecg,
+			 size_t start,
+			 size_t end,
+			 std::vector<Beat> &beats) const;
+
+	const float samplingRateInHz;
+	const float mainsInHz;
+
+	// 1 min
+	size_t warmupSamples = 15000;
+
+	size_t chunkSamples = 0;
+};
+
+#endif
@@ -0,0 +1,155 @@
+// Detects the beats of a long recording in parallel chunks and reports
+// the speed-up against the number of threads. With -c the stitched beats
+// are checked against the serial detector.
+
+#include "parallel_rr_det.h"
+#include "ecgreader.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <unistd.h>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+static void usage(const char* name) {
+	fprintf(stderr,"Usage: %s [-c] [-t threads] [-w warmup samples] [-r repeats] [-o beatfile] ecgfile [ecgfile ...]\n",name);
+	fprintf(stderr,"  -c: checks the parallel detection against the serial one\n");
+	fprintf(stderr,"  -t: maximum number of threads (default: number of cores)\n");
+	fprintf(stderr,"  -w: samples to settle the detector before a chunk\n");
+	fprintf(stderr,"  -r: repeats the recording to create a long one\n");
+	fprintf(stderr,"  -o: writes the beats as tab separated sample index and bpm\n");
+	exit(1);
+}
+
+// compares the beats and returns the number of differences
+static size_t compare(const std::vector<Parallel_rr_det::Beat> &serial,
+		      const std::vector<Parallel_rr_det::Beat> &parallel) {
+	size_t i = 0;
+	size_t j = 0;
+	size_t missing = 0;
+	size_t extra = 0;
+	size_t differentBPM = 0;
+	double maxAmplitudeError = 0;
+	while ((i < serial.size()) || (j < parallel.size())) {
+		if ((j >= parallel.size()) ||
+		    ((i < serial.size()) && (serial[i].sampleIndex < parallel[j].sampleIndex))) {
+			fprintf(stderr,"Missing beat at sample %zu\n",serial[i].sampleIndex);
+			missing++;
+			i++;
+		} else if ((i >= serial.size()) ||
+			   (parallel[j].sampleIndex < serial[i].sampleIndex)) {
+			fprintf(stderr,"Extra beat at sample %zu\n",parallel[j].sampleIndex);
+			extra++;
+			j++;
+		} else {
+			if (serial[i].bpm != parallel[j].bpm) {
+				fprintf(stderr,"Different bpm at sample %zu: %f != %f\n",
+					serial[i].sampleIndex,serial[i].bpm,parallel[j].bpm);
+				differentBPM++;
+			}
+			const double e = fabs(serial[i].amplitude - parallel[j].amplitude) / serial[i].amplitude;
+			if (e > maxAmplitudeError) maxAmplitudeError = e;
+			i++;
+			j++;
+		}
+	}
+	printf("Check against serial: %zu beats, %zu missing, %zu extra, %zu with different bpm, "
+	       "max relative amplitude difference %g\n",
+	       serial.size(),missing,extra,differentBPM,maxAmplitudeError);
+	return missing + extra + differentBPM;
+}
+
+int main (int argn,char** argv)
+{
+	bool check = false;
+	unsigned maxThreads = std::thread::hardware_concurrency();
+	long warmup = -1;
+	int repeats = 1;
+	const char* beatfile = nullptr;
+	int opt;
+	while ((opt = getopt(argn,argv,"ct:w:r:o:")) != -1) {
+		switch (opt) {
+		case 'c':
+			check = true;
+			break;
+		case 't':
+			maxThreads = (unsigned)atoi(optarg);
+			break;
+		case 'w':
+			warmup = atol(optarg);
+			break;
+		case 'r':
+			repeats = atoi(optarg);
+			break;
+		case 'o':
+			beatfile = optarg;
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (optind >= argn) usage(argv[0]);
+	if (maxThreads < 1) maxThreads = 1;
+
+	std::vector<float> recording;
+	for(int i = optind; i < argn; i++) {
+		if (!loadECG(argv[i],recording)) {
+			fprintf(stderr,"Could not open %s\n",argv[i]);
+			exit(1);
+		}
+	}
+	std::vector<float> ecg;
+	for(int r = 0; r < repeats; r++) {
+		ecg.insert(ecg.end(),recording.begin(),recording.end());
+	}
+	const float fs = 250;
+	printf("%zu samples = %f h\n",ecg.size(),(double)ecg.size() / fs / 3600.0);
+
+	Parallel_rr_det parallel_rr_det(fs);
+	if (warmup >= 0) {
+		parallel_rr_det.setWarmupSamples((size_t)warmup);
+	}
+
+	auto t0 = std::chrono::steady_clock::now();
+	const std::vector<Parallel_rr_det::Beat> serial = parallel_rr_det.detectSerial(ecg);
+	auto t1 = std::chrono::steady_clock::now();
+	const double tSerial = std::chrono::duration<double>(t1 - t0).count();
+	printf("serial: %f sec, %zu beats\n",tSerial,serial.size());
+
+	printf("threads\tsec\tspeedup\n");
+	// 1, 2, 4, ... and the maximum number of threads
+	std::vector<unsigned> threadCounts;
+	for(unsigned n = 1; n < maxThreads; n *= 2) {
+		threadCounts.push_back(n);
+	}
+	threadCounts.push_back(maxThreads);
+	std::vector<Parallel_rr_det::Beat> beats;
+	for(unsigned nThreads : threadCounts) {
+		t0 = std::chrono::steady_clock::now();
+		beats = parallel_rr_det.detect(ecg,nThreads);
+		t1 = std::chrono::steady_clock::now();
+		const double t = std::chrono::duration<double>(t1 - t0).count();
+		printf("%u\t%f\t%f\n",nThreads,t,tSerial / t);
+	}
+
+	if (beatfile) {
+		FILE* f = fopen(beatfile,"wt");
+		if (!f) {
+			fprintf(stderr,"Could not open %s\n",beatfile);
+			exit(1);
+		}
+		for(auto &b : beats) {
+			fprintf(f,"%zu\t%f\n",b.sampleIndex,b.bpm);
+		}
+		fclose(f);
+	}
+
+	if (check) {
+		if (compare(serial,beats) > 0) {
+			return 1;
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,123 @@
+// Replays a recording through the native pipeline of the app on the host:
+// JNI entry points, notch filter, detector, HRV, recorder and the
+// heartrate file as written by the app. Runs in real time, N times faster
+// or as fast as possible and reports the throughput and the results.
+// The heartrates can be saved to compare them between versions.
+
+#include "attyshost.h"
+#include "attysreplay.h"
+#include "../app/src/main/cpp/attysjava2cpp.h"
+#include "../app/src/main/cpp/hr_journal.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+static void usage(const char* name) {
+	fprintf(stderr,"Usage: %s [-r | -x speed] [-s fs] [-b batch] [-o directory] [-l hrfile] recording\n",name);
+	fprintf(stderr,"  -r: real time, -x: N times faster than real time, default: as fast as possible\n");
+	fprintf(stderr,"  -s: sampling rate of text files (default 250)\n");
+	fprintf(stderr,"  -b: samples per JNI call (default 10)\n");
+	fprintf(stderr,"  -o: writes the heartrate file and the recording of the app into the directory\n");
+	fprintf(stderr,"  -l: writes every heartrate into a file\n");
+	exit(1);
+}
+
+int main (int argn,char** argv)
+{
+	AttysReplay replay;
+	double speed = 0;
+	float fs = 0;
+	std::string dir;
+	std::string hrList;
+	std::string recording;
+	for(int i = 1; i < argn; i++) {
+		if (strcmp(argv[i],"-r") == 0) {
+			speed = 1;
+		} else if ((strcmp(argv[i],"-x") == 0) && ((i + 1) < argn)) {
+			speed = atof(argv[++i]);
+		} else if ((strcmp(argv[i],"-s") == 0) && ((i + 1) < argn)) {
+			fs = (float)atof(argv[++i]);
+		} else if ((strcmp(argv[i],"-b") == 0) && ((i + 1) < argn)) {
+			replay.setBatchSize((size_t)atol(argv[++i]));
+		} else if ((strcmp(argv[i],"-o") == 0) && ((i + 1) < argn)) {
+			dir = argv[++i];
+		} else if ((strcmp(argv[i],"-l") == 0) && ((i + 1) < argn)) {
+			hrList = argv[++i];
+		} else if ((argv[i][0] != '-') && recording.empty()) {
+			recording = argv[i];
+		} else {
+			usage(argv[0]);
+		}
+	}
+	if (recording.empty()) usage(argv[0]);
+	if (fs > 0) replay.setSamplingRate(fs);
+	if (!replay.load(recording)) {
+		fprintf(stderr,"Could not load %s\n",recording.c_str());
+		exit(1);
+	}
+	replay.setSpeed(speed);
+
+	JNIEnv env;
+	HRJournal hrJournal;
+	if (!dir.empty()) {
+		const std::string hrFile = dir + "/attyshrv_heartrate.tsv";
+		const std::string rawFile = dir + "/attyshrv_recording.dat";
+		_jstring hrPath = {hrFile.c_str()};
+		_jstring rawPath = {rawFile.c_str()};
+		Java_tech_glasgowneuro_attyshrv_ANativeActivity_setHRfilePath(&env,nullptr,&hrPath);
+		Java_tech_glasgowneuro_attyshrv_ANativeActivity_setRawFilePath(&env,nullptr,&rawPath);
+		if (!hrJournal.open(getAttysHRfilepath())) {
+			fprintf(stderr,"Could not open %s\n",hrFile.c_str());
+			exit(1);
+		}
+	}
+
+	// the consumers of the app: the heartrate file and the HRV
+	std::vector<float> hr;
+	HRVMetrics::Result hrv;
+	registerAttysHRCallback([&hr,&hrJournal](float bpm) {
+		hr.push_back(bpm);
+		if (hrJournal.isOpen()) hrJournal.add(bpm);
+	});
+	registerAttysHRVCallback([&hrv](const HRVMetrics::Result &r) {
+		hrv = r;
+	});
+
+	const float samplingRate = replay.getSamplingRate();
+	const size_t n = replay.getSamples().size();
+	printf("%s: %zu samples = %.1f secs at %.0f Hz\n",recording.c_str(),n,(double)n / samplingRate,samplingRate);
+	const AttysReplay::Stats stats = replay.run();
+	hrJournal.close();
+
+	const double realtime = (double)stats.samples / samplingRate;
+	printf("replayed %zu samples in %f secs: %.1f x real time, %.0f samples/s\n",
+	       stats.samples,stats.seconds,realtime / stats.seconds,(double)stats.samples / stats.seconds);
+	if (speed > 0) {
+		printf("max lag behind the schedule: %f ms\n",stats.maxLag * 1E3);
+	}
+	printf("queue overruns: %lu\n",stats.overruns);
+	double sum = 0;
+	for(auto &b : hr) sum += b;
+	printf("%zu heartbeats, mean HR = %f bpm\n",hr.size(),hr.empty() ? 0 : sum / (double)hr.size());
+	printf("HRV of the last %zu RR intervals: SDNN = %f ms, RMSSD = %f ms, pNN50 = %f %%\n",
+	       hrv.nIntervals,hrv.sdnn,hrv.rmssd,hrv.pnn50);
+	const HRVSpectrum::Result spectrum = getAttysHRVSpectrum();
+	if (spectrum.valid) {
+		printf("HRV spectrum: LF = %f ms^2, HF = %f ms^2, peak = %f Hz\n",
+		       spectrum.lf,spectrum.hf,spectrum.peakFrequency);
+	}
+
+	if (!hrList.empty()) {
+		FILE* f = fopen(hrList.c_str(),"wt");
+		if (!f) {
+			fprintf(stderr,"Could not open %s\n",hrList.c_str());
+			exit(1);
+		}
+		for(auto &b : hr) fprintf(f,"%f\n",b);
+		fclose(f);
+	}
+	return stats.overruns > 0 ? 1 : 0;
+}
@@ -0,0 +1,93 @@
+// Stress test of the ring between the bluetooth thread and the DSP thread:
+// a producer thread pushes sequence numbers and a consumer thread pops them
+// in batches. Checks that every element arrives once and in order, that the
+// dropped ones are counted as overruns and reports the throughput.
+
+#include "../app/src/main/cpp/spsc_ring.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+struct Sample {
+	long sampleNumber;
+	int64_t timestampNs;
+	float v;
+};
+
+typedef SPSCRing<Sample, 1024> Ring;
+
+const size_t batchSize = 64;
+
+// lossless: the producer waits until there is space in the ring
+// otherwise the consumer sleeps every sleepEvery batches to create overruns
+static bool run(const char* name, long nSamples, bool lossless, int sleepEvery) {
+	Ring* ring = new Ring;
+	bool ok = true;
+	long received = 0;
+	std::atomic<bool> done(false);
+
+	auto t0 = std::chrono::steady_clock::now();
+	std::thread producer([&]() {
+		for(long i = 0; i < nSamples; i++) {
+			while (lossless && (ring->size() >= Ring::getCapacity())) {
+				std::this_thread::yield();
+			}
+			ring->push({i, (int64_t)i, (float)i});
+		}
+		done = true;
+	});
+
+	Sample samples[batchSize];
+	long expected = 0;
+	int batches = 0;
+	for(;;) {
+		const size_t n = ring->pop(samples,batchSize);
+		if (0 == n) {
+			if (done && (0 == ring->size())) break;
+			std::this_thread::yield();
+			continue;
+		}
+		for(size_t i = 0; i < n; i++) {
+			// elements can only be missing but never be out of order
+			if ((samples[i].sampleNumber < expected) ||
+			    (samples[i].v != (float)samples[i].sampleNumber)) {
+				fprintf(stderr,"Sample %ld after %ld\n",samples[i].sampleNumber,expected - 1);
+				ok = false;
+			}
+			expected = samples[i].sampleNumber + 1;
+		}
+		received += (long)n;
+		batches++;
+		if ((sleepEvery > 0) && ((batches % sleepEvery) == 0)) {
+			std::this_thread::sleep_for(std::chrono::microseconds(100));
+		}
+	}
+	producer.join();
+	auto t1 = std::chrono::steady_clock::now();
+	const double t = std::chrono::duration<double>(t1 - t0).count();
+
+	const long overruns = (long)ring->getOverruns();
+	if ((received + overruns) != nSamples) {
+		fprintf(stderr,"%ld received + %ld overruns != %ld pushed\n",received,overruns,nSamples);
+		ok = false;
+	}
+	if (lossless && (overruns > 0)) {
+		fprintf(stderr,"Overruns although the producer has waited\n");
+		ok = false;
+	}
+	printf("%s: %ld samples, %f Msamples/s, high water mark = %zu, overruns = %ld, %s\n",
+	       name,nSamples,(double)nSamples / t / 1E6,ring->getHighWaterMark(),overruns,
+	       ok ? "OK" : "FAILED");
+	delete ring;
+	return ok;
+}
+
+int main (int, char**)
+{
+	bool ok = run("lossless",20000000,true,0);
+	ok = run("slow consumer",20000000,false,4) && ok;
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,262 @@
+// Soak test with the synthetic ECG of ECGSyn: runs hours of ECG with
+// heartrate variability, noise, baseline wander, mains and artefact bursts
+// through the detector and checks the R peaks against the true ones.
+// Reports the throughput, the resident memory and the accuracy for every
+// hour. With -j the samples go through the JNI entry points of the app
+// (where dataUpdateBatch is called) and the number of heartbeats and their
+// mean rate are compared as the app does not report the sample number.
+
+#include "ecgsyn.h"
+#include "attyshost.h"
+#include "../app/src/main/cpp/attysjava2cpp.h"
+#include "../app/src/main/cpp/ecg_rr_det.h"
+#include "../app/src/main/cpp/sos_cascade.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <thread>
+#include <vector>
+#include "Iir.h"
+
+// samples generated in one go
+const size_t blockSize = 1000;
+
+// a detected R peak matches a true one within this window after it in secs
+// or before it
+const double maxDelay = 0.15;
+const double maxAdvance = 0.05;
+
+// true R peaks in an artefact burst or this many secs after it or at the
+// start are not expected to be detected
+const double settleTime = 10;
+
+static double residentMB() {
+	long pages = 0;
+	long resident = 0;
+	FILE* f = fopen("/proc/self/statm","rt");
+	if (!f) return 0;
+	if (fscanf(f,"%ld %ld",&pages,&resident) != 2) resident = 0;
+	fclose(f);
+	return (double)resident * (double)sysconf(_SC_PAGESIZE) / 1E6;
+}
+
+// compares the detected R peaks with the true ones
+struct Accuracy {
+	long tolLate;
+	long tolEarly;
+	long settle;
+	// true R peaks which have not been matched yet: sample number and if expected
+	std::deque<std::pair<long,bool>> pending;
+	long dontCareUntil = 0;
+	long truePositives = 0;
+	long falseNegatives = 0;
+	long falsePositives = 0;
+	long notExpected = 0;
+	double sumError = 0;
+
+	Accuracy(float fs) :
+		tolLate((long)(maxDelay * fs)),
+		tolEarly((long)(maxAdvance * fs)),
+		settle((long)(settleTime * fs)) {
+		dontCareUntil = settle;
+	}
+
+	void truth(long n, bool inArtefact) {
+		if (inArtefact) dontCareUntil = n + settle;
+		pending.push_back({n,n >= dontCareUntil});
+	}
+
+	// the detector says that there is an R peak at sample n
+	void detected(long n) {
+		expire(n);
+		if ((!pending.empty()) && (pending.front().first <= (n + tolEarly))) {
+			if (pending.front().second) {
+				truePositives++;
+				sumError += (double)(n - pending.front().first);
+			}
+			pending.pop_front();
+			return;
+		}
+		if (n >= dontCareUntil) falsePositives++;
+	}
+
+	// true R peaks which cannot be matched any more at sample n
+	void expire(long n) {
+		while ((!pending.empty()) && (pending.front().first < (n - tolLate))) {
+			if (pending.front().second) {
+				falseNegatives++;
+			} else {
+				notExpected++;
+			}
+			pending.pop_front();
+		}
+	}
+
+	double sensitivity() const {
+		return (double)truePositives / (double)(truePositives + falseNegatives);
+	}
+
+	double ppv() const {
+		return (double)truePositives / (double)(truePositives + falsePositives);
+	}
+};
+
+// maps the timestamp of the detector to the sample number of the generator
+struct SoakListener : ECG_rr_det::RRlistener {
+	Accuracy &accuracy;
+	long currentSample = 0;
+	SoakListener(Accuracy &a) : accuracy(a) {}
+	virtual void hasRpeak(long,
+			      float,
+			      double,
+			      double) {
+		accuracy.detected(currentSample);
+	}
+};
+
+static void usage(const char* name) {
+	fprintf(stderr,"Usage: %s [-h hours] [-s fs] [-r bpm] [-a artefacts/hour] [-n noise uV] [-j]\n",name);
+	exit(1);
+}
+
+int main (int argn,char** argv)
+{
+	double hours = 24;
+	bool jni = false;
+	ECGSyn::Params params;
+	params.artefactsPerHour = 6;
+	for(int i = 1; i < argn; i++) {
+		if ((strcmp(argv[i],"-h") == 0) && ((i + 1) < argn)) {
+			hours = atof(argv[++i]);
+		} else if ((strcmp(argv[i],"-s") == 0) && ((i + 1) < argn)) {
+			params.fs = (float)atof(argv[++i]);
+		} else if ((strcmp(argv[i],"-r") == 0) && ((i + 1) < argn)) {
+			params.meanHR = atof(argv[++i]);
+		} else if ((strcmp(argv[i],"-a") == 0) && ((i + 1) < argn)) {
+			params.artefactsPerHour = atof(argv[++i]);
+		} else if ((strcmp(argv[i],"-n") == 0) && ((i + 1) < argn)) {
+			params.noise = atof(argv[++i]) * 1E-6;
+		} else if (strcmp(argv[i],"-j") == 0) {
+			jni = true;
+		} else {
+			usage(argv[0]);
+		}
+	}
+	const float fs = params.fs;
+	const long samplesPerHour = (long)(fs * 3600);
+	const long nTotal = (long)(hours * (double)samplesPerHour);
+
+	ECGSyn ecgsyn(params);
+	Accuracy accuracy(fs);
+	long nTrue = 0;
+	ecgsyn.setRpeakListener([&accuracy,&nTrue](long n, bool inArtefact) {
+		accuracy.truth(n,inArtefact);
+		nTrue++;
+	});
+
+	// the detector as the app runs it
+	SoakListener listener(accuracy);
+	ECG_rr_det rrDet(&listener);
+	rrDet.init(fs);
+	Iir::Butterworth::BandStop<2> notchDesign;
+	notchDesign.setup(fs,50,2.5);
+	SOSCascade<2> notch;
+	notch.append(notchDesign);
+
+	// or the whole native pipeline through the JNI
+	JNIEnv env;
+	std::atomic<long> processed(0);
+	std::vector<float> hr;
+	std::vector<AttysBufferSample> buffer(10);
+	_jobject directBuffer = {buffer.data(),(jlong)(buffer.size() * sizeof(AttysBufferSample))};
+	if (jni) {
+		registerAttysDataCallback([&processed](float){ processed++; });
+		registerAttysHRCallback([&hr](float bpm){ hr.push_back(bpm); });
+		Java_tech_glasgowneuro_attyshrv_ANativeActivity_initJava2CPP(&env,nullptr,fs);
+	}
+
+	printf("%.1f hours at %.0f Hz, %.0f bpm, %.0f artefacts/hour%s\n",hours,fs,params.meanHR,
+	       params.artefactsPerHour,jni ? ", JNI pipeline" : "");
+	if (jni) {
+		printf("%6s %14s %14s %10s %10s %10s\n","hour","samples/s","x real time","RSS MB","beats","true");
+	} else {
+		printf("%6s %14s %14s %10s %12s %10s %10s\n","hour","samples/s","x real time","RSS MB",
+		       "sensitivity","PPV","delay ms");
+	}
+	std::vector<float> block(blockSize);
+	double secsGenerating = 0;
+	double secsDetecting = 0;
+	const double rss0 = residentMB();
+	double rss1 = rss0;
+	auto tHour = std::chrono::steady_clock::now();
+	long n = 0;
+	while (n < nTotal) {
+		const size_t m = (size_t)((nTotal - n) < (long)blockSize ? nTotal - n : (long)blockSize);
+		const auto t0 = std::chrono::steady_clock::now();
+		ecgsyn.generate(block.data(),m);
+		const auto t1 = std::chrono::steady_clock::now();
+		if (jni) {
+			for(size_t i = 0; i < m; i += buffer.size()) {
+				const size_t k = (i + buffer.size()) < m ? buffer.size() : m - i;
+				// the queue to the DSP thread holds 1024 samples
+				while ((n + (long)i - processed) > 512) {
+					std::this_thread::yield();
+				}
+				for(size_t j = 0; j < k; j++) {
+					buffer[j] = {(int64_t)(n + (long)(i + j)),block[i + j],0};
+				}
+				Java_tech_glasgowneuro_attyshrv_ANativeActivity_dataUpdateBatch(&env,nullptr,0,&directBuffer,(jint)k);
+			}
+		} else {
+			for(size_t i = 0; i < m; i++) {
+				listener.currentSample = n + (long)i;
+				rrDet.detect((float)notch.filter(block[i]));
+			}
+			accuracy.expire(n + (long)m);
+		}
+		const auto t2 = std::chrono::steady_clock::now();
+		secsGenerating += std::chrono::duration<double>(t1 - t0).count();
+		secsDetecting += std::chrono::duration<double>(t2 - t1).count();
+		n += (long)m;
+		if (((n % samplesPerHour) == 0) || (n == nTotal)) {
+			const auto now = std::chrono::steady_clock::now();
+			const double secs = std::chrono::duration<double>(now - tHour).count();
+			tHour = now;
+			const long samplesThisHour = (n % samplesPerHour) == 0 ? samplesPerHour : n % samplesPerHour;
+			rss1 = residentMB();
+			if (jni) {
+				printf("%6.1f %14.0f %14.1f %10.1f %10zu %10ld\n",(double)n / (double)samplesPerHour,
+				       (double)samplesThisHour / secs,(double)samplesThisHour / fs / secs,rss1,hr.size(),nTrue);
+			} else {
+				printf("%6.1f %14.0f %14.1f %10.1f %12.5f %10.5f %10.1f\n",(double)n / (double)samplesPerHour,
+				       (double)samplesThisHour / secs,(double)samplesThisHour / fs / secs,rss1,
+				       accuracy.sensitivity(),accuracy.ppv(),
+				       accuracy.sumError / (double)accuracy.truePositives / fs * 1E3);
+			}
+			fflush(stdout);
+		}
+	}
+	printf("generator: %.0f samples/s, %s: %.0f samples/s\n",(double)n / secsGenerating,
+	       jni ? "JNI pipeline" : "detector",(double)n / secsDetecting);
+	printf("resident memory: %.1f MB at the start, %.1f MB at the end\n",rss0,rss1);
+	if (jni) {
+		while (processed < n) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		const unsigned long overruns = getAttysQueueOverruns();
+		unregisterAllAttysCallbacks();
+		double sum = 0;
+		for(auto &b : hr) sum += b;
+		printf("%zu heartbeats of %ld, mean HR = %f bpm (%f bpm generated), %lu overruns\n",
+		       hr.size(),nTrue,hr.empty() ? 0 : sum / (double)hr.size(),params.meanHR,overruns);
+		return overruns > 0 ? 1 : 0;
+	}
+	printf("%ld true R peaks: %ld detected, %ld missed, %ld false, %ld in or after artefacts\n",
+	       nTrue,accuracy.truePositives,accuracy.falseNegatives,accuracy.falsePositives,accuracy.notExpected);
+	return 0;
+}
@@ -0,0 +1,250 @@
+// Tests StreamBuffer with a real GLES 3 implementation without a window,
+// for example Mesa llvmpipe through EGL surfaceless. Every frame writes a
+// pattern into its region, a vertex shader copies the vertices into a
+// transform feedback buffer at an offset of its own for every frame, and
+// all frames are checked at the end, so that the GPU still reads regions
+// while the CPU writes the next ones. Checks the offsets, the byte counter,
+// a second allocation in the same frame, a full region and the upload with
+// glBufferSubData() instead of mapping. Then times the upload of the wave
+// grid of OvrHRPlot every frame with glBufferData() as the app did before
+// against writing it into the stream buffer.
+//
+// Usage: streambuffertest [frames]
+
+#include "../app/src/main/cpp/stream_buffer.h"
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GLES3/gl3.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+
+// the vertices of the wave grid: position and normal
+const size_t gridBytes = 201 * 201 * 6 * sizeof(float);
+
+static double since(std::chrono::steady_clock::time_point t) {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - t).count();
+}
+
+static bool initEGL() {
+	auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+	if (!getPlatformDisplay) return false;
+	EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA,EGL_DEFAULT_DISPLAY,nullptr);
+	if (EGL_NO_DISPLAY == display) return false;
+	EGLint major;
+	EGLint minor;
+	if (!eglInitialize(display,&major,&minor)) return false;
+	eglBindAPI(EGL_OPENGL_ES_API);
+	const EGLint configAttribs[] = {EGL_RENDERABLE_TYPE,EGL_OPENGL_ES3_BIT,EGL_NONE};
+	EGLConfig config;
+	EGLint nConfigs = 0;
+	eglChooseConfig(display,configAttribs,&config,1,&nConfigs);
+	const EGLint contextAttribs[] = {EGL_CONTEXT_MAJOR_VERSION,3,EGL_NONE};
+	EGLContext context = eglCreateContext(display,nConfigs > 0 ? config : EGL_NO_CONFIG_KHR,EGL_NO_CONTEXT,
+					      contextAttribs);
+	if (EGL_NO_CONTEXT == context) return false;
+	if (!eglMakeCurrent(display,EGL_NO_SURFACE,EGL_NO_SURFACE,context)) return false;
+	// no window: the draws need a framebuffer of their own
+	GLuint renderbuffer;
+	glGenRenderbuffers(1,&renderbuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER,renderbuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER,GL_RGBA8,1,1);
+	GLuint framebuffer;
+	glGenFramebuffers(1,&framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER,framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER,GL_COLOR_ATTACHMENT0,GL_RENDERBUFFER,renderbuffer);
+	return glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+}
+
+static GLuint createProgram() {
+	const char* vs =
+		"#version 300 es\n"
+		"in vec4 vertex;\n"
+		"out vec4 captured;\n"
+		"void main() {\n"
+		"    captured = vertex;\n"
+		"    gl_Position = vec4(0.0);\n"
+		"}\n";
+	const char* fs =
+		"#version 300 es\n"
+		"precision mediump float;\n"
+		"out vec4 colour;\n"
+		"void main() {\n"
+		"    colour = vec4(1.0);\n"
+		"}\n";
+	GLuint program = glCreateProgram();
+	const char* sources[2] = {vs,fs};
+	const GLenum types[2] = {GL_VERTEX_SHADER,GL_FRAGMENT_SHADER};
+	for(int i = 0; i < 2; i++) {
+		GLuint s = glCreateShader(types[i]);
+		glShaderSource(s,1,&sources[i],nullptr);
+		glCompileShader(s);
+		GLint ok;
+		glGetShaderiv(s,GL_COMPILE_STATUS,&ok);
+		if (!ok) {
+			char msg[1024];
+			glGetShaderInfoLog(s,sizeof(msg),nullptr,msg);
+			fprintf(stderr,"Shader: %s\n",msg);
+			exit(1);
+		}
+		glAttachShader(program,s);
+	}
+	const char* varyings[1] = {"captured"};
+	glTransformFeedbackVaryings(program,1,varyings,GL_INTERLEAVED_ATTRIBS);
+	glBindAttribLocation(program,0,"vertex");
+	glLinkProgram(program);
+	GLint ok;
+	glGetProgramiv(program,GL_LINK_STATUS,&ok);
+	if (!ok) {
+		fprintf(stderr,"Cannot link the program\n");
+		exit(1);
+	}
+	return program;
+}
+
+static float pattern(int frame, int allocation, size_t i) {
+	return (float)(frame * 10000 + allocation * 5000 + (int)i);
+}
+
+// draws nFrames with two allocations of nVertices vec4 each and checks them
+static bool frames(bool mapping, int nFrames, size_t nVertices, GLuint program) {
+	StreamBuffer sb;
+	const size_t bytes = nVertices * 4 * sizeof(float);
+	const size_t aligned = (bytes + StreamBuffer::alignment - 1) / StreamBuffer::alignment * StreamBuffer::alignment;
+	if (!sb.create(2 * aligned,3,mapping)) {
+		fprintf(stderr,"Cannot create the stream buffer\n");
+		return false;
+	}
+	GLuint vao;
+	glGenVertexArrays(1,&vao);
+	GLuint capture;
+	glGenBuffers(1,&capture);
+	glBindBuffer(GL_TRANSFORM_FEEDBACK_BUFFER,capture);
+	glBufferData(GL_TRANSFORM_FEEDBACK_BUFFER,(GLsizeiptr)(2 * bytes * (size_t)nFrames),nullptr,GL_STATIC_READ);
+	glBindBuffer(GL_TRANSFORM_FEEDBACK_BUFFER,0);
+	glUseProgram(program);
+	glEnable(GL_RASTERIZER_DISCARD);
+	bool ok = true;
+	for(int f = 0; f < nFrames; f++) {
+		sb.beginFrame();
+		for(int a = 0; a < 2; a++) {
+			float* p = (float*)sb.map(bytes);
+			if (!p) {
+				fprintf(stderr,"No memory in frame %d\n",f);
+				return false;
+			}
+			for(size_t i = 0; i < nVertices * 4; i++) p[i] = pattern(f,a,i);
+			const GLintptr offset = sb.unmap();
+			if ((offset % (GLintptr)StreamBuffer::alignment) != 0) ok = false;
+			glBindVertexArray(vao);
+			glBindBuffer(GL_ARRAY_BUFFER,sb.getBuffer());
+			glEnableVertexAttribArray(0);
+			glVertexAttribPointer(0,4,GL_FLOAT,GL_FALSE,0,(const void*)offset);
+			glBindBufferRange(GL_TRANSFORM_FEEDBACK_BUFFER,0,capture,
+					  (GLintptr)(((size_t)f * 2 + (size_t)a) * bytes),(GLsizeiptr)bytes);
+			glBeginTransformFeedback(GL_POINTS);
+			glDrawArrays(GL_POINTS,0,(GLsizei)nVertices);
+			glEndTransformFeedback();
+			glBindVertexArray(0);
+		}
+		// the region is full now
+		if (sb.map(StreamBuffer::alignment)) ok = false;
+		sb.endFrame();
+		if (sb.getLastFrameBytes() != 2 * bytes) ok = false;
+	}
+	glDisable(GL_RASTERIZER_DISCARD);
+	glBindBuffer(GL_TRANSFORM_FEEDBACK_BUFFER,capture);
+	const float* c = (const float*)glMapBufferRange(GL_TRANSFORM_FEEDBACK_BUFFER,0,
+							(GLsizeiptr)(2 * bytes * (size_t)nFrames),GL_MAP_READ_BIT);
+	size_t wrong = 0;
+	if (!c) {
+		fprintf(stderr,"Cannot read the transform feedback\n");
+		return false;
+	}
+	for(int f = 0; f < nFrames; f++) {
+		for(int a = 0; a < 2; a++) {
+			const float* v = c + ((size_t)f * 2 + (size_t)a) * nVertices * 4;
+			for(size_t i = 0; i < nVertices * 4; i++) {
+				if (v[i] != pattern(f,a,i)) wrong++;
+			}
+		}
+	}
+	glUnmapBuffer(GL_TRANSFORM_FEEDBACK_BUFFER);
+	glBindBuffer(GL_TRANSFORM_FEEDBACK_BUFFER,0);
+	glDeleteBuffers(1,&capture);
+	glDeleteVertexArrays(1,&vao);
+	if (glGetError() != GL_NO_ERROR) ok = false;
+	ok = ok && (0 == wrong) && (sb.getTotalBytes() == 2 * bytes * (unsigned long long)nFrames);
+	printf("%-24s %d frames, %zu wrong values, %llu bytes, %lu waits for the GPU: %s\n",
+	       mapping ? "mapped" : "glBufferSubData",nFrames,wrong,sb.getTotalBytes(),sb.getWaits(),
+	       ok ? "ok" : "FAILED");
+	return ok;
+}
+
+// the wave grid every frame: one draw which reads all of it
+static double upload(bool stream, int nFrames, unsigned long &waits) {
+	std::vector<float> grid(gridBytes / sizeof(float));
+	StreamBuffer sb;
+	if (!sb.create(gridBytes)) {
+		fprintf(stderr,"Cannot create the stream buffer\n");
+		exit(1);
+	}
+	GLuint vbo;
+	glGenBuffers(1,&vbo);
+	GLuint vao;
+	glGenVertexArrays(1,&vao);
+	glEnable(GL_RASTERIZER_DISCARD);
+	const auto t0 = std::chrono::steady_clock::now();
+	for(int f = 0; f < nFrames; f++) {
+		for(size_t i = 0; i < grid.size(); i++) grid[i] = (float)(f + (int)i);
+		sb.beginFrame();
+		glBindVertexArray(vao);
+		if (stream) {
+			void* p = sb.map(gridBytes);
+			memcpy(p,grid.data(),gridBytes);
+			const GLintptr offset = sb.unmap();
+			glBindBuffer(GL_ARRAY_BUFFER,sb.getBuffer());
+			glVertexAttribPointer(0,4,GL_FLOAT,GL_FALSE,0,(const void*)offset);
+		} else {
+			glBindBuffer(GL_ARRAY_BUFFER,vbo);
+			glBufferData(GL_ARRAY_BUFFER,(GLsizeiptr)gridBytes,grid.data(),GL_STREAM_DRAW);
+			sb.countUpload(gridBytes);
+			glVertexAttribPointer(0,4,GL_FLOAT,GL_FALSE,0,nullptr);
+		}
+		glEnableVertexAttribArray(0);
+		glDrawArrays(GL_POINTS,0,(GLsizei)(gridBytes / 16));
+		glBindVertexArray(0);
+		sb.endFrame();
+	}
+	glFinish();
+	const double dt = since(t0) / nFrames;
+	glDisable(GL_RASTERIZER_DISCARD);
+	glDeleteVertexArrays(1,&vao);
+	glDeleteBuffers(1,&vbo);
+	waits = sb.getWaits();
+	return dt;
+}
+
+int main(int argc, char* argv[]) {
+	const int nFrames = argc > 1 ? atoi(argv[1]) : 100;
+	if (!initEGL()) {
+		printf("No EGL display without a window: skipped\n");
+		return 0;
+	}
+	printf("%s, %s\n",(const char*)glGetString(GL_RENDERER),(const char*)glGetString(GL_VERSION));
+	const GLuint program = createProgram();
+	bool ok = frames(true,nFrames,1000,program);
+	ok = frames(false,nFrames,1000,program) && ok;
+	glUseProgram(program);
+	unsigned long waitsData;
+	unsigned long waitsStream;
+	const double tData = upload(false,nFrames,waitsData);
+	const double tStream = upload(true,nFrames,waitsStream);
+	printf("wave grid of %zu bytes every frame: glBufferData %.1f us/frame, stream buffer %.1f us/frame, "
+	       "%lu waits for the GPU\n",gridBytes,tData * 1E6,tStream * 1E6,waitsStream);
+	printf("%s\n",ok ? "passed" : "FAILED");
+	return ok ? 0 : 1;
+}
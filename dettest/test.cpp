@@ -1,4 +1,5 @@
 #include "../app/src/main/cpp/ecg_rr_det.h"
+#include "ecgreader.h"
 
 #include <stdio.h>
 #include "Iir.h"
@@ -39,15 +40,21 @@ int main (int argn,char** argv)
 	ECG_rr_det rr_det(&callback);
 	rr_det.init(fs);
 
-	FILE *finput = fopen(argv[1],"rt");
-	for(;;) 
+	ECGReader reader;
+	if (!reader.open(argv[1])) {
+		fprintf(stderr,"Could not open %s\n",argv[1]);
+		exit(1);
+	}
+	float block[4096];
+	size_t n;
+	while ((n = reader.read(block,4096)) > 0)
 	{
-		float a1;
-		if (fscanf(finput,"%f\n",&a1)<1) break;
-		const float a = iirnotch.filter(a1);
-		rr_det.detect(a);
+		for(size_t i = 0; i < n; i++) {
+			block[i] = iirnotch.filter(block[i]);
+		}
+		rr_det.detect(block,n);
 	}
-	fclose(finput);
+	reader.close();
 
 	fclose(f);
 }
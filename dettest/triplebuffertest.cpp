@@ -0,0 +1,141 @@
+// Stress test of the triple buffer between the DSP thread and the render
+// loop: a producer thread publishes render states as fast as it can while
+// a consumer thread picks up the latest one either as fast as it can or
+// once per frame. Every state is filled with its sequence number so that a
+// torn state would be seen. Checks that the consumer never sees a torn or
+// an older state and that it ends up with the last state published.
+
+#include "../app/src/main/cpp/triple_buffer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+// as the ECG trace, the HR text and the HR spline of the render loop
+struct RenderState {
+	long seq;
+	float trace[500];
+	unsigned short indices[500];
+	int indexCount;
+	std::vector<double> spline;
+};
+
+typedef TripleBuffer<RenderState> Buffer;
+
+static bool isConsistent(const RenderState &s) {
+	for(auto &v : s.trace) {
+		if (v != (float)s.seq) return false;
+	}
+	for(auto &i : s.indices) {
+		if (i != (unsigned short)s.seq) return false;
+	}
+	if (s.indexCount != (int)s.seq) return false;
+	for(auto &v : s.spline) {
+		if (v != (double)s.seq) return false;
+	}
+	return true;
+}
+
+// frameTime: the consumer sleeps between the updates as the render loop
+static bool run(const char* name, long nStates, std::chrono::microseconds frameTime) {
+	Buffer* buffer = new Buffer;
+	bool ok = true;
+	std::atomic<bool> done(false);
+
+	auto t0 = std::chrono::steady_clock::now();
+	std::thread producer([&]() {
+		for(long i = 1; i <= nStates; i++) {
+			RenderState &s = buffer->getWriteBuffer();
+			s.seq = i;
+			for(auto &v : s.trace) v = (float)i;
+			for(auto &v : s.indices) v = (unsigned short)i;
+			s.indexCount = (int)i;
+			// allocates only when a buffer is filled for the first time
+			s.spline.assign(60,(double)i);
+			buffer->publish();
+		}
+		done = true;
+	});
+
+	long frames = 0;
+	long updates = 0;
+	long last = 0;
+	for(;;) {
+		const bool finished = done;
+		if (buffer->update()) {
+			const RenderState &s = buffer->getReadBuffer();
+			if (!isConsistent(s)) {
+				fprintf(stderr,"Torn state %ld\n",s.seq);
+				ok = false;
+			}
+			if (s.seq <= last) {
+				fprintf(stderr,"State %ld after %ld\n",s.seq,last);
+				ok = false;
+			}
+			last = s.seq;
+			updates++;
+		} else if (buffer->getReadBuffer().seq != last) {
+			fprintf(stderr,"The read buffer has changed without an update\n");
+			ok = false;
+		}
+		frames++;
+		// the producer had finished before the update: it must have got the last state
+		if (finished) break;
+		if (frameTime.count() > 0) {
+			std::this_thread::sleep_for(frameTime);
+		} else {
+			std::this_thread::yield();
+		}
+	}
+	producer.join();
+	auto t1 = std::chrono::steady_clock::now();
+	const double t = std::chrono::duration<double>(t1 - t0).count();
+
+	if (last != nStates) {
+		fprintf(stderr,"The last state is %ld instead of %ld\n",last,nStates);
+		ok = false;
+	}
+	if ((long)buffer->getPublished() != nStates) {
+		fprintf(stderr,"%lu published instead of %ld\n",buffer->getPublished(),nStates);
+		ok = false;
+	}
+	printf("%s: %ld states, %f Mstates/s, %ld frames, %ld new states, %s\n",
+	       name,nStates,(double)nStates / t / 1E6,frames,updates,
+	       ok ? "OK" : "FAILED");
+	delete buffer;
+	return ok;
+}
+
+// the cost of publish() and update() without the contention
+static void benchmark() {
+	Buffer* buffer = new Buffer;
+	const long n = 10000000;
+	auto t0 = std::chrono::steady_clock::now();
+	for(long i = 0; i < n; i++) {
+		buffer->getWriteBuffer().seq = i;
+		buffer->publish();
+	}
+	auto t1 = std::chrono::steady_clock::now();
+	long sum = 0;
+	for(long i = 0; i < n; i++) {
+		buffer->update();
+		sum += buffer->getReadBuffer().seq;
+	}
+	auto t2 = std::chrono::steady_clock::now();
+	printf("publish: %.2f ns, update: %.2f ns (%ld)\n",
+	       std::chrono::duration<double>(t1 - t0).count() * 1E9 / (double)n,
+	       std::chrono::duration<double>(t2 - t1).count() * 1E9 / (double)n,sum);
+	delete buffer;
+}
+
+int main (int, char**)
+{
+	bool ok = run("full rate",2000000,std::chrono::microseconds(0));
+	// 90 frames per second as the headset
+	ok = run("render loop",2000000,std::chrono::microseconds(11111)) && ok;
+	benchmark();
+	return ok ? 0 : 1;
+}